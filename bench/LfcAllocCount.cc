@@ -0,0 +1,106 @@
+//------------------------------------------------------------------------------
+// File: LfcAllocCount.cc
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include <cstdlib>
+#include <new>
+/*----------------------------------------------------------------------------*/
+#include <malloc.h>
+/*----------------------------------------------------------------------------*/
+#include "LfcAllocCount.hh"
+/*----------------------------------------------------------------------------*/
+
+//! Number of calls to operator new and new[]
+static volatile uint64_t gNumAllocs = 0;
+
+//! Number of bytes currently allocated through operator new and new[]
+static volatile int64_t gLiveBytes = 0;
+
+
+//------------------------------------------------------------------------------
+// Get the number of calls to operator new and new[]
+//------------------------------------------------------------------------------
+uint64_t
+LfcAllocCount()
+{
+  return gNumAllocs;
+}
+
+
+//------------------------------------------------------------------------------
+// Get the number of bytes currently allocated
+//------------------------------------------------------------------------------
+int64_t
+LfcAllocLiveBytes()
+{
+  return gLiveBytes;
+}
+
+
+//------------------------------------------------------------------------------
+// Allocation accounting
+//------------------------------------------------------------------------------
+void*
+#if __cplusplus >= 201103L
+operator new( size_t size )
+#else
+operator new( size_t size ) throw( std::bad_alloc )
+#endif
+{
+  void* ptr = malloc( size ? size : 1 );
+
+  if ( !ptr ) {
+    throw std::bad_alloc();
+  }
+
+  __sync_fetch_and_add( &gNumAllocs, 1 );
+  __sync_fetch_and_add( &gLiveBytes, static_cast<int64_t>( malloc_usable_size( ptr ) ) );
+  return ptr;
+}
+
+void*
+#if __cplusplus >= 201103L
+operator new[]( size_t size )
+#else
+operator new[]( size_t size ) throw( std::bad_alloc )
+#endif
+{
+  return operator new( size );
+}
+
+//! Not inlined, gcc would otherwise match the free() against the callers'
+//! operator new and warn about a mismatched deallocation
+void __attribute__(( noinline ))
+operator delete( void* ptr ) throw()
+{
+  if ( ptr ) {
+    __sync_fetch_and_sub( &gLiveBytes, static_cast<int64_t>( malloc_usable_size( ptr ) ) );
+    free( ptr );
+  }
+}
+
+void
+operator delete[]( void* ptr ) throw()
+{
+  operator delete( ptr );
+}
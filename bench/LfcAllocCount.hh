@@ -0,0 +1,49 @@
+//------------------------------------------------------------------------------
+// File: LfcAllocCount.hh
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOS_PLUGIN_LFCALLOCCOUNT_HH__
+#define __EOS_PLUGIN_LFCALLOCCOUNT_HH__
+
+/*----------------------------------------------------------------------------*/
+#include <stdint.h>
+/*----------------------------------------------------------------------------*/
+
+//------------------------------------------------------------------------------
+//! Accounting of the heap allocations of a benchmark. Linking LfcAllocCount.cc
+//! replaces the global operator new and delete ( and their array forms ) by
+//! versions counting the calls and the bytes in use, from all the threads.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+//! Get the number of calls to operator new and new[] since the start
+//------------------------------------------------------------------------------
+uint64_t LfcAllocCount();
+
+
+//------------------------------------------------------------------------------
+//! Get the number of bytes currently allocated through operator new and
+//! new[], as reported by malloc_usable_size()
+//------------------------------------------------------------------------------
+int64_t LfcAllocLiveBytes();
+
+#endif // __EOS_PLUGIN_LFCALLOCCOUNT_HH__
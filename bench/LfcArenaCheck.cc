@@ -0,0 +1,97 @@
+//------------------------------------------------------------------------------
+// File: LfcArenaCheck.cc
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+//------------------------------------------------------------------------------
+//! Check of the LfcArena block boundaries: a block of a whole chunk allocated
+//! first in a fresh arena must not overlap the null reference nor run past
+//! the end of its chunk, and a block bigger than a chunk must be refused.
+//! Exits with 1 if a check fails.
+//!
+//! Usage: LfcArenaCheck
+//------------------------------------------------------------------------------
+
+/*----------------------------------------------------------------------------*/
+#include <cstdio>
+/*----------------------------------------------------------------------------*/
+#include "LfcArena.hh"
+/*----------------------------------------------------------------------------*/
+
+//! Size in bytes of a chunk of the arena
+static const size_t sChunkSize = LfcArena::sUnitsPerChunk << LfcArena::sUnitShift;
+
+//------------------------------------------------------------------------------
+// Allocate a block of a given size first in a fresh arena and check that it
+// lies within one chunk
+//------------------------------------------------------------------------------
+static bool
+CheckFirstBlock( size_t size )
+{
+  LfcArena arena;
+  uint32_t ref = arena.Alloc( size );
+  size_t avail = 0;
+
+  if ( !ref || !arena.Peek( ref, avail ) || ( avail < size ) ) {
+    fprintf( stderr, "error: block of %zu bytes, ref=%u avail=%zu\n",
+             size, ref, avail );
+    return false;
+  }
+
+  //............................................................................
+  // The following small block must not overlap the big one
+  //............................................................................
+  uint32_t units = ( size + ( 1 << LfcArena::sUnitShift ) - 1 ) >>
+                   LfcArena::sUnitShift;
+  uint32_t next = arena.Alloc( 16 );
+
+  if ( !next || ( ( next >= ref ) && ( next < ref + units ) ) ) {
+    fprintf( stderr, "error: block of 16 bytes at ref=%u overlaps the block "
+             "of %zu bytes at ref=%u\n", next, size, ref );
+    return false;
+  }
+
+  return true;
+}
+
+
+//------------------------------------------------------------------------------
+// Main function
+//------------------------------------------------------------------------------
+int
+main( int argc, char* argv[] )
+{
+  bool ok = CheckFirstBlock( sChunkSize ) &&
+            CheckFirstBlock( sChunkSize - 15 ) &&
+            CheckFirstBlock( sChunkSize - 16 ) &&
+            CheckFirstBlock( 1 );
+
+  LfcArena arena;
+
+  if ( arena.Alloc( sChunkSize + 1 ) || arena.Alloc( 0 ) ) {
+    fprintf( stderr, "error: block of 0 or more than %zu bytes allocated\n",
+             sChunkSize );
+    ok = false;
+  }
+
+  fprintf( stdout, "%s\n", ok ? "ok" : "failed" );
+  return ( ok ? 0 : 1 );
+}
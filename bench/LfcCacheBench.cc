@@ -0,0 +1,154 @@
+//------------------------------------------------------------------------------
+// File: LfcCacheBench.cc
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+//------------------------------------------------------------------------------
+//! Benchmark for the LfcCache insert path. For every cache size the cache is
+//! filled up to its maximum size and then the latency of inserting new entries
+//! is measured - this covers both the overflow eviction and the expiry check.
+//!
+//! Usage: LfcCacheBench [-s size1,size2,...] [-n inserts] [-t ttl] [-S shards]
+//------------------------------------------------------------------------------
+
+/*----------------------------------------------------------------------------*/
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+/*----------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <sys/time.h>
+#include <unistd.h>
+/*----------------------------------------------------------------------------*/
+#include "LfcCache.hh"
+#include "LfcString.hh"
+/*----------------------------------------------------------------------------*/
+
+
+//------------------------------------------------------------------------------
+// Current time in nanoseconds
+//------------------------------------------------------------------------------
+static uint64_t
+NowNs()
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return static_cast<uint64_t>( ts.tv_sec ) * 1000000000ULL + ts.tv_nsec;
+}
+
+
+//------------------------------------------------------------------------------
+// Build an ATLAS like lfn and the corresponding pfn for the given index
+//------------------------------------------------------------------------------
+static void
+MakeEntry( uint64_t index, std::string& lfn, std::string& pfn )
+{
+  char buff[256];
+  snprintf( buff, sizeof( buff ), "/atlas/dq2/mc12_8TeV/NTUP_SMWZ/e%04llu/"
+            "NTUP_SMWZ.%09llu._000001.root.1",
+            static_cast<unsigned long long>( index % 1000 ),
+            static_cast<unsigned long long>( index ) );
+  lfn = buff;
+  pfn = "/eos/atlas/atlasdatadisk";
+  pfn += lfn;
+}
+
+
+//------------------------------------------------------------------------------
+// Main
+//------------------------------------------------------------------------------
+int
+main( int argc, char* argv[] )
+{
+  LfcString sizes = "1000,10000,100000,1000000,5000000";
+  uint64_t num_inserts = 100000;
+  uint64_t ttl = 24 * 3600;
+  unsigned int num_shards = 1;
+  int opt;
+
+  while ( ( opt = getopt( argc, argv, "s:n:t:S:" ) ) != -1 ) {
+    switch ( opt ) {
+      case 's':
+        sizes = optarg;
+        break;
+      case 'n':
+        num_inserts = strtoull( optarg, NULL, 10 );
+        break;
+      case 't':
+        ttl = strtoull( optarg, NULL, 10 );
+        break;
+      case 'S':
+        num_shards = strtoul( optarg, NULL, 10 );
+        break;
+      default:
+        fprintf( stderr, "Usage: %s [-s size1,size2,...] [-n inserts] [-t ttl] "
+                 "[-S shards]\n", argv[0] );
+        return 1;
+    }
+  }
+
+  VectStrings vect_sizes = sizes.Split( "," );
+  std::string lfn;
+  std::string pfn;
+  fprintf( stdout, "%12s %12s %14s %14s\n", "cache_size", "inserts",
+           "avg_ns/insert", "max_ns/insert" );
+
+  for ( VectStrings::iterator it = vect_sizes.begin(); it != vect_sizes.end(); ++it ) {
+    uint64_t size = strtoull( it->c_str(), NULL, 10 );
+    LfcCache* cache = new LfcCache( ttl, size, num_shards );
+
+    //..........................................................................
+    // Fill the cache up to its maximum size
+    //..........................................................................
+    for ( uint64_t i = 0; i < size; i++ ) {
+      MakeEntry( i, lfn, pfn );
+      cache->Insert( lfn, pfn );
+    }
+
+    //..........................................................................
+    // Measure the insert of new entries into the full cache
+    //..........................................................................
+    uint64_t total_ns = 0;
+    uint64_t max_ns = 0;
+
+    for ( uint64_t i = 0; i < num_inserts; i++ ) {
+      MakeEntry( size + i, lfn, pfn );
+      uint64_t start = NowNs();
+      cache->Insert( lfn, pfn );
+      uint64_t duration = NowNs() - start;
+      total_ns += duration;
+
+      if ( duration > max_ns ) {
+        max_ns = duration;
+      }
+    }
+
+    fprintf( stdout, "%12llu %12llu %14.1f %14llu\n",
+             static_cast<unsigned long long>( size ),
+             static_cast<unsigned long long>( num_inserts ),
+             static_cast<double>( total_ns ) / num_inserts,
+             static_cast<unsigned long long>( max_ns ) );
+    delete cache;
+  }
+
+  return 0;
+}
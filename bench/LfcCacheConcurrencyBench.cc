@@ -0,0 +1,534 @@
+//------------------------------------------------------------------------------
+// File: LfcCacheConcurrencyBench.cc
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+//------------------------------------------------------------------------------
+//! Benchmark of LfcCache under concurrent use. Every thread resolves lfns the
+//! way the plugin does: a GetEntry and, on a miss, an Insert of the pfn. The
+//! lfns are drawn from a key space with one of these distributions:
+//!
+//!   uniform  - every lfn equally likely
+//!   zipf     - Zipfian popularity of the lfns, the hot ones spread over the
+//!              whole key space
+//!   dataset  - Zipfian popularity of ATLAS like datasets of -F files each,
+//!              all the files of a dataset read uniformly
+//!
+//! A fraction 1 - hit_ratio of the requests is for lfns never seen before,
+//! so that the hit ratio can be lowered independently of the cache size. The
+//! cache is filled with the first cache_maxsize lfns of the key space before
+//! the run. The throughput, the latency percentiles of the lookups and of the
+//! inserts and the resident memory are reported. With a maintenance interval
+//! the cleanup is left to the maintenance thread of the cache, the shards
+//! growing by at most high_watermark percent.
+//!
+//! Usage: LfcCacheConcurrencyBench [-t threads] [-n ops_per_thread]
+//!        [-d uniform|zipf|dataset] [-k keyspace] [-m cache_maxsize]
+//!        [-T ttl] [-S shards] [-h hit_ratio] [-z zipf_theta] [-F files]
+//!        [-P fifo|s3fifo|tinylfu] [-M maint_interval_ms] [-W high_watermark]
+//------------------------------------------------------------------------------
+
+/*----------------------------------------------------------------------------*/
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+/*----------------------------------------------------------------------------*/
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+/*----------------------------------------------------------------------------*/
+#include "LfcCache.hh"
+#include "LfcStats.hh"
+/*----------------------------------------------------------------------------*/
+
+//! Length of the zero padded numbers in the lfns
+static const int sNumDigits = 10;
+
+//! Lfn of key 0, the numbers being patched in for the other keys
+static const char sLfnTemplate[] =
+  "/atlas/dq2/mc12_8TeV/NTUP_SMWZ/mc12_8TeV.0000000000.PowhegPythia8_AU2CT10."
+  "merge.NTUP_SMWZ.e1169_s1469_r3542_p1328/NTUP_SMWZ.0000000000._000001.root.1";
+
+//! Pfn prefix replacing the /atlas/dq2 of the lfn
+static const char sPfnPrefix[] = "/eos/atlas/atlasdatadisk/rucio";
+
+//------------------------------------------------------------------------------
+//! Parameters of a run
+//------------------------------------------------------------------------------
+struct Config {
+  enum Distribution { eUniform, eZipf, eDataset };
+
+  unsigned int mNumThreads;
+  uint64_t mNumOps;
+  Distribution mDistribution;
+  uint64_t mKeySpace;
+  uint64_t mMaxSize;
+  uint64_t mTtl;
+  unsigned int mNumShards;
+  LfcCache::Policy mPolicy;
+  int mMaintInterval;
+  unsigned int mHighWatermark;
+  double mHitRatio;
+  double mTheta;
+  uint64_t mFilesPerDataset;
+};
+
+
+//------------------------------------------------------------------------------
+//! Zipfian generator of ranks in [0, n) as in "Quickly generating billion
+//! record synthetic databases" by J. Gray et al., theta in (0, 1)
+//------------------------------------------------------------------------------
+class Zipf
+{
+  public:
+
+    Zipf( uint64_t n, double theta ): mN( n ) {
+      double zeta2 = 1.0 + pow( 0.5, theta );
+      mZetaN = 0;
+
+      for ( uint64_t i = 1; i <= n; i++ ) {
+        mZetaN += 1.0 / pow( static_cast<double>( i ), theta );
+      }
+
+      mAlpha = 1.0 / ( 1.0 - theta );
+      mEta = ( 1.0 - pow( 2.0 / n, 1.0 - theta ) ) / ( 1.0 - zeta2 / mZetaN );
+      mHalfPowTheta = 1.0 + pow( 0.5, theta );
+    }
+
+    uint64_t Next( double u ) const {
+      double uz = u * mZetaN;
+
+      if ( uz < 1.0 ) {
+        return 0;
+      }
+
+      if ( uz < mHalfPowTheta ) {
+        return 1;
+      }
+
+      uint64_t rank = static_cast<uint64_t>( mN * pow( mEta * u - mEta + 1.0, mAlpha ) );
+      return ( rank < mN ) ? rank : mN - 1;
+    }
+
+  private:
+
+    uint64_t mN;
+    double mZetaN;
+    double mAlpha;
+    double mEta;
+    double mHalfPowTheta;
+};
+
+
+//------------------------------------------------------------------------------
+//! State and results of one thread
+//------------------------------------------------------------------------------
+struct Worker {
+  const Config* mConfig;
+  const Zipf* mZipf;
+  LfcCache* mCache;
+  unsigned int mIndex;
+  uint64_t mSeed;
+  uint64_t mHits;
+  uint64_t mFresh;
+  LfcHistogram mLookup;
+  LfcHistogram mInsert;
+  pthread_t mThread;
+};
+
+
+//------------------------------------------------------------------------------
+// Random number generator ( xorshift64* )
+//------------------------------------------------------------------------------
+static uint64_t
+NextRandom( uint64_t& state )
+{
+  state ^= state >> 12;
+  state ^= state << 25;
+  state ^= state >> 27;
+  return state * 2685821657736338717ULL;
+}
+
+static double
+NextUniform( uint64_t& state )
+{
+  return ( NextRandom( state ) >> 11 ) * ( 1.0 / 9007199254740992.0 );
+}
+
+
+//------------------------------------------------------------------------------
+// Write a zero padded number over the digits of a template
+//------------------------------------------------------------------------------
+static void
+PatchNumber( char* pos, uint64_t value )
+{
+  for ( int i = sNumDigits - 1; i >= 0; i-- ) {
+    pos[i] = '0' + value % 10;
+    value /= 10;
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Build the lfn of a key and its pfn, the keys of a dataset share the directory
+//------------------------------------------------------------------------------
+static void
+MakeEntry( const Config& config, uint64_t key, std::string& lfn, std::string& pfn )
+{
+  static const size_t dataset_pos = strstr( sLfnTemplate, ".0000000000." ) - sLfnTemplate + 1;
+  static const size_t file_pos = strstr( sLfnTemplate, "SMWZ.0000000000._" ) - sLfnTemplate + 5;
+  lfn.assign( sLfnTemplate, sizeof( sLfnTemplate ) - 1 );
+  PatchNumber( &lfn[dataset_pos], key / config.mFilesPerDataset );
+  PatchNumber( &lfn[file_pos], key );
+  pfn.assign( sPfnPrefix, sizeof( sPfnPrefix ) - 1 );
+  pfn.append( lfn, 10, std::string::npos );
+}
+
+
+//------------------------------------------------------------------------------
+// Draw the key of the next request
+//------------------------------------------------------------------------------
+static uint64_t
+NextKey( Worker& worker, uint64_t& seed )
+{
+  const Config& config = *worker.mConfig;
+
+  switch ( config.mDistribution ) {
+    case Config::eZipf: {
+      //........................................................................
+      // Spread the hot ranks over the key space with a multiplicative hash
+      //........................................................................
+      uint64_t rank = worker.mZipf->Next( NextUniform( seed ) );
+      return ( rank * 0x9E3779B97F4A7C15ULL ) % config.mKeySpace;
+    }
+
+    case Config::eDataset: {
+      uint64_t dataset = worker.mZipf->Next( NextUniform( seed ) );
+      return dataset * config.mFilesPerDataset +
+             NextRandom( seed ) % config.mFilesPerDataset;
+    }
+
+    default:
+      return NextRandom( seed ) % config.mKeySpace;
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Run the requests of one thread
+//------------------------------------------------------------------------------
+static void*
+RunWorker( void* arg )
+{
+  Worker& worker = *static_cast<Worker*>( arg );
+  const Config& config = *worker.mConfig;
+  uint64_t seed = worker.mSeed;
+  std::string lfn;
+  std::string pfn;
+  char found[4096];
+  size_t found_len;
+
+  for ( uint64_t i = 0; i < config.mNumOps; i++ ) {
+    uint64_t key;
+
+    if ( NextUniform( seed ) < config.mHitRatio ) {
+      key = NextKey( worker, seed );
+    } else {
+      key = config.mKeySpace + worker.mFresh++ * config.mNumThreads + worker.mIndex;
+    }
+
+    MakeEntry( config, key, lfn, pfn );
+    uint64_t start = LfcStats::Now();
+    bool hit = worker.mCache->GetEntry( lfn.c_str(), lfn.length(), found,
+                                        sizeof( found ), found_len );
+    uint64_t end = LfcStats::Now();
+    worker.mLookup.Record( end - start );
+
+    if ( hit ) {
+      worker.mHits++;
+      continue;
+    }
+
+    worker.mCache->Insert( lfn, pfn );
+    worker.mInsert.Record( LfcStats::Now() - end );
+  }
+
+  return NULL;
+}
+
+
+//------------------------------------------------------------------------------
+// Resident memory of the process in bytes
+//------------------------------------------------------------------------------
+static uint64_t
+GetRss()
+{
+  unsigned long long size = 0;
+  unsigned long long resident = 0;
+  FILE* file = fopen( "/proc/self/statm", "r" );
+
+  if ( file ) {
+    if ( fscanf( file, "%llu %llu", &size, &resident ) != 2 ) {
+      resident = 0;
+    }
+
+    fclose( file );
+  }
+
+  return resident * sysconf( _SC_PAGESIZE );
+}
+
+
+//------------------------------------------------------------------------------
+// Print the percentiles of a latency histogram
+//------------------------------------------------------------------------------
+static void
+PrintLatency( const char* name, const LfcHistogram& hist )
+{
+  fprintf( stdout, "%8s %12llu %10.1f %10llu %10llu %10llu %10llu\n", name,
+           static_cast<unsigned long long>( hist.GetCount() ),
+           hist.GetCount() ? static_cast<double>( hist.GetSum() ) / hist.GetCount() : 0.0,
+           static_cast<unsigned long long>( hist.GetPercentile( 0.5 ) ),
+           static_cast<unsigned long long>( hist.GetPercentile( 0.99 ) ),
+           static_cast<unsigned long long>( hist.GetPercentile( 0.999 ) ),
+           static_cast<unsigned long long>( hist.GetMax() ) );
+}
+
+
+//------------------------------------------------------------------------------
+// Main
+//------------------------------------------------------------------------------
+int
+main( int argc, char* argv[] )
+{
+  Config config;
+  config.mNumThreads = 8;
+  config.mNumOps = 1000000;
+  config.mDistribution = Config::eZipf;
+  config.mKeySpace = 1000000;
+  config.mMaxSize = 500000;
+  config.mTtl = 2 * 3600;
+  config.mNumShards = 16;
+  config.mPolicy = LfcCache::eFifo;
+  config.mMaintInterval = 0;
+  config.mHighWatermark = 10;
+  config.mHitRatio = 1.0;
+  config.mTheta = 0.99;
+  config.mFilesPerDataset = 200;
+  std::string distribution = "zipf";
+  std::string policy = "fifo";
+  int opt;
+
+  while ( ( opt = getopt( argc, argv, "t:n:d:k:m:T:S:h:z:F:P:M:W:" ) ) != -1 ) {
+    switch ( opt ) {
+      case 't':
+        config.mNumThreads = strtoul( optarg, NULL, 10 );
+        break;
+      case 'n':
+        config.mNumOps = strtoull( optarg, NULL, 10 );
+        break;
+      case 'd':
+        distribution = optarg;
+        break;
+      case 'k':
+        config.mKeySpace = strtoull( optarg, NULL, 10 );
+        break;
+      case 'm':
+        config.mMaxSize = strtoull( optarg, NULL, 10 );
+        break;
+      case 'T':
+        config.mTtl = strtoull( optarg, NULL, 10 );
+        break;
+      case 'S':
+        config.mNumShards = strtoul( optarg, NULL, 10 );
+        break;
+      case 'h':
+        config.mHitRatio = strtod( optarg, NULL );
+        break;
+      case 'z':
+        config.mTheta = strtod( optarg, NULL );
+        break;
+      case 'F':
+        config.mFilesPerDataset = strtoull( optarg, NULL, 10 );
+        break;
+      case 'P':
+        policy = optarg;
+        break;
+      case 'M':
+        config.mMaintInterval = atoi( optarg );
+        break;
+      case 'W':
+        config.mHighWatermark = strtoul( optarg, NULL, 10 );
+        break;
+      default:
+        fprintf( stderr, "Usage: %s [-t threads] [-n ops_per_thread] "
+                 "[-d uniform|zipf|dataset] [-k keyspace] [-m cache_maxsize] "
+                 "[-T ttl] [-S shards] [-h hit_ratio] [-z zipf_theta] [-F files] "
+                 "[-P fifo|s3fifo|tinylfu] [-M maint_interval_ms] "
+                 "[-W high_watermark]\n",
+                 argv[0] );
+        return 1;
+    }
+  }
+
+  if ( distribution == "uniform" ) {
+    config.mDistribution = Config::eUniform;
+  } else if ( distribution == "zipf" ) {
+    config.mDistribution = Config::eZipf;
+  } else if ( distribution == "dataset" ) {
+    config.mDistribution = Config::eDataset;
+  } else {
+    fprintf( stderr, "Error: unknown distribution %s\n", distribution.c_str() );
+    return 1;
+  }
+
+  if ( policy == "fifo" ) {
+    config.mPolicy = LfcCache::eFifo;
+  } else if ( policy == "s3fifo" ) {
+    config.mPolicy = LfcCache::eS3Fifo;
+  } else if ( policy == "tinylfu" ) {
+    config.mPolicy = LfcCache::eTinyLfu;
+  } else {
+    fprintf( stderr, "Error: unknown policy %s\n", policy.c_str() );
+    return 1;
+  }
+
+  if ( !config.mNumThreads || !config.mKeySpace || !config.mFilesPerDataset ||
+       ( config.mTheta <= 0 ) || ( config.mTheta >= 1 ) )
+  {
+    fprintf( stderr, "Error: invalid parameters\n" );
+    return 1;
+  }
+
+  fprintf( stdout, "threads=%u ops_per_thread=%llu distribution=%s keyspace=%llu "
+           "cache_maxsize=%llu ttl=%llu shards=%u hit_ratio=%.2f theta=%.2f "
+           "files_per_dataset=%llu policy=%s maint_interval=%d high_watermark=%u\n",
+           config.mNumThreads,
+           static_cast<unsigned long long>( config.mNumOps ), distribution.c_str(),
+           static_cast<unsigned long long>( config.mKeySpace ),
+           static_cast<unsigned long long>( config.mMaxSize ),
+           static_cast<unsigned long long>( config.mTtl ), config.mNumShards,
+           config.mHitRatio, config.mTheta,
+           static_cast<unsigned long long>( config.mFilesPerDataset ), policy.c_str(),
+           config.mMaintInterval, config.mHighWatermark );
+
+  //............................................................................
+  // The dataset distribution draws datasets, the others single keys
+  //............................................................................
+  uint64_t num_ranks = config.mKeySpace;
+
+  if ( config.mDistribution == Config::eDataset ) {
+    num_ranks = ( config.mKeySpace + config.mFilesPerDataset - 1 ) /
+                config.mFilesPerDataset;
+  }
+
+  Zipf zipf( num_ranks, config.mTheta );
+
+  //............................................................................
+  // Fill the cache with the beginning of the key space
+  //............................................................................
+  uint64_t rss_start = GetRss();
+  LfcCache* cache = new LfcCache( config.mTtl, config.mMaxSize, config.mNumShards,
+                                  config.mPolicy );
+  std::string lfn;
+  std::string pfn;
+  uint64_t num_fill = ( config.mKeySpace < config.mMaxSize ) ?
+                      config.mKeySpace : config.mMaxSize;
+
+  for ( uint64_t i = 0; i < num_fill; i++ ) {
+    MakeEntry( config, i, lfn, pfn );
+    cache->Insert( lfn, pfn );
+  }
+
+  if ( config.mMaintInterval > 0 ) {
+    int retc = cache->StartMaintenance( config.mMaintInterval, config.mHighWatermark );
+
+    if ( retc ) {
+      fprintf( stderr, "Error: unable to start the maintenance thread, %s\n",
+               strerror( -retc ) );
+      return 1;
+    }
+  }
+
+  uint64_t rss_fill = GetRss();
+  fprintf( stdout, "fill: entries=%llu rss_delta=%.1fMB bytes/entry=%.1f\n",
+           static_cast<unsigned long long>( num_fill ),
+           ( rss_fill - rss_start ) / 1048576.0,
+           num_fill ? static_cast<double>( rss_fill - rss_start ) / num_fill : 0.0 );
+
+  //............................................................................
+  // Run the threads
+  //............................................................................
+  std::vector<Worker*> workers;
+  uint64_t start = LfcStats::Now();
+
+  for ( unsigned int i = 0; i < config.mNumThreads; i++ ) {
+    Worker* worker = new Worker();
+    worker->mConfig = &config;
+    worker->mZipf = &zipf;
+    worker->mCache = cache;
+    worker->mIndex = i;
+    worker->mSeed = 0x2545F4914F6CDD1DULL * ( i + 1 );
+    worker->mHits = 0;
+    worker->mFresh = 0;
+    workers.push_back( worker );
+
+    if ( pthread_create( &worker->mThread, NULL, RunWorker, worker ) ) {
+      fprintf( stderr, "Error: unable to start thread %u\n", i );
+      return 1;
+    }
+  }
+
+  LfcHistogram lookup;
+  LfcHistogram insert;
+  uint64_t hits = 0;
+
+  for ( unsigned int i = 0; i < workers.size(); i++ ) {
+    pthread_join( workers[i]->mThread, NULL );
+    lookup.Add( workers[i]->mLookup );
+    insert.Add( workers[i]->mInsert );
+    hits += workers[i]->mHits;
+    delete workers[i];
+  }
+
+  double seconds = ( LfcStats::Now() - start ) / 1e9;
+  uint64_t num_ops = config.mNumOps * config.mNumThreads;
+  LfcCache::Stats stats;
+  cache->GetStats( stats );
+  fprintf( stdout, "run: ops=%llu seconds=%.2f ops/s=%.0f hit_ratio=%.3f entries=%llu "
+           "expired=%llu evicted=%llu rss=%.1fMB\n",
+           static_cast<unsigned long long>( num_ops ), seconds, num_ops / seconds,
+           num_ops ? static_cast<double>( hits ) / num_ops : 0.0,
+           static_cast<unsigned long long>( stats.mEntries ),
+           static_cast<unsigned long long>( stats.mExpired ),
+           static_cast<unsigned long long>( stats.mEvicted ),
+           GetRss() / 1048576.0 );
+  fprintf( stdout, "%8s %12s %10s %10s %10s %10s %10s\n", "op", "count", "mean_ns",
+           "p50_ns", "p99_ns", "p999_ns", "max_ns" );
+  PrintLatency( "lookup", lookup );
+  PrintLatency( "insert", insert );
+  delete cache;
+  return 0;
+}
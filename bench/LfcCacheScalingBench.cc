@@ -0,0 +1,336 @@
+//------------------------------------------------------------------------------
+// File: LfcCacheScalingBench.cc
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+//------------------------------------------------------------------------------
+//! Benchmark of the LfcCache hit throughput as the number of threads grows.
+//! The cache is filled with all the lfns of the key space, which the threads
+//! then look up at random for a fixed time, with 1, 2, 4, ... up to
+//! max_threads threads. The same lookups are also run through a reader-writer
+//! lock per shard, as the lookups took before they became lock-free, so that
+//! the cost of the cache line shared by the readers shows up. With a write
+//! fraction, that fraction of the operations inserts a new lfn instead.
+//!
+//! Usage: LfcCacheScalingBench [-e entries] [-d duration_ms] [-T max_threads]
+//!        [-S shards] [-P fifo|s3fifo|tinylfu] [-w write_fraction]
+//------------------------------------------------------------------------------
+
+/*----------------------------------------------------------------------------*/
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+/*----------------------------------------------------------------------------*/
+#include <pthread.h>
+#include <stdint.h>
+#include <unistd.h>
+/*----------------------------------------------------------------------------*/
+#include "LfcCache.hh"
+#include "LfcHash.hh"
+#include "LfcStats.hh"
+/*----------------------------------------------------------------------------*/
+
+//! Pfn prefix replacing the /atlas/dq2 of the lfn
+static const char sPfnPrefix[] = "/eos/atlas/atlasdatadisk/rucio";
+
+//! Number of lookups between two checks of the stop flag
+static const uint64_t sCheckInterval = 256;
+
+//------------------------------------------------------------------------------
+//! Reader-writer lock on its own cache lines
+//------------------------------------------------------------------------------
+struct PaddedLock {
+  char mPadBefore[64];
+  XrdSysRWLock mLock;
+  char mPadAfter[64];
+};
+
+//------------------------------------------------------------------------------
+//! State shared by the threads of a step
+//------------------------------------------------------------------------------
+struct Step {
+  LfcCache* mCache;
+  const std::vector<std::string>* mLfns;
+  PaddedLock* mLocks;       ///< locks taken around the lookups, NULL if none
+  unsigned int mNumLocks;
+  double mWriteFraction;
+  volatile bool mStart;
+  volatile bool mStop;
+};
+
+//------------------------------------------------------------------------------
+//! State and results of one thread
+//------------------------------------------------------------------------------
+struct Worker {
+  Step* mStep;
+  unsigned int mIndex;
+  uint64_t mSeed;
+  uint64_t mLookups;
+  uint64_t mHits;
+  uint64_t mInserts;
+  pthread_t mThread;
+};
+
+
+//------------------------------------------------------------------------------
+// Random number generator ( xorshift64* )
+//------------------------------------------------------------------------------
+static uint64_t
+NextRandom( uint64_t& state )
+{
+  state ^= state >> 12;
+  state ^= state << 25;
+  state ^= state >> 27;
+  return state * 2685821657736338717ULL;
+}
+
+
+//------------------------------------------------------------------------------
+// Build the lfn of a key
+//------------------------------------------------------------------------------
+static std::string
+MakeLfn( uint64_t key )
+{
+  char buff[256];
+  snprintf( buff, sizeof( buff ), "/atlas/dq2/mc12_8TeV/NTUP_SMWZ/mc12_8TeV.%06llu."
+            "PowhegPythia8_AU2CT10.merge.NTUP_SMWZ.e1169_s1469_r3542_p1328/"
+            "NTUP_SMWZ.%010llu._000001.root.1",
+            static_cast<unsigned long long>( key / 200 ),
+            static_cast<unsigned long long>( key ) );
+  return buff;
+}
+
+
+//------------------------------------------------------------------------------
+// Look up random lfns until the step is stopped
+//------------------------------------------------------------------------------
+static void*
+RunWorker( void* arg )
+{
+  Worker& worker = *static_cast<Worker*>( arg );
+  Step& step = *worker.mStep;
+  const std::vector<std::string>& lfns = *step.mLfns;
+  uint64_t write_limit = static_cast<uint64_t>( step.mWriteFraction * 1000000 );
+  uint64_t seed = worker.mSeed;
+  char pfn[4096];
+  size_t pfn_len;
+
+  while ( !step.mStart ) {
+    sched_yield();
+  }
+
+  while ( !step.mStop ) {
+    for ( uint64_t i = 0; i < sCheckInterval; i++ ) {
+      uint64_t rand = NextRandom( seed );
+
+      //........................................................................
+      // The new lfns of the writers are beyond the key space, they only cause
+      // evictions
+      //........................................................................
+      if ( write_limit && ( ( rand >> 40 ) % 1000000 < write_limit ) ) {
+        std::string lfn = MakeLfn( lfns.size() + worker.mInserts * 1024 + worker.mIndex );
+        step.mCache->Insert( lfn, sPfnPrefix + lfn.substr( 10 ) );
+        worker.mInserts++;
+        continue;
+      }
+
+      const std::string& lfn = lfns[rand % lfns.size()];
+      bool hit;
+
+      if ( step.mLocks ) {
+        XrdSysRWLock& lock = step.mLocks[LfcHash( lfn.c_str(), lfn.length() ) %
+                                         step.mNumLocks].mLock;
+        lock.ReadLock();
+        hit = step.mCache->GetEntry( lfn.c_str(), lfn.length(), pfn, sizeof( pfn ),
+                                     pfn_len );
+        lock.UnLock();
+      } else {
+        hit = step.mCache->GetEntry( lfn.c_str(), lfn.length(), pfn, sizeof( pfn ),
+                                     pfn_len );
+      }
+
+      worker.mLookups++;
+      worker.mHits += hit;
+    }
+  }
+
+  return NULL;
+}
+
+
+//------------------------------------------------------------------------------
+// Run the lookups with a number of threads and get the lookups per second
+//------------------------------------------------------------------------------
+static double
+RunStep( Step& step, unsigned int numThreads, int durationMs, double& hitRatio )
+{
+  std::vector<Worker> workers( numThreads );
+  step.mStart = false;
+  step.mStop = false;
+
+  for ( unsigned int i = 0; i < numThreads; i++ ) {
+    Worker& worker = workers[i];
+    worker.mStep = &step;
+    worker.mIndex = i;
+    worker.mSeed = 0x9E3779B97F4A7C15ULL * ( i + 1 );
+    worker.mLookups = 0;
+    worker.mHits = 0;
+    worker.mInserts = 0;
+
+    if ( pthread_create( &worker.mThread, NULL, RunWorker, &worker ) ) {
+      fprintf( stderr, "Error: unable to start thread %u\n", i );
+      exit( 1 );
+    }
+  }
+
+  uint64_t start = LfcStats::Now();
+  step.mStart = true;
+  usleep( durationMs * 1000 );
+  step.mStop = true;
+  uint64_t lookups = 0;
+  uint64_t hits = 0;
+
+  for ( unsigned int i = 0; i < numThreads; i++ ) {
+    pthread_join( workers[i].mThread, NULL );
+    lookups += workers[i].mLookups;
+    hits += workers[i].mHits;
+  }
+
+  double seconds = ( LfcStats::Now() - start ) / 1e9;
+  hitRatio = lookups ? static_cast<double>( hits ) / lookups : 0.0;
+  return lookups / seconds;
+}
+
+
+//------------------------------------------------------------------------------
+// Main
+//------------------------------------------------------------------------------
+int
+main( int argc, char* argv[] )
+{
+  uint64_t num_entries = 500000;
+  int duration_ms = 1000;
+  unsigned int max_threads = 64;
+  unsigned int num_shards = 16;
+  double write_fraction = 0;
+  std::string policy = "fifo";
+  LfcCache::Policy cache_policy = LfcCache::eFifo;
+  int opt;
+
+  while ( ( opt = getopt( argc, argv, "e:d:T:S:P:w:" ) ) != -1 ) {
+    switch ( opt ) {
+      case 'e':
+        num_entries = strtoull( optarg, NULL, 10 );
+        break;
+      case 'd':
+        duration_ms = atoi( optarg );
+        break;
+      case 'T':
+        max_threads = strtoul( optarg, NULL, 10 );
+        break;
+      case 'S':
+        num_shards = strtoul( optarg, NULL, 10 );
+        break;
+      case 'P':
+        policy = optarg;
+        break;
+      case 'w':
+        write_fraction = strtod( optarg, NULL );
+        break;
+      default:
+        fprintf( stderr, "Usage: %s [-e entries] [-d duration_ms] [-T max_threads] "
+                 "[-S shards] [-P fifo|s3fifo|tinylfu] [-w write_fraction]\n",
+                 argv[0] );
+        return 1;
+    }
+  }
+
+  if ( policy == "fifo" ) {
+    cache_policy = LfcCache::eFifo;
+  } else if ( policy == "s3fifo" ) {
+    cache_policy = LfcCache::eS3Fifo;
+  } else if ( policy == "tinylfu" ) {
+    cache_policy = LfcCache::eTinyLfu;
+  } else {
+    fprintf( stderr, "Error: unknown policy %s\n", policy.c_str() );
+    return 1;
+  }
+
+  if ( !num_entries || ( duration_ms <= 0 ) || !max_threads || !num_shards ||
+       ( write_fraction < 0 ) || ( write_fraction > 1 ) )
+  {
+    fprintf( stderr, "Error: invalid parameters\n" );
+    return 1;
+  }
+
+  fprintf( stdout, "entries=%llu duration_ms=%d max_threads=%u shards=%u policy=%s "
+           "write_fraction=%.3f cpus=%ld\n",
+           static_cast<unsigned long long>( num_entries ), duration_ms, max_threads,
+           num_shards, policy.c_str(), write_fraction, sysconf( _SC_NPROCESSORS_ONLN ) );
+
+  //............................................................................
+  // The cache holds the whole key space with room to spare for the shards
+  // getting more than their share, every lookup is a hit unless the writers
+  // evicted the lfn
+  //............................................................................
+  std::vector<std::string> lfns;
+  LfcCache* cache = new LfcCache( 24 * 3600, num_entries + num_entries / 4,
+                                  num_shards, cache_policy );
+
+  for ( uint64_t i = 0; i < num_entries; i++ ) {
+    lfns.push_back( MakeLfn( i ) );
+    cache->Insert( lfns.back(), sPfnPrefix + lfns.back().substr( 10 ) );
+  }
+
+  std::vector<PaddedLock> locks( num_shards );
+  Step step;
+  step.mCache = cache;
+  step.mLfns = &lfns;
+  step.mNumLocks = num_shards;
+  step.mWriteFraction = write_fraction;
+  fprintf( stdout, "%8s %14s %8s %10s %14s %8s %10s\n", "threads", "lockfree_ops/s",
+           "speedup", "hit_ratio", "rwlock_ops/s", "speedup", "hit_ratio" );
+  double base_free = 0;
+  double base_locked = 0;
+
+  for ( unsigned int num_threads = 1; num_threads <= max_threads; num_threads *= 2 ) {
+    double free_ratio;
+    double locked_ratio;
+    step.mLocks = NULL;
+    double free_ops = RunStep( step, num_threads, duration_ms, free_ratio );
+    step.mLocks = &locks[0];
+    double locked_ops = RunStep( step, num_threads, duration_ms, locked_ratio );
+
+    if ( num_threads == 1 ) {
+      base_free = free_ops;
+      base_locked = locked_ops;
+    }
+
+    fprintf( stdout, "%8u %14.0f %8.2f %10.3f %14.0f %8.2f %10.3f\n", num_threads,
+             free_ops, free_ops / base_free, free_ratio,
+             locked_ops, locked_ops / base_locked, locked_ratio );
+  }
+
+  delete cache;
+  return 0;
+}
@@ -0,0 +1,222 @@
+//------------------------------------------------------------------------------
+// File: LfcIndexBench.cc
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+//------------------------------------------------------------------------------
+//! Benchmark comparing the LfcCache lookup latency and memory per entry with
+//! the layout used before the hash index: a std::map keyed by the lfn plus a
+//! std::list aging queue, looked up with count() followed by find().
+//!
+//! Usage: LfcIndexBench [-e entries] [-n lookups]
+//------------------------------------------------------------------------------
+
+/*----------------------------------------------------------------------------*/
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+/*----------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+/*----------------------------------------------------------------------------*/
+#include "LfcCache.hh"
+#include "LfcAllocCount.hh"
+/*----------------------------------------------------------------------------*/
+
+//------------------------------------------------------------------------------
+//! Cache layout used before the hash index
+//------------------------------------------------------------------------------
+class MapCache
+{
+  public:
+
+    typedef std::list< std::pair<std::string, time_t> > ListType;
+    typedef std::map<std::string, std::pair< std::string, ListType::iterator > > MapType;
+
+    void Insert( std::string lfn, std::string pfn ) {
+      if ( !mLfn2Pfn.count( lfn ) ) {
+        ListType::iterator iterQ = mAgingQueue.insert( mAgingQueue.end(),
+                                                       std::make_pair( lfn, time( NULL ) ) );
+        mLfn2Pfn.insert( std::make_pair( lfn, std::make_pair( pfn, iterQ ) ) );
+      }
+    }
+
+    bool GetEntry( std::string lfn, std::string& pfn ) {
+      if ( mLfn2Pfn.count( lfn ) ) {
+        MapType::iterator iterMap = mLfn2Pfn.find( lfn );
+        pfn = iterMap->second.first;
+        return true;
+      }
+
+      return false;
+    }
+
+  private:
+
+    MapType  mLfn2Pfn;
+    ListType mAgingQueue;
+};
+
+
+//------------------------------------------------------------------------------
+// Current time in nanoseconds
+//------------------------------------------------------------------------------
+static uint64_t
+NowNs()
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return static_cast<uint64_t>( ts.tv_sec ) * 1000000000ULL + ts.tv_nsec;
+}
+
+
+//------------------------------------------------------------------------------
+// Build an ATLAS like lfn for the given index
+//------------------------------------------------------------------------------
+static std::string
+MakeLfn( uint64_t index )
+{
+  char buff[256];
+  snprintf( buff, sizeof( buff ), "/atlas/dq2/mc12_8TeV/NTUP_SMWZ/mc12_8TeV.%06llu."
+            "PowhegPythia8_AU2CT10.merge.NTUP_SMWZ.e1169_s1469_r3542_p1328_tid%08llu_00/"
+            "NTUP_SMWZ.%08llu._000001.root.1",
+            static_cast<unsigned long long>( index / 100 ),
+            static_cast<unsigned long long>( index / 100 ),
+            static_cast<unsigned long long>( index ) );
+  return buff;
+}
+
+
+//------------------------------------------------------------------------------
+// Run the lookups and print the results for one cache implementation
+//------------------------------------------------------------------------------
+template <typename CacheT>
+static void
+RunBench( const char* name, CacheT* cache, int64_t bytes,
+          const std::vector<std::string>& lfns,
+          const std::vector<std::string>& missing,
+          uint64_t numLookups )
+{
+  std::string pfn;
+  uint64_t found = 0;
+  uint64_t start = NowNs();
+
+  for ( uint64_t i = 0; i < numLookups; i++ ) {
+    found += cache->GetEntry( lfns[i % lfns.size()], pfn );
+  }
+
+  uint64_t hit_ns = NowNs() - start;
+  start = NowNs();
+
+  for ( uint64_t i = 0; i < numLookups; i++ ) {
+    found += cache->GetEntry( missing[i % missing.size()], pfn );
+  }
+
+  uint64_t miss_ns = NowNs() - start;
+
+  if ( found != numLookups ) {
+    fprintf( stderr, "Error: %s found %llu entries instead of %llu\n", name,
+             static_cast<unsigned long long>( found ),
+             static_cast<unsigned long long>( numLookups ) );
+  }
+
+  fprintf( stdout, "%8s %14.1f %14.1f %16.1f\n", name,
+           static_cast<double>( hit_ns ) / numLookups,
+           static_cast<double>( miss_ns ) / numLookups,
+           static_cast<double>( bytes ) / lfns.size() );
+}
+
+
+//------------------------------------------------------------------------------
+// Main
+//------------------------------------------------------------------------------
+int
+main( int argc, char* argv[] )
+{
+  uint64_t num_entries = 500000;
+  uint64_t num_lookups = 2000000;
+  int opt;
+
+  while ( ( opt = getopt( argc, argv, "e:n:" ) ) != -1 ) {
+    switch ( opt ) {
+      case 'e':
+        num_entries = strtoull( optarg, NULL, 10 );
+        break;
+      case 'n':
+        num_lookups = strtoull( optarg, NULL, 10 );
+        break;
+      default:
+        fprintf( stderr, "Usage: %s [-e entries] [-n lookups]\n", argv[0] );
+        return 1;
+    }
+  }
+
+  std::vector<std::string> lfns;
+  std::vector<std::string> missing;
+
+  for ( uint64_t i = 0; i < num_entries; i++ ) {
+    lfns.push_back( MakeLfn( i ) );
+    missing.push_back( MakeLfn( num_entries + i ) );
+  }
+
+  //............................................................................
+  // The pfn is the lfn with /atlas/dq2 replaced by the storage element path
+  //............................................................................
+  std::string pfn_prefix = "/eos/atlas/atlasdatadisk";
+  fprintf( stdout, "entries=%llu lookups=%llu\n",
+           static_cast<unsigned long long>( num_entries ),
+           static_cast<unsigned long long>( num_lookups ) );
+  fprintf( stdout, "%8s %14s %14s %16s\n", "index", "hit_ns/lookup",
+           "miss_ns/lookup", "bytes/entry" );
+
+  //............................................................................
+  // Insert in the original order and look up in a random one
+  //............................................................................
+  int64_t bytes = LfcAllocLiveBytes();
+  MapCache* map_cache = new MapCache();
+
+  for ( uint64_t i = 0; i < num_entries; i++ ) {
+    map_cache->Insert( lfns[i], pfn_prefix + lfns[i].substr( 10 ) );
+  }
+
+  bytes = LfcAllocLiveBytes() - bytes;
+  std::random_shuffle( lfns.begin(), lfns.end() );
+  RunBench( "map", map_cache, bytes, lfns, missing, num_lookups );
+  delete map_cache;
+
+  bytes = LfcAllocLiveBytes();
+  LfcCache* hash_cache = new LfcCache( 24 * 3600, num_entries );
+
+  for ( uint64_t i = 0; i < num_entries; i++ ) {
+    hash_cache->Insert( lfns[i], pfn_prefix + lfns[i].substr( 10 ) );
+  }
+
+  bytes = LfcAllocLiveBytes() - bytes;
+  std::random_shuffle( lfns.begin(), lfns.end() );
+  RunBench( "hash", hash_cache, bytes, lfns, missing, num_lookups );
+  delete hash_cache;
+  return 0;
+}
@@ -0,0 +1,394 @@
+//------------------------------------------------------------------------------
+// File: LfcLoadBench.cc
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+//------------------------------------------------------------------------------
+//! End-to-end load generator calling Locate from many threads with the LFC
+//! replaced by the in-memory mock of LfcMock.cc, so that the cache, the
+//! rewrites, the coalescing and the session pool run like in the cmsd. The
+//! catalog holds ATLAS-like files under /grid/atlas/dq2 which are requested
+//! as /atlas/dq2, so each miss of the cache needs the /grid rewrite, and a
+//! fraction of the requested lfns are not in the catalog at all. The lfns
+//! are requested uniformly at random, the cache is kept smaller than the
+//! catalog with -c to keep a steady rate of LFC queries.
+//!
+//! Scaling of the session pool is measured by giving -s a comma separated
+//! list of pool sizes, e.g. -s 1,2,4,8,16, against a server with a fixed
+//! number of threads (-S) and latency (-l). Every pool size runs with a new
+//! plugin, hence a cold cache, and a summary compares their throughput.
+//!
+//! Usage: LfcLoadBench [-t threads] [-n locates_per_thread] [-k catalog_files]
+//!                     [-x missing_fraction] [-l latency_us] [-j jitter_us]
+//!                     [-P per_file_us] [-C connect_us] [-f failure_rate]
+//!                     [-S server_threads] [-s lfc_sessions[,...]]
+//!                     [-c cache_maxsize]
+//!                     [-p "extra plugin params"] [-d debug_level]
+//------------------------------------------------------------------------------
+
+/*----------------------------------------------------------------------------*/
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+/*----------------------------------------------------------------------------*/
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <unistd.h>
+/*----------------------------------------------------------------------------*/
+#include "XrdCms/XrdCmsClient.hh"
+#include "XrdOuc/XrdOucErrInfo.hh"
+#include "XrdSfs/XrdSfsInterface.hh"
+#include "XrdSys/XrdSysLogger.hh"
+/*----------------------------------------------------------------------------*/
+#include "EosLfcPlugin.hh"
+#include "LfcMock.hh"
+#include "LfcStats.hh"
+/*----------------------------------------------------------------------------*/
+
+//! Replica of the files in the catalog, the lfn is appended
+static const char sSfnPrefix[] = "srm://srm-eosatlas.cern.ch/eos/atlas/atlasdatadisk";
+
+//------------------------------------------------------------------------------
+//! State of one load thread
+//------------------------------------------------------------------------------
+struct Worker {
+  XrdCmsClient* mPlugin;                ///< plugin under test
+  const std::vector<std::string>* mLfns; ///< lfns to request
+  uint64_t mNumOps;                     ///< number of Locate calls
+  uint64_t mSeed;                       ///< state of the random generator
+  uint64_t mRedirectEos;                ///< redirections to EOS
+  uint64_t mRedirectMgr;                ///< redirections to the meta manager
+  LfcHistogram mLatency;                ///< latency of Locate in ns
+  pthread_t mThread;                    ///< thread running the worker
+};
+
+
+//------------------------------------------------------------------------------
+// Build the lfn of a file as requested by the clients, the catalog has it
+// under /grid
+//------------------------------------------------------------------------------
+static std::string
+MakeLfn( uint64_t index )
+{
+  char buff[256];
+  snprintf( buff, sizeof( buff ), "/atlas/dq2/mc12_8TeV/NTUP_SMWZ/mc12_8TeV.%06llu."
+            "PowhegPythia8_AU2CT10.merge.NTUP_SMWZ.e1169_s1469_r3542_p1328/"
+            "NTUP_SMWZ.%08llu._000001.root.1",
+            static_cast<unsigned long long>( index / 100 ),
+            static_cast<unsigned long long>( index ) );
+  return buff;
+}
+
+
+//------------------------------------------------------------------------------
+// Request random lfns until done
+//------------------------------------------------------------------------------
+static void*
+RunWorker( void* arg )
+{
+  Worker& worker = *static_cast<Worker*>( arg );
+  const std::vector<std::string>& lfns = *worker.mLfns;
+
+  for ( uint64_t i = 0; i < worker.mNumOps; i++ ) {
+    worker.mSeed ^= worker.mSeed >> 12;
+    worker.mSeed ^= worker.mSeed << 25;
+    worker.mSeed ^= worker.mSeed >> 27;
+    const std::string& lfn = lfns[( worker.mSeed * 0x2545F4914F6CDD1DULL ) % lfns.size()];
+    XrdOucErrInfo resp;
+    uint64_t start = LfcStats::Now();
+    worker.mPlugin->Locate( resp, lfn.c_str(), 0, NULL );
+    worker.mLatency.Record( LfcStats::Now() - start );
+
+    if ( strstr( resp.getErrText(), "?eos.lfn=" ) ) {
+      worker.mRedirectEos++;
+    } else {
+      worker.mRedirectMgr++;
+    }
+  }
+
+  return NULL;
+}
+
+
+//------------------------------------------------------------------------------
+// Configure a new plugin, run the load threads against it and print the
+// results
+//------------------------------------------------------------------------------
+static bool
+RunLoad( XrdSysLogger* logger, const std::string& params, unsigned int numThreads,
+         uint64_t numOps, const std::vector<std::string>& lfns,
+         double& locateRate, double& queryRate )
+{
+  LfcMock& mock = LfcMock::Get();
+  std::vector<char> params_buff( params.begin(), params.end() );
+  params_buff.push_back( '\0' );
+  EosLfcPlugin* plugin = new EosLfcPlugin( logger );
+
+  if ( !plugin->Configure( NULL, &params_buff[0], NULL ) ) {
+    fprintf( stderr, "Error: unable to configure the plugin with: %s\n",
+             params.c_str() );
+    delete plugin;
+    return false;
+  }
+
+  fprintf( stdout, "params: %s\n", params.c_str() );
+
+  //............................................................................
+  // Run the threads, the sessions of the pool are already open
+  //............................................................................
+  std::vector<Worker*> workers;
+  mock.ResetCounters();
+  uint64_t start = LfcStats::Now();
+
+  for ( unsigned int i = 0; i < numThreads; i++ ) {
+    Worker* worker = new Worker();
+    worker->mPlugin = plugin;
+    worker->mLfns = &lfns;
+    worker->mNumOps = numOps;
+    worker->mSeed = 0x9E3779B97F4A7C15ULL * ( i + 1 );
+    worker->mRedirectEos = 0;
+    worker->mRedirectMgr = 0;
+    workers.push_back( worker );
+
+    if ( pthread_create( &worker->mThread, NULL, RunWorker, worker ) ) {
+      fprintf( stderr, "Error: unable to start thread %u\n", i );
+      exit( 1 );
+    }
+  }
+
+  LfcHistogram latency;
+  uint64_t redirect_eos = 0;
+  uint64_t redirect_mgr = 0;
+
+  for ( unsigned int i = 0; i < workers.size(); i++ ) {
+    pthread_join( workers[i]->mThread, NULL );
+    latency.Add( workers[i]->mLatency );
+    redirect_eos += workers[i]->mRedirectEos;
+    redirect_mgr += workers[i]->mRedirectMgr;
+    delete workers[i];
+  }
+
+  double seconds = ( LfcStats::Now() - start ) / 1e9;
+  LfcMock::Counters counters;
+  mock.GetCounters( counters );
+  locateRate = latency.GetCount() / seconds;
+  queryRate = counters.mQueries / seconds;
+  fprintf( stdout, "run: locates=%llu seconds=%.2f redirects/s=%.0f eos=%llu "
+           "meta_mgr=%llu\n", static_cast<unsigned long long>( latency.GetCount() ),
+           seconds, locateRate, static_cast<unsigned long long>( redirect_eos ),
+           static_cast<unsigned long long>( redirect_mgr ) );
+  fprintf( stdout, "latency_us: mean=%.1f p50=%.1f p90=%.1f p99=%.1f p999=%.1f max=%.1f\n",
+           latency.GetCount() ? latency.GetSum() / 1e3 / latency.GetCount() : 0.0,
+           latency.GetPercentile( 0.5 ) / 1e3, latency.GetPercentile( 0.9 ) / 1e3,
+           latency.GetPercentile( 0.99 ) / 1e3, latency.GetPercentile( 0.999 ) / 1e3,
+           latency.GetMax() / 1e3 );
+  fprintf( stdout, "lfc: queries=%llu queries/s=%.0f bulk_queries=%llu bulk_files=%llu "
+           "dirs=%llu pings=%llu sessions=%llu connects=%llu failures=%llu "
+           "max_active=%llu\n",
+           static_cast<unsigned long long>( counters.mQueries ), queryRate,
+           static_cast<unsigned long long>( counters.mBulkQueries ),
+           static_cast<unsigned long long>( counters.mBulkFiles ),
+           static_cast<unsigned long long>( counters.mDirs ),
+           static_cast<unsigned long long>( counters.mPings ),
+           static_cast<unsigned long long>( counters.mSessions ),
+           static_cast<unsigned long long>( counters.mConnects ),
+           static_cast<unsigned long long>( counters.mFailures ),
+           static_cast<unsigned long long>( counters.mMaxActive ) );
+  delete plugin;
+  return true;
+}
+
+
+//------------------------------------------------------------------------------
+// Main
+//------------------------------------------------------------------------------
+int
+main( int argc, char* argv[] )
+{
+  unsigned int num_threads = 32;
+  uint64_t num_ops = 20000;
+  uint64_t num_files = 100000;
+  double missing = 0.05;
+  std::vector<std::string> sessions;
+  const char* cache_maxsize = NULL;
+  const char* extra_params = "";
+  const char* debug_level = "0";
+  LfcMock::Config mock_config;
+  mock_config.mLatency = 1000;
+  mock_config.mJitter = 500;
+  mock_config.mPerFile = 50;
+  mock_config.mConnect = 5000;
+  mock_config.mFailure = 0;
+  mock_config.mServerThreads = 20;
+  int opt;
+
+  while ( ( opt = getopt( argc, argv, "t:n:k:x:l:j:P:C:f:S:s:c:p:d:" ) ) != -1 ) {
+    switch ( opt ) {
+      case 't':
+        num_threads = strtoul( optarg, NULL, 10 );
+        break;
+      case 'n':
+        num_ops = strtoull( optarg, NULL, 10 );
+        break;
+      case 'k':
+        num_files = strtoull( optarg, NULL, 10 );
+        break;
+      case 'x':
+        missing = strtod( optarg, NULL );
+        break;
+      case 'l':
+        mock_config.mLatency = strtoul( optarg, NULL, 10 );
+        break;
+      case 'j':
+        mock_config.mJitter = strtoul( optarg, NULL, 10 );
+        break;
+      case 'P':
+        mock_config.mPerFile = strtoul( optarg, NULL, 10 );
+        break;
+      case 'C':
+        mock_config.mConnect = strtoul( optarg, NULL, 10 );
+        break;
+      case 'f':
+        mock_config.mFailure = strtod( optarg, NULL );
+        break;
+      case 'S':
+        mock_config.mServerThreads = strtoul( optarg, NULL, 10 );
+        break;
+      case 's': {
+        std::string list = optarg;
+        size_t pos = 0;
+        size_t comma;
+
+        while ( ( comma = list.find( ',', pos ) ) != std::string::npos ) {
+          sessions.push_back( list.substr( pos, comma - pos ) );
+          pos = comma + 1;
+        }
+
+        sessions.push_back( list.substr( pos ) );
+        break;
+      }
+      case 'c':
+        cache_maxsize = optarg;
+        break;
+      case 'p':
+        extra_params = optarg;
+        break;
+      case 'd':
+        debug_level = optarg;
+        break;
+      default:
+        fprintf( stderr, "Usage: %s [-t threads] [-n locates_per_thread] "
+                 "[-k catalog_files] [-x missing_fraction] [-l latency_us] "
+                 "[-j jitter_us] [-P per_file_us] [-C connect_us] [-f failure_rate] "
+                 "[-S server_threads] [-s lfc_sessions[,...]] [-c cache_maxsize] "
+                 "[-p \"extra plugin params\"] [-d debug_level]\n", argv[0] );
+        return 1;
+    }
+  }
+
+  if ( !num_threads || !num_files || ( missing < 0 ) || ( missing >= 1 ) ) {
+    fprintf( stderr, "Error: invalid parameters\n" );
+    return 1;
+  }
+
+  //............................................................................
+  // Fill the catalog, the missing lfns follow the ones of the catalog
+  //............................................................................
+  LfcMock& mock = LfcMock::Get();
+  mock.Configure( mock_config );
+  std::vector<std::string> lfns;
+  uint64_t num_missing = static_cast<uint64_t>( num_files * missing / ( 1 - missing ) );
+
+  for ( uint64_t i = 0; i < num_files + num_missing; i++ ) {
+    lfns.push_back( MakeLfn( i ) );
+
+    if ( i < num_files ) {
+      mock.Add( "/grid" + lfns.back(), sSfnPrefix + lfns.back().substr( 10 ) );
+    }
+  }
+
+  //............................................................................
+  // The plugin is configured like in the cmsd, the messages are thrown away
+  //............................................................................
+  XrdSysLogger logger( open( "/dev/null", O_WRONLY ) );
+  std::string params = "rdrhost=eosatlas.cern.ch rdrport=1094 root=/eos/ "
+                       "match=srm://srm-eosatlas.cern.ch";
+
+  if ( cache_maxsize ) {
+    params += std::string( " cache_maxsize=" ) + cache_maxsize;
+  }
+
+  if ( *extra_params ) {
+    params += std::string( " " ) + extra_params;
+  }
+
+  setenv( "N2N_UPLINK_HOST", "atlas-xrd-eu.cern.ch", 1 );
+  setenv( "LFCDEBUG", debug_level, 1 );
+  setenv( "LFC_HOST", "lfc-mock", 1 );
+  fprintf( stdout, "threads=%u locates_per_thread=%llu catalog_files=%llu "
+           "missing_files=%llu latency=%uus jitter=%uus per_file=%uus connect=%uus "
+           "failure=%.3f server_threads=%u\n", num_threads,
+           static_cast<unsigned long long>( num_ops ),
+           static_cast<unsigned long long>( num_files ),
+           static_cast<unsigned long long>( num_missing ), mock_config.mLatency,
+           mock_config.mJitter, mock_config.mPerFile, mock_config.mConnect,
+           mock_config.mFailure, mock_config.mServerThreads );
+
+  //............................................................................
+  // One run per pool size, the default one of the plugin if none given
+  //............................................................................
+  if ( sessions.empty() ) {
+    sessions.push_back( "" );
+  }
+
+  std::vector<double> locate_rates( sessions.size() );
+  std::vector<double> query_rates( sessions.size() );
+
+  for ( size_t i = 0; i < sessions.size(); i++ ) {
+    std::string run_params = params;
+
+    if ( !sessions[i].empty() ) {
+      run_params += " lfc_sessions=" + sessions[i];
+    }
+
+    if ( !RunLoad( &logger, run_params, num_threads, num_ops, lfns,
+                   locate_rates[i], query_rates[i] ) )
+    {
+      return 1;
+    }
+  }
+
+  if ( sessions.size() > 1 ) {
+    fprintf( stdout, "%8s %14s %14s %10s\n", "sessions", "redirects/s",
+             "lfc_queries/s", "speedup" );
+
+    for ( size_t i = 0; i < sessions.size(); i++ ) {
+      fprintf( stdout, "%8s %14.0f %14.0f %10.2f\n", sessions[i].c_str(),
+               locate_rates[i], query_rates[i],
+               locate_rates[0] ? locate_rates[i] / locate_rates[0] : 0.0 );
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,170 @@
+//------------------------------------------------------------------------------
+// File: LfcLocateBench.cc
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+//------------------------------------------------------------------------------
+//! Benchmark counting the memory allocations and measuring the latency of
+//! Locate when the lfn is in cache. The plugin is loaded through its factory
+//! function and configured like in the cmsd, the cache is filled with lfns
+//! which already contain the storage root so that no LFC server is needed.
+//! The target is no allocation at all per Locate, the program fails if any
+//! is seen. The LFCDEBUG level is 0 by default, so that the cost of the cache
+//! hit is measured with logging off, and can be raised with -d to compare.
+//!
+//! Usage: LfcLocateBench [-e entries] [-n lookups] [-d debug_level]
+//------------------------------------------------------------------------------
+
+/*----------------------------------------------------------------------------*/
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+/*----------------------------------------------------------------------------*/
+#include <fcntl.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+/*----------------------------------------------------------------------------*/
+#include "XrdCms/XrdCmsClient.hh"
+#include "XrdOuc/XrdOucErrInfo.hh"
+#include "XrdSfs/XrdSfsInterface.hh"
+#include "XrdSys/XrdSysLogger.hh"
+/*----------------------------------------------------------------------------*/
+#include "LfcAllocCount.hh"
+/*----------------------------------------------------------------------------*/
+
+extern "C" XrdCmsClient* XrdCmsGetClient( XrdSysLogger* logger, int opMode,
+                                          int myPort, XrdOss* theSS );
+
+//------------------------------------------------------------------------------
+// Current time in nanoseconds
+//------------------------------------------------------------------------------
+static uint64_t
+NowNs()
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return static_cast<uint64_t>( ts.tv_sec ) * 1000000000ULL + ts.tv_nsec;
+}
+
+
+//------------------------------------------------------------------------------
+// Main
+//------------------------------------------------------------------------------
+int
+main( int argc, char* argv[] )
+{
+  uint64_t num_entries = 10000;
+  uint64_t num_lookups = 1000000;
+  const char* debug_level = "0";
+  int opt;
+
+  while ( ( opt = getopt( argc, argv, "e:n:d:" ) ) != -1 ) {
+    switch ( opt ) {
+      case 'e':
+        num_entries = strtoull( optarg, NULL, 10 );
+        break;
+      case 'n':
+        num_lookups = strtoull( optarg, NULL, 10 );
+        break;
+      case 'd':
+        debug_level = optarg;
+        break;
+      default:
+        fprintf( stderr, "Usage: %s [-e entries] [-n lookups] [-d debug_level]\n",
+                 argv[0] );
+        return 1;
+    }
+  }
+
+  //............................................................................
+  // The cache hits are logged only from LFCDEBUG=1 on, the messages are
+  // thrown away
+  //............................................................................
+  XrdSysLogger logger( open( "/dev/null", O_WRONLY ) );
+  char params[] = "rdrhost=eosatlas.cern.ch rdrport=1094 root=/eos/ "
+                  "match=srm://srm-eosatlas.cern.ch";
+  setenv( "N2N_UPLINK_HOST", "atlas-xrd-eu.cern.ch", 1 );
+  setenv( "LFCDEBUG", debug_level, 1 );
+
+  if ( !getenv( "LFC_HOST" ) ) {
+    setenv( "LFC_HOST", "localhost", 1 );
+  }
+
+  XrdCmsClient* plugin = XrdCmsGetClient( &logger, 0, 1094, NULL );
+
+  if ( !plugin->Configure( NULL, params, NULL ) ) {
+    fprintf( stderr, "Error: unable to configure the plugin\n" );
+    return 1;
+  }
+
+  //............................................................................
+  // The first Locate of each lfn inserts it in the cache
+  //............................................................................
+  std::vector<std::string> lfns;
+  char buff[512];
+
+  for ( uint64_t i = 0; i < num_entries; i++ ) {
+    snprintf( buff, sizeof( buff ), "/eos/atlas/atlasdatadisk/rucio/mc12_8TeV/%02x/%02x/"
+              "NTUP_SMWZ.%08llu._000001.root.1",
+              static_cast<unsigned int>( i % 256 ), static_cast<unsigned int>( i * 7 % 256 ),
+              static_cast<unsigned long long>( i ) );
+    lfns.push_back( buff );
+    XrdOucErrInfo resp;
+    plugin->Locate( resp, lfns.back().c_str(), 0, NULL );
+  }
+
+  uint64_t num_redirects = 0;
+  uint64_t allocs = LfcAllocCount();
+  uint64_t start = NowNs();
+
+  for ( uint64_t i = 0; i < num_lookups; i++ ) {
+    XrdOucErrInfo resp;
+
+    if ( plugin->Locate( resp, lfns[i % num_entries].c_str(), 0, NULL ) == SFS_REDIRECT ) {
+      num_redirects++;
+    }
+  }
+
+  uint64_t elapsed = NowNs() - start;
+  allocs = LfcAllocCount() - allocs;
+  XrdOucErrInfo resp;
+  plugin->Locate( resp, lfns[0].c_str(), 0, NULL );
+  fprintf( stdout, "entries=%llu lookups=%llu redirects=%llu LFCDEBUG=%s\n",
+           static_cast<unsigned long long>( num_entries ),
+           static_cast<unsigned long long>( num_lookups ),
+           static_cast<unsigned long long>( num_redirects ), debug_level );
+  fprintf( stdout, "redirect: %s\n", resp.getErrText() );
+  fprintf( stdout, "%14s %14s\n", "ns/locate", "allocs/locate" );
+  fprintf( stdout, "%14.1f %14.3f\n", static_cast<double>( elapsed ) / num_lookups,
+           static_cast<double>( allocs ) / num_lookups );
+
+  if ( allocs ) {
+    fprintf( stderr, "Error: %llu allocations in %llu cache hits\n",
+             static_cast<unsigned long long>( allocs ),
+             static_cast<unsigned long long>( num_lookups ) );
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,251 @@
+//------------------------------------------------------------------------------
+// File: LfcMatcherBench.cc
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+//------------------------------------------------------------------------------
+//! Benchmark comparing the replica filter used before LfcMatcher, one strstr
+//! per nomatch and match pattern, with the compiled LfcMatcher on a list of
+//! SURLs spread over many storage elements. Both filters must give the same
+//! result for every SURL.
+//!
+//! Usage: LfcMatcherBench [-m match_patterns] [-x nomatch_patterns]
+//!                        [-r replicas] [-n rounds]
+//------------------------------------------------------------------------------
+
+/*----------------------------------------------------------------------------*/
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+/*----------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+/*----------------------------------------------------------------------------*/
+#include "LfcMatcher.hh"
+#include "LfcString.hh"
+/*----------------------------------------------------------------------------*/
+
+//! Domains of the storage elements
+static const char* sDomains[] = {
+  "cern.ch", "in2p3.fr", "gridka.de", "triumf.ca", "bnl.gov", "nikhef.nl",
+  "ific.uv.es", "pic.es", "roma1.infn.it", "ndgf.org", "sara.nl", "rl.ac.uk",
+  "desy.de", "lrz.de", "cnaf.infn.it", "aglt2.org", "mwt2.org", "slac.stanford.edu"
+};
+
+//! Space tokens of the storage elements
+static const char* sTokens[] = {
+  "atlasdatadisk", "atlasscratchdisk", "atlasgroupdisk", "atlaslocalgroupdisk",
+  "atlasproddisk", "atlasdatatape", "atlasmctape"
+};
+
+static const size_t sNumDomains = sizeof( sDomains ) / sizeof( sDomains[0] );
+static const size_t sNumTokens = sizeof( sTokens ) / sizeof( sTokens[0] );
+
+
+//------------------------------------------------------------------------------
+// Current time in nanoseconds
+//------------------------------------------------------------------------------
+static uint64_t
+NowNs()
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return static_cast<uint64_t>( ts.tv_sec ) * 1000000000ULL + ts.tv_nsec;
+}
+
+
+//------------------------------------------------------------------------------
+// Host name of the given storage element
+//------------------------------------------------------------------------------
+static std::string
+MakeHost( size_t index )
+{
+  char buff[128];
+  snprintf( buff, sizeof( buff ), "srm%02u.%s", static_cast<unsigned int>( index / sNumDomains ),
+            sDomains[index % sNumDomains] );
+  return buff;
+}
+
+
+//------------------------------------------------------------------------------
+// Build a SURL like the ones registered in the LFC
+//------------------------------------------------------------------------------
+static std::string
+MakeSurl( size_t index, size_t numHosts )
+{
+  char buff[512];
+  snprintf( buff, sizeof( buff ), "srm://%s:8446/srm/managerv2?SFN=/pnfs/%s/data/atlas/"
+            "%s/rucio/mc12_8TeV/%02x/%02x/NTUP_SMWZ.%08u._%06u.root.1",
+            MakeHost( index % numHosts ).c_str(),
+            sDomains[( index % numHosts ) % sNumDomains],
+            sTokens[( index / 7 ) % sNumTokens],
+            static_cast<unsigned int>( index * 37 % 256 ),
+            static_cast<unsigned int>( index * 91 % 256 ),
+            static_cast<unsigned int>( index ),
+            static_cast<unsigned int>( index % 1000 ) );
+  return buff;
+}
+
+
+//------------------------------------------------------------------------------
+// Filter used before LfcMatcher
+//------------------------------------------------------------------------------
+static bool
+StrstrFilter( const char* sfn, const VectStrings& match,
+              const VectStrings& notMatch, const char*& matching )
+{
+  VectStrings::const_iterator it;
+  matching = "";
+
+  for ( it = notMatch.begin(); it != notMatch.end(); it++ ) {
+    if ( strstr( sfn, it->c_str() ) ) {
+      return false;
+    }
+  }
+
+  bool match_found = match.empty();
+
+  for ( it = match.begin(); it != match.end(); it++ ) {
+    if ( strstr( sfn, it->c_str() ) ) {
+      matching = it->c_str();
+      match_found = true;
+      break;
+    }
+  }
+
+  return match_found;
+}
+
+
+//------------------------------------------------------------------------------
+// Main
+//------------------------------------------------------------------------------
+int
+main( int argc, char* argv[] )
+{
+  size_t num_match = 40;
+  size_t num_nomatch = 4;
+  size_t num_replicas = 10000;
+  size_t num_rounds = 100;
+  int opt;
+
+  while ( ( opt = getopt( argc, argv, "m:x:r:n:" ) ) != -1 ) {
+    switch ( opt ) {
+      case 'm':
+        num_match = strtoul( optarg, NULL, 10 );
+        break;
+      case 'x':
+        num_nomatch = strtoul( optarg, NULL, 10 );
+        break;
+      case 'r':
+        num_replicas = strtoul( optarg, NULL, 10 );
+        break;
+      case 'n':
+        num_rounds = strtoul( optarg, NULL, 10 );
+        break;
+      default:
+        fprintf( stderr, "Usage: %s [-m match_patterns] [-x nomatch_patterns] "
+                 "[-r replicas] [-n rounds]\n", argv[0] );
+        return 1;
+    }
+  }
+
+  //............................................................................
+  // The match patterns select a part of the storage elements, the replicas
+  // are spread over twice as many, and the nomatch patterns exclude the tape
+  // and group space tokens
+  //............................................................................
+  VectStrings match;
+  VectStrings not_match;
+  std::vector<std::string> surls;
+
+  for ( size_t i = 0; i < num_match; i++ ) {
+    match.push_back( "srm://" + MakeHost( i ) );
+  }
+
+  for ( size_t i = 0; i < num_nomatch; i++ ) {
+    not_match.push_back( sTokens[( sNumTokens - 1 - i ) % sNumTokens] );
+  }
+
+  for ( size_t i = 0; i < num_replicas; i++ ) {
+    surls.push_back( MakeSurl( i, 2 * num_match + 1 ) );
+  }
+
+  LfcMatcher matcher;
+  matcher.Build( match, not_match );
+
+  //............................................................................
+  // Check that both filters agree before timing them
+  //............................................................................
+  size_t num_accepted = 0;
+
+  for ( size_t i = 0; i < num_replicas; i++ ) {
+    const char* matching_old;
+    const char* matching_new;
+    bool accepted = StrstrFilter( surls[i].c_str(), match, not_match, matching_old );
+    LfcMatcher::Result result = matcher.Scan( surls[i].c_str(), matching_new );
+
+    if ( ( accepted != ( result == LfcMatcher::eMatch ) ) ||
+         strcmp( matching_old, matching_new ) )
+    {
+      fprintf( stderr, "Error: filters disagree on %s\n", surls[i].c_str() );
+      return 1;
+    }
+
+    num_accepted += accepted;
+  }
+
+  uint64_t found = 0;
+  uint64_t start = NowNs();
+
+  for ( size_t round = 0; round < num_rounds; round++ ) {
+    for ( size_t i = 0; i < num_replicas; i++ ) {
+      const char* matching;
+      found += StrstrFilter( surls[i].c_str(), match, not_match, matching );
+    }
+  }
+
+  uint64_t old_ns = NowNs() - start;
+  start = NowNs();
+
+  for ( size_t round = 0; round < num_rounds; round++ ) {
+    for ( size_t i = 0; i < num_replicas; i++ ) {
+      const char* matching;
+      found += ( matcher.Scan( surls[i].c_str(), matching ) == LfcMatcher::eMatch );
+    }
+  }
+
+  uint64_t new_ns = NowNs() - start;
+  double num_scans = static_cast<double>( num_replicas ) * num_rounds;
+  fprintf( stdout, "match=%u nomatch=%u replicas=%u accepted=%u checksum=%llu\n",
+           static_cast<unsigned int>( num_match ),
+           static_cast<unsigned int>( num_nomatch ),
+           static_cast<unsigned int>( num_replicas ),
+           static_cast<unsigned int>( num_accepted ),
+           static_cast<unsigned long long>( found ) );
+  fprintf( stdout, "%8s %14s\n", "filter", "ns/replica" );
+  fprintf( stdout, "%8s %14.1f\n", "strstr", old_ns / num_scans );
+  fprintf( stdout, "%8s %14.1f\n", "matcher", new_ns / num_scans );
+  return 0;
+}
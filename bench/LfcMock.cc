@@ -0,0 +1,737 @@
+//------------------------------------------------------------------------------
+// File: LfcMock.cc
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+/*----------------------------------------------------------------------------*/
+#include <serrno.h>
+#include <sys/stat.h>
+#include <time.h>
+/*----------------------------------------------------------------------------*/
+#include "LfcMock.hh"
+/*----------------------------------------------------------------------------*/
+
+//! serrno of the calling thread
+static __thread int sSerrno = 0;
+
+//! The calling thread has an open session
+static __thread bool sSession = false;
+
+//! State of the random generator of the calling thread
+static __thread uint64_t sSeed = 0;
+
+//! Seeds handed out to the threads
+static uint64_t sNextSeed = 0;
+
+
+//------------------------------------------------------------------------------
+//! Open directory, the entries are listed when it is opened and the one
+//! returned by ReadDir stays valid until the next call, like in the LFC client
+//------------------------------------------------------------------------------
+struct LfcMock::Dir {
+  std::string mPath;                    ///< path of the directory ending in /
+  std::vector<std::string> mNames;      ///< names of the entries
+  size_t mPos;                          ///< next entry to return
+  std::vector<char> mEntry;             ///< last entry returned
+  std::vector<struct lfc_rep_info> mReps; ///< replicas of the last entry
+  std::vector<std::string> mHosts;      ///< hosts of the replicas
+  std::vector<std::string> mSfns;       ///< sfns of the replicas
+};
+
+
+//------------------------------------------------------------------------------
+// Next number of the random generator of the calling thread
+//------------------------------------------------------------------------------
+static uint64_t
+NextRandom()
+{
+  if ( !sSeed ) {
+    sSeed = 0x9E3779B97F4A7C15ULL * __sync_add_and_fetch( &sNextSeed, 1 );
+  }
+
+  sSeed ^= sSeed >> 12;
+  sSeed ^= sSeed << 25;
+  sSeed ^= sSeed >> 27;
+  return sSeed * 0x2545F4914F6CDD1DULL;
+}
+
+
+//------------------------------------------------------------------------------
+// Draw if a call fails
+//------------------------------------------------------------------------------
+static bool
+DrawFailure( double rate )
+{
+  return ( rate > 0 ) && ( NextRandom() < rate * 18446744073709551616.0 );
+}
+
+
+//------------------------------------------------------------------------------
+// Sleep for some microseconds
+//------------------------------------------------------------------------------
+static void
+SleepUs( uint64_t us )
+{
+  if ( us ) {
+    struct timespec ts;
+    ts.tv_sec = us / 1000000;
+    ts.tv_nsec = ( us % 1000000 ) * 1000;
+
+    while ( nanosleep( &ts, &ts ) && ( errno == EINTR ) ) { }
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Copy the host of an sfn like srm://host:port/path
+//------------------------------------------------------------------------------
+static void
+CopyHost( const std::string& sfn, char* host, size_t size )
+{
+  size_t start = sfn.find( "://" );
+
+  if ( start == std::string::npos ) {
+    host[0] = '\0';
+    return;
+  }
+
+  start += 3;
+  size_t end = sfn.find_first_of( ":/", start );
+  size_t len = ( end == std::string::npos ? sfn.length() : end ) - start;
+
+  if ( len >= size ) {
+    len = size - 1;
+  }
+
+  memcpy( host, sfn.c_str() + start, len );
+  host[len] = '\0';
+}
+
+
+//------------------------------------------------------------------------------
+// Get the mock
+//------------------------------------------------------------------------------
+LfcMock&
+LfcMock::Get()
+{
+  static LfcMock mock;
+  return mock;
+}
+
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+LfcMock::LfcMock():
+  mServerCond( 0 ),
+  mActive( 0 )
+{
+  memset( &mConfig, 0, sizeof( mConfig ) );
+  memset( &mCounters, 0, sizeof( mCounters ) );
+  const char* val;
+
+  if ( ( val = getenv( "LFC_MOCK_LATENCY" ) ) ) {
+    mConfig.mLatency = strtoul( val, NULL, 10 );
+  }
+
+  if ( ( val = getenv( "LFC_MOCK_JITTER" ) ) ) {
+    mConfig.mJitter = strtoul( val, NULL, 10 );
+  }
+
+  if ( ( val = getenv( "LFC_MOCK_PER_FILE" ) ) ) {
+    mConfig.mPerFile = strtoul( val, NULL, 10 );
+  }
+
+  if ( ( val = getenv( "LFC_MOCK_CONNECT" ) ) ) {
+    mConfig.mConnect = strtoul( val, NULL, 10 );
+  }
+
+  if ( ( val = getenv( "LFC_MOCK_FAILURE" ) ) ) {
+    mConfig.mFailure = strtod( val, NULL );
+  }
+
+  if ( ( val = getenv( "LFC_MOCK_SERVER_THREADS" ) ) ) {
+    mConfig.mServerThreads = strtoul( val, NULL, 10 );
+  }
+
+  if ( ( val = getenv( "LFC_MOCK_CATALOG" ) ) && ( Load( val ) < 0 ) ) {
+    fprintf( stderr, "LfcMock: unable to load catalog from %s\n", val );
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Set the behaviour of the mock server
+//------------------------------------------------------------------------------
+void
+LfcMock::Configure( const Config& config )
+{
+  mServerCond.Lock();
+  mConfig = config;
+  mServerCond.Broadcast();
+  mServerCond.UnLock();
+}
+
+
+//------------------------------------------------------------------------------
+// Add a replica of a file to the catalog
+//------------------------------------------------------------------------------
+void
+LfcMock::Add( const std::string& lfn, const std::string& sfn )
+{
+  mCatalogLock.WriteLock();
+  FileMap::iterator iter = mFiles.find( lfn );
+
+  if ( iter == mFiles.end() ) {
+    iter = mFiles.insert( std::make_pair( lfn, File() ) ).first;
+    iter->second.mFileId = mFileIds.size() + 1;
+    mFileIds.push_back( iter );
+
+    //..........................................................................
+    // Register the entry in its parent, up to the first parent which
+    // already exists
+    //..........................................................................
+    std::string path = lfn;
+    size_t pos;
+
+    while ( ( pos = path.rfind( '/' ) ) != std::string::npos ) {
+      std::string dir = pos ? path.substr( 0, pos ) : "/";
+      bool known = mDirs.count( dir );
+      mDirs[dir].insert( path.substr( pos + 1 ) );
+
+      if ( known || !pos ) {
+        break;
+      }
+
+      path = dir;
+    }
+  }
+
+  iter->second.mSfns.push_back( sfn );
+  mCatalogLock.UnLock();
+}
+
+
+//------------------------------------------------------------------------------
+// Load the catalog from a file
+//------------------------------------------------------------------------------
+int64_t
+LfcMock::Load( const char* path )
+{
+  std::ifstream file( path );
+  std::string line;
+  std::string lfn;
+  std::string sfn;
+  int64_t num_files = 0;
+
+  if ( !file.is_open() ) {
+    return -1;
+  }
+
+  while ( std::getline( file, line ) ) {
+    std::istringstream fields( line );
+
+    if ( !( fields >> lfn ) || ( lfn[0] == '#' ) ) {
+      continue;
+    }
+
+    bool added = false;
+
+    while ( fields >> sfn ) {
+      Add( lfn, sfn );
+      added = true;
+    }
+
+    num_files += added;
+  }
+
+  return num_files;
+}
+
+
+//------------------------------------------------------------------------------
+// Get the number of files in the catalog
+//------------------------------------------------------------------------------
+uint64_t
+LfcMock::GetNumFiles()
+{
+  mCatalogLock.ReadLock();
+  uint64_t num_files = mFiles.size();
+  mCatalogLock.UnLock();
+  return num_files;
+}
+
+
+//------------------------------------------------------------------------------
+// Get the calls seen so far
+//------------------------------------------------------------------------------
+void
+LfcMock::GetCounters( Counters& counters )
+{
+  mServerCond.Lock();
+  counters = mCounters;
+  mServerCond.UnLock();
+}
+
+
+//------------------------------------------------------------------------------
+// Reset the calls seen so far
+//------------------------------------------------------------------------------
+void
+LfcMock::ResetCounters()
+{
+  mServerCond.Lock();
+  memset( &mCounters, 0, sizeof( mCounters ) );
+  mServerCond.UnLock();
+}
+
+
+//------------------------------------------------------------------------------
+// Open a session for the calling thread
+//------------------------------------------------------------------------------
+int
+LfcMock::StartSession()
+{
+  __sync_fetch_and_add( &mCounters.mSessions, 1 );
+  SleepUs( mConfig.mConnect );
+
+  if ( DrawFailure( mConfig.mFailure ) ) {
+    __sync_fetch_and_add( &mCounters.mFailures, 1 );
+    sSerrno = SECOMERR;
+    return -1;
+  }
+
+  sSession = true;
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+// Close the session of the calling thread
+//------------------------------------------------------------------------------
+int
+LfcMock::EndSession()
+{
+  sSession = false;
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+// Wait for a server thread and for the latency of a call
+//------------------------------------------------------------------------------
+bool
+LfcMock::BeginCall( int numFiles, uint64_t& counter )
+{
+  __sync_fetch_and_add( &counter, 1 );
+
+  if ( !sSession ) {
+    __sync_fetch_and_add( &mCounters.mConnects, 1 );
+    SleepUs( mConfig.mConnect );
+  }
+
+  mServerCond.Lock();
+
+  while ( mConfig.mServerThreads && ( mActive >= mConfig.mServerThreads ) ) {
+    mServerCond.Wait();
+  }
+
+  mActive++;
+
+  if ( mActive > mCounters.mMaxActive ) {
+    mCounters.mMaxActive = mActive;
+  }
+
+  uint64_t latency = mConfig.mLatency;
+
+  if ( numFiles > 1 ) {
+    latency += static_cast<uint64_t>( numFiles - 1 ) * mConfig.mPerFile;
+  }
+
+  if ( mConfig.mJitter ) {
+    latency += NextRandom() % ( mConfig.mJitter + 1 );
+  }
+
+  double failure = mConfig.mFailure;
+  mServerCond.UnLock();
+  SleepUs( latency );
+
+  if ( DrawFailure( failure ) ) {
+    __sync_fetch_and_add( &mCounters.mFailures, 1 );
+    sSerrno = SECOMERR;
+    return true;
+  }
+
+  return false;
+}
+
+
+//------------------------------------------------------------------------------
+// Give back the server thread of a call
+//------------------------------------------------------------------------------
+void
+LfcMock::EndCall()
+{
+  mServerCond.Lock();
+  mActive--;
+  mServerCond.Signal();
+  mServerCond.UnLock();
+}
+
+
+//------------------------------------------------------------------------------
+// Get the guid of a file id
+//------------------------------------------------------------------------------
+std::string
+LfcMock::MakeGuid( uint64_t fileId )
+{
+  char guid[CA_MAXGUIDLEN + 1];
+  snprintf( guid, sizeof( guid ), "00000000-0000-4000-8000-%012llx",
+            static_cast<unsigned long long>( fileId & 0xFFFFFFFFFFFFULL ) );
+  return guid;
+}
+
+
+//------------------------------------------------------------------------------
+// Look up a file by lfn or by guid
+//------------------------------------------------------------------------------
+const LfcMock::File*
+LfcMock::FindFile( const char* path, const char* guid ) const
+{
+  if ( path ) {
+    FileMap::const_iterator iter = mFiles.find( path );
+    return ( iter == mFiles.end() ) ? NULL : &iter->second;
+  }
+
+  if ( !guid || ( strlen( guid ) != CA_MAXGUIDLEN ) ) {
+    return NULL;
+  }
+
+  uint64_t file_id = strtoull( guid + 24, NULL, 16 );
+
+  if ( !file_id || ( file_id > mFileIds.size() ) || ( MakeGuid( file_id ) != guid ) ) {
+    return NULL;
+  }
+
+  return &mFileIds[file_id - 1]->second;
+}
+
+
+//------------------------------------------------------------------------------
+// Query the replicas of a file
+//------------------------------------------------------------------------------
+int
+LfcMock::GetReplica( const char* path, const char* guid, int* nbEntries,
+                     struct lfc_filereplica** repEntries )
+{
+  int retc = -1;
+  *nbEntries = 0;
+  *repEntries = NULL;
+
+  if ( !BeginCall( 1, mCounters.mQueries ) ) {
+    mCatalogLock.ReadLock();
+    const File* file = FindFile( path, guid );
+
+    if ( !file ) {
+      sSerrno = ENOENT;
+    } else {
+      size_t num = file->mSfns.size();
+      struct lfc_filereplica* entries = static_cast<struct lfc_filereplica*>(
+                                          calloc( num ? num : 1, sizeof( struct lfc_filereplica ) ) );
+
+      if ( !entries ) {
+        sSerrno = ENOMEM;
+      } else {
+        for ( size_t i = 0; i < num; i++ ) {
+          entries[i].fileid = file->mFileId;
+          entries[i].status = '-';
+          entries[i].f_type = 'P';
+          CopyHost( file->mSfns[i], entries[i].host, sizeof( entries[i].host ) );
+          strncpy( entries[i].sfn, file->mSfns[i].c_str(), sizeof( entries[i].sfn ) - 1 );
+        }
+
+        *nbEntries = num;
+        *repEntries = entries;
+        retc = 0;
+      }
+    }
+
+    mCatalogLock.UnLock();
+  }
+
+  EndCall();
+  return retc;
+}
+
+
+//------------------------------------------------------------------------------
+// Query the replicas of several files at once
+//------------------------------------------------------------------------------
+int
+LfcMock::GetReplicas( int nbFiles, const char** paths, int* nbEntries,
+                      struct lfc_filereplicas** repEntries )
+{
+  int retc = -1;
+  *nbEntries = 0;
+  *repEntries = NULL;
+  __sync_fetch_and_add( &mCounters.mBulkFiles, nbFiles );
+
+  if ( !BeginCall( nbFiles, mCounters.mBulkQueries ) ) {
+    //..........................................................................
+    // Each file gives one entry per replica, sharing the guid, or one entry
+    // with the error code if it can't be resolved
+    //..........................................................................
+    std::vector<const File*> files( nbFiles );
+    size_t num = 0;
+    mCatalogLock.ReadLock();
+
+    for ( int i = 0; i < nbFiles; i++ ) {
+      files[i] = FindFile( paths[i], NULL );
+      num += ( files[i] && !files[i]->mSfns.empty() ) ? files[i]->mSfns.size() : 1;
+    }
+
+    struct lfc_filereplicas* entries = static_cast<struct lfc_filereplicas*>(
+                                         calloc( num ? num : 1, sizeof( struct lfc_filereplicas ) ) );
+
+    if ( !entries ) {
+      sSerrno = ENOMEM;
+    } else {
+      struct lfc_filereplicas* entry = entries;
+
+      for ( int i = 0; i < nbFiles; i++ ) {
+        if ( !files[i] || files[i]->mSfns.empty() ) {
+          entry->errcode = ENOENT;
+          entry++;
+          continue;
+        }
+
+        std::string guid = MakeGuid( files[i]->mFileId );
+
+        for ( size_t j = 0; j < files[i]->mSfns.size(); j++, entry++ ) {
+          strncpy( entry->guid, guid.c_str(), sizeof( entry->guid ) - 1 );
+          entry->status = '-';
+          CopyHost( files[i]->mSfns[j], entry->host, sizeof( entry->host ) );
+          strncpy( entry->sfn, files[i]->mSfns[j].c_str(), sizeof( entry->sfn ) - 1 );
+        }
+      }
+
+      *nbEntries = num;
+      *repEntries = entries;
+      retc = 0;
+    }
+
+    mCatalogLock.UnLock();
+  }
+
+  EndCall();
+  return retc;
+}
+
+
+//------------------------------------------------------------------------------
+// Open a directory
+//------------------------------------------------------------------------------
+lfc_DIR*
+LfcMock::OpenDir( const char* path, const char* guid )
+{
+  Dir* dir = NULL;
+
+  if ( !BeginCall( 1, mCounters.mDirs ) ) {
+    mCatalogLock.ReadLock();
+    DirMap::const_iterator iter = path ? mDirs.find( path ) : mDirs.end();
+
+    if ( iter == mDirs.end() ) {
+      sSerrno = ( path && mFiles.count( path ) ) ? ENOTDIR : ENOENT;
+    } else {
+      dir = new Dir();
+      dir->mPath = iter->first;
+
+      if ( dir->mPath[dir->mPath.length() - 1] != '/' ) {
+        dir->mPath += '/';
+      }
+
+      dir->mNames.assign( iter->second.begin(), iter->second.end() );
+      dir->mPos = 0;
+    }
+
+    mCatalogLock.UnLock();
+  }
+
+  EndCall();
+  return reinterpret_cast<lfc_DIR*>( dir );
+}
+
+
+//------------------------------------------------------------------------------
+// Read the next entry of a directory with its replicas
+//------------------------------------------------------------------------------
+struct lfc_direnrep*
+LfcMock::ReadDir( lfc_DIR* dirp )
+{
+  Dir* dir = reinterpret_cast<Dir*>( dirp );
+
+  if ( !dir || ( dir->mPos >= dir->mNames.size() ) ) {
+    return NULL;
+  }
+
+  const std::string& name = dir->mNames[dir->mPos++];
+  std::string path = dir->mPath + name;
+  size_t size = offsetof( struct lfc_direnrep, d_name ) + name.length() + 1;
+  dir->mEntry.assign( size, 0 );
+  dir->mReps.clear();
+  dir->mHosts.clear();
+  dir->mSfns.clear();
+  struct lfc_direnrep* entry = reinterpret_cast<struct lfc_direnrep*>( &dir->mEntry[0] );
+  memcpy( entry->d_name, name.c_str(), name.length() + 1 );
+  entry->d_reclen = size;
+  mCatalogLock.ReadLock();
+  FileMap::const_iterator iter = mFiles.find( path );
+
+  if ( iter == mFiles.end() ) {
+    entry->filemode = S_IFDIR | 0775;
+  } else {
+    entry->fileid = iter->second.mFileId;
+    entry->filemode = S_IFREG | 0664;
+    strncpy( entry->guid, MakeGuid( iter->second.mFileId ).c_str(),
+             sizeof( entry->guid ) - 1 );
+    dir->mSfns = iter->second.mSfns;
+  }
+
+  mCatalogLock.UnLock();
+
+  //............................................................................
+  // The replicas point into the strings kept by the directory
+  //............................................................................
+  char host[CA_MAXHOSTNAMELEN + 1];
+  dir->mReps.resize( dir->mSfns.size() );
+
+  for ( size_t i = 0; i < dir->mSfns.size(); i++ ) {
+    CopyHost( dir->mSfns[i], host, sizeof( host ) );
+    dir->mHosts.push_back( host );
+  }
+
+  for ( size_t i = 0; i < dir->mSfns.size(); i++ ) {
+    dir->mReps[i].fileid = entry->fileid;
+    dir->mReps[i].status = '-';
+    dir->mReps[i].host = const_cast<char*>( dir->mHosts[i].c_str() );
+    dir->mReps[i].sfn = const_cast<char*>( dir->mSfns[i].c_str() );
+  }
+
+  entry->nbreplicas = dir->mReps.size();
+  entry->rep = dir->mReps.empty() ? NULL : &dir->mReps[0];
+  return entry;
+}
+
+
+//------------------------------------------------------------------------------
+// Close a directory
+//------------------------------------------------------------------------------
+int
+LfcMock::CloseDir( lfc_DIR* dirp )
+{
+  delete reinterpret_cast<Dir*>( dirp );
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+// Check that the server is alive
+//------------------------------------------------------------------------------
+int
+LfcMock::Ping( char* info )
+{
+  int retc = -1;
+
+  if ( !BeginCall( 1, mCounters.mPings ) ) {
+    strcpy( info, "LFC mock" );
+    retc = 0;
+  }
+
+  EndCall();
+  return retc;
+}
+
+
+//------------------------------------------------------------------------------
+// Functions of the LFC client library
+//------------------------------------------------------------------------------
+extern "C"
+{
+  int* C__serrno()
+  {
+    return &sSerrno;
+  }
+
+  int Cthread_init()
+  {
+    return 0;
+  }
+
+  int lfc_startsess( char* server, char* comment )
+  {
+    return LfcMock::Get().StartSession();
+  }
+
+  int lfc_endsess()
+  {
+    return LfcMock::Get().EndSession();
+  }
+
+  int lfc_getreplica( const char* path, const char* guid, const char* se,
+                      int* nbentries, struct lfc_filereplica** rep_entries )
+  {
+    return LfcMock::Get().GetReplica( path, guid, nbentries, rep_entries );
+  }
+
+  int lfc_getreplicasl( int nbfiles, const char** paths, const char* se,
+                        int* nbentries, struct lfc_filereplicas** rep_entries )
+  {
+    return LfcMock::Get().GetReplicas( nbfiles, paths, nbentries, rep_entries );
+  }
+
+  lfc_DIR* lfc_opendirg( const char* path, const char* guid )
+  {
+    return LfcMock::Get().OpenDir( path, guid );
+  }
+
+  struct lfc_direnrep* lfc_readdirxr( lfc_DIR* dirp, char* se )
+  {
+    return LfcMock::Get().ReadDir( dirp );
+  }
+
+  int lfc_closedir( lfc_DIR* dirp )
+  {
+    return LfcMock::Get().CloseDir( dirp );
+  }
+
+  int lfc_ping( char* server, char* info )
+  {
+    return LfcMock::Get().Ping( info );
+  }
+}
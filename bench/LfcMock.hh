@@ -0,0 +1,242 @@
+//------------------------------------------------------------------------------
+// File: LfcMock.hh
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOS_PLUGIN_LFCMOCK_HH__
+#define __EOS_PLUGIN_LFCMOCK_HH__
+
+/*----------------------------------------------------------------------------*/
+#include <XrdSys/XrdSysPthread.hh>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+/*----------------------------------------------------------------------------*/
+#define NSTYPE_LFC
+#include <sys/types.h>
+#include <lfc_api.h>
+#include <stdint.h>
+/*----------------------------------------------------------------------------*/
+
+
+//------------------------------------------------------------------------------
+//! In-memory LFC catalog behind a mock of the LFC client library. LfcMock.cc
+//! defines the functions of lfc_api.h used by the plugin (sessions, replica
+//! queries by lfn, guid or in bulk, directory listing and ping) plus serrno
+//! and Cthread_init, so linking it instead of the LFC library runs the whole
+//! resolution path without an LFC server.
+//!
+//! Every call waits for a free server thread, sleeps for the configured
+//! latency and fails with SECOMERR at the configured rate, so that the
+//! session pool, the batching and the error handling see a server under load.
+//! A call made by a thread without a session first pays the connection
+//! latency, like the real client opening a connection per call.
+//!
+//! Without code, the mock is set up from the environment on first use:
+//! LFC_MOCK_CATALOG (file with one "lfn sfn [sfn ...]" line per file),
+//! LFC_MOCK_LATENCY, LFC_MOCK_JITTER, LFC_MOCK_PER_FILE, LFC_MOCK_CONNECT
+//! (all in microseconds), LFC_MOCK_FAILURE (fraction of the calls) and
+//! LFC_MOCK_SERVER_THREADS.
+//------------------------------------------------------------------------------
+class LfcMock
+{
+  public:
+
+    //--------------------------------------------------------------------------
+    //! Behaviour of the mock server
+    //--------------------------------------------------------------------------
+    struct Config {
+      unsigned int mLatency;            ///< latency of a call in us
+      unsigned int mJitter;             ///< random extra latency up to this in us
+      unsigned int mPerFile;            ///< latency per extra lfn of a bulk query in us
+      unsigned int mConnect;            ///< latency of opening a connection in us
+      double mFailure;                  ///< fraction of the calls failing
+      unsigned int mServerThreads;      ///< calls served at once, 0 for no limit
+    };
+
+    //--------------------------------------------------------------------------
+    //! Calls seen by the mock server
+    //--------------------------------------------------------------------------
+    struct Counters {
+      uint64_t mQueries;                ///< lfc_getreplica calls
+      uint64_t mBulkQueries;            ///< lfc_getreplicasl calls
+      uint64_t mBulkFiles;              ///< lfns of the lfc_getreplicasl calls
+      uint64_t mDirs;                   ///< lfc_opendirg calls
+      uint64_t mPings;                  ///< lfc_ping calls
+      uint64_t mSessions;               ///< lfc_startsess calls
+      uint64_t mConnects;               ///< calls made without a session
+      uint64_t mFailures;               ///< calls failed on purpose
+      uint64_t mMaxActive;              ///< highest number of calls served at once
+    };
+
+
+    //--------------------------------------------------------------------------
+    //! Get the mock, set up from the environment on first use
+    //--------------------------------------------------------------------------
+    static LfcMock& Get();
+
+
+    //--------------------------------------------------------------------------
+    //! Set the behaviour of the mock server
+    //--------------------------------------------------------------------------
+    void Configure( const Config& config );
+
+
+    //--------------------------------------------------------------------------
+    //! Add a replica of a file to the catalog, the parent directories are
+    //! created as needed
+    //!
+    //! @param lfn path of the file in the catalog
+    //! @param sfn replica of the file
+    //!
+    //--------------------------------------------------------------------------
+    void Add( const std::string& lfn, const std::string& sfn );
+
+
+    //--------------------------------------------------------------------------
+    //! Load the catalog from a file with one "lfn sfn [sfn ...]" line per file
+    //!
+    //! @param path file to load
+    //!
+    //! @return number of files loaded, -1 if the file can't be read
+    //!
+    //--------------------------------------------------------------------------
+    int64_t Load( const char* path );
+
+
+    //--------------------------------------------------------------------------
+    //! Get the number of files in the catalog
+    //--------------------------------------------------------------------------
+    uint64_t GetNumFiles();
+
+
+    //--------------------------------------------------------------------------
+    //! Get the calls seen so far
+    //--------------------------------------------------------------------------
+    void GetCounters( Counters& counters );
+
+
+    //--------------------------------------------------------------------------
+    //! Reset the calls seen so far
+    //--------------------------------------------------------------------------
+    void ResetCounters();
+
+
+    //--------------------------------------------------------------------------
+    //! Implementation of lfc_startsess and lfc_endsess for the calling thread
+    //--------------------------------------------------------------------------
+    int StartSession();
+    int EndSession();
+
+
+    //--------------------------------------------------------------------------
+    //! Implementation of lfc_getreplica
+    //--------------------------------------------------------------------------
+    int GetReplica( const char* path, const char* guid, int* nbEntries,
+                    struct lfc_filereplica** repEntries );
+
+
+    //--------------------------------------------------------------------------
+    //! Implementation of lfc_getreplicasl
+    //--------------------------------------------------------------------------
+    int GetReplicas( int nbFiles, const char** paths, int* nbEntries,
+                     struct lfc_filereplicas** repEntries );
+
+
+    //--------------------------------------------------------------------------
+    //! Implementation of lfc_opendirg, lfc_readdirxr and lfc_closedir
+    //--------------------------------------------------------------------------
+    lfc_DIR* OpenDir( const char* path, const char* guid );
+    struct lfc_direnrep* ReadDir( lfc_DIR* dirp );
+    int CloseDir( lfc_DIR* dirp );
+
+
+    //--------------------------------------------------------------------------
+    //! Implementation of lfc_ping
+    //--------------------------------------------------------------------------
+    int Ping( char* info );
+
+  private:
+
+    //! File of the catalog, the guid is built from the file id
+    struct File {
+      uint64_t mFileId;                 ///< file id
+      std::vector<std::string> mSfns;   ///< replicas
+    };
+
+    //! Open directory, the entries are listed when it is opened
+    struct Dir;
+
+    typedef std::map<std::string, File> FileMap;
+    typedef std::map< std::string, std::set<std::string> > DirMap;
+
+    //--------------------------------------------------------------------------
+    //! Constructor
+    //--------------------------------------------------------------------------
+    LfcMock();
+
+
+    //--------------------------------------------------------------------------
+    //! Wait for a server thread and for the latency of a call
+    //!
+    //! @param numFiles number of lfns of the call
+    //! @param counter counter of the kind of call
+    //!
+    //! @return true if the call is to fail
+    //!
+    //--------------------------------------------------------------------------
+    bool BeginCall( int numFiles, uint64_t& counter );
+
+
+    //--------------------------------------------------------------------------
+    //! Give back the server thread of a call
+    //--------------------------------------------------------------------------
+    void EndCall();
+
+
+    //--------------------------------------------------------------------------
+    //! Look up a file by lfn or by guid, the catalog must be read locked
+    //--------------------------------------------------------------------------
+    const File* FindFile( const char* path, const char* guid ) const;
+
+
+    //--------------------------------------------------------------------------
+    //! Get the guid of a file id
+    //--------------------------------------------------------------------------
+    static std::string MakeGuid( uint64_t fileId );
+
+    XrdSysRWLock mCatalogLock;          ///< protects the catalog
+    FileMap mFiles;                     ///< files by lfn
+    std::vector<FileMap::iterator> mFileIds; ///< files by file id - 1
+    DirMap mDirs;                       ///< entry names by directory
+
+    Config mConfig;                     ///< behaviour of the server
+    Counters mCounters;                 ///< calls seen
+    XrdSysCondVar mServerCond;          ///< protects mActive, signals free threads
+    unsigned int mActive;               ///< calls being served
+
+    //! The mock can't be copied
+    LfcMock( const LfcMock& );
+    LfcMock& operator=( const LfcMock& );
+};
+
+#endif // __EOS_PLUGIN_LFCMOCK_HH__
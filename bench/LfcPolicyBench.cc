@@ -0,0 +1,305 @@
+//------------------------------------------------------------------------------
+// File: LfcPolicyBench.cc
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+//------------------------------------------------------------------------------
+//! Trace-driven comparison of the hit ratio of the LfcCache eviction policies.
+//! Every lfn of the trace is looked up and inserted on a miss, like Locate
+//! does, for each of the fifo, s3fifo and tinylfu policies.
+//!
+//! The trace is read from a file with one lfn per line, or generated: jobs
+//! reading a working set of lfns with a Zipf popularity, interleaved with
+//! scans of lfns read only once, like a user listing a whole dataset
+//! container. The lookups of the scans can't hit, the hit ratio of the other
+//! lookups shows how well each policy keeps the working set. The generated
+//! trace can be written to a file to be replayed later.
+//!
+//! Usage: LfcPolicyBench [-f trace_file] [-w write_trace] [-n lookups]
+//!                       [-k working_set] [-z zipf_theta] [-x scan_fraction]
+//!                       [-l scan_length] [-m cache_maxsize] [-S shards]
+//------------------------------------------------------------------------------
+
+/*----------------------------------------------------------------------------*/
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+/*----------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+/*----------------------------------------------------------------------------*/
+#include "LfcCache.hh"
+/*----------------------------------------------------------------------------*/
+
+
+//------------------------------------------------------------------------------
+// Current time in nanoseconds
+//------------------------------------------------------------------------------
+static uint64_t
+NowNs()
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return static_cast<uint64_t>( ts.tv_sec ) * 1000000000ULL + ts.tv_nsec;
+}
+
+
+//------------------------------------------------------------------------------
+// Build an ATLAS like lfn for the given index
+//------------------------------------------------------------------------------
+static std::string
+MakeLfn( uint64_t index )
+{
+  char buff[256];
+  snprintf( buff, sizeof( buff ), "/atlas/dq2/mc12_8TeV/NTUP_SMWZ/mc12_8TeV.%06llu."
+            "PowhegPythia8_AU2CT10.merge.NTUP_SMWZ.e1169_s1469_r3542_p1328_tid%08llu_00/"
+            "NTUP_SMWZ.%08llu._000001.root.1",
+            static_cast<unsigned long long>( index / 100 ),
+            static_cast<unsigned long long>( index / 100 ),
+            static_cast<unsigned long long>( index ) );
+  return buff;
+}
+
+
+//------------------------------------------------------------------------------
+// Next number of a xorshift64* generator
+//------------------------------------------------------------------------------
+static uint64_t
+NextRandom( uint64_t& seed )
+{
+  seed ^= seed >> 12;
+  seed ^= seed << 25;
+  seed ^= seed >> 27;
+  return seed * 0x2545F4914F6CDD1DULL;
+}
+
+
+//------------------------------------------------------------------------------
+// Main
+//------------------------------------------------------------------------------
+int
+main( int argc, char* argv[] )
+{
+  const char* trace_file = NULL;
+  const char* write_file = NULL;
+  uint64_t num_lookups = 5000000;
+  uint64_t working_set = 200000;
+  double theta = 0.9;
+  double scan_fraction = 0.3;
+  uint64_t scan_length = 20000;
+  uint64_t cache_maxsize = 50000;
+  unsigned int num_shards = 16;
+  int opt;
+
+  while ( ( opt = getopt( argc, argv, "f:w:n:k:z:x:l:m:S:" ) ) != -1 ) {
+    switch ( opt ) {
+      case 'f':
+        trace_file = optarg;
+        break;
+      case 'w':
+        write_file = optarg;
+        break;
+      case 'n':
+        num_lookups = strtoull( optarg, NULL, 10 );
+        break;
+      case 'k':
+        working_set = strtoull( optarg, NULL, 10 );
+        break;
+      case 'z':
+        theta = strtod( optarg, NULL );
+        break;
+      case 'x':
+        scan_fraction = strtod( optarg, NULL );
+        break;
+      case 'l':
+        scan_length = strtoull( optarg, NULL, 10 );
+        break;
+      case 'm':
+        cache_maxsize = strtoull( optarg, NULL, 10 );
+        break;
+      case 'S':
+        num_shards = strtoul( optarg, NULL, 10 );
+        break;
+      default:
+        fprintf( stderr, "Usage: %s [-f trace_file] [-w write_trace] [-n lookups] "
+                 "[-k working_set] [-z zipf_theta] [-x scan_fraction] "
+                 "[-l scan_length] [-m cache_maxsize] [-S shards]\n", argv[0] );
+        return 1;
+    }
+  }
+
+  //............................................................................
+  // The trace is kept as indices into the list of distinct lfns, the scanned
+  // lfns are marked so that their lookups can be counted apart
+  //............................................................................
+  std::vector<std::string> lfns;
+  std::vector<uint32_t> trace;
+  std::vector<bool> scanned;
+
+  if ( trace_file ) {
+    std::ifstream file( trace_file );
+    std::string line;
+
+    if ( !file.is_open() ) {
+      fprintf( stderr, "Error: unable to open %s\n", trace_file );
+      return 1;
+    }
+
+    std::vector< std::pair<std::string, uint32_t> > sorted;
+
+    while ( std::getline( file, line ) ) {
+      if ( !line.empty() ) {
+        sorted.push_back( std::make_pair( line, static_cast<uint32_t>( sorted.size() ) ) );
+      }
+    }
+
+    std::sort( sorted.begin(), sorted.end() );
+    trace.resize( sorted.size() );
+
+    for ( size_t i = 0; i < sorted.size(); i++ ) {
+      if ( !i || ( sorted[i].first != sorted[i - 1].first ) ) {
+        lfns.push_back( sorted[i].first );
+      }
+
+      trace[sorted[i].second] = lfns.size() - 1;
+    }
+
+    scanned.assign( lfns.size(), false );
+  } else {
+    if ( !working_set || ( scan_fraction < 0 ) || ( scan_fraction >= 1 ) ||
+         !scan_length )
+    {
+      fprintf( stderr, "Error: invalid parameters\n" );
+      return 1;
+    }
+
+    //..........................................................................
+    // The popularity of the working set follows a Zipf law, the ranks are
+    // spread over the lfns so that the popular ones are in all the shards
+    //..........................................................................
+    std::vector<double> cdf( working_set );
+    double sum = 0;
+
+    for ( uint64_t i = 0; i < working_set; i++ ) {
+      sum += 1.0 / pow( static_cast<double>( i + 1 ), theta );
+      cdf[i] = sum;
+    }
+
+    for ( uint64_t i = 0; i < working_set; i++ ) {
+      lfns.push_back( MakeLfn( i ) );
+    }
+
+    std::random_shuffle( lfns.begin(), lfns.end() );
+    scanned.assign( working_set, false );
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    uint64_t next_scan = working_set;
+
+    while ( trace.size() < num_lookups ) {
+      double u = ( NextRandom( seed ) >> 11 ) * ( 1.0 / 9007199254740992.0 );
+
+      if ( u < scan_fraction / scan_length ) {
+        for ( uint64_t i = 0; ( i < scan_length ) && ( trace.size() < num_lookups ); i++ ) {
+          lfns.push_back( MakeLfn( next_scan++ ) );
+          scanned.push_back( true );
+          trace.push_back( lfns.size() - 1 );
+        }
+      } else {
+        u = ( NextRandom( seed ) >> 11 ) * ( sum / 9007199254740992.0 );
+        trace.push_back( std::lower_bound( cdf.begin(), cdf.end(), u ) - cdf.begin() );
+      }
+    }
+  }
+
+  if ( write_file ) {
+    FILE* file = fopen( write_file, "w" );
+
+    if ( !file ) {
+      fprintf( stderr, "Error: unable to write %s\n", write_file );
+      return 1;
+    }
+
+    for ( size_t i = 0; i < trace.size(); i++ ) {
+      fprintf( file, "%s\n", lfns[trace[i]].c_str() );
+    }
+
+    fclose( file );
+  }
+
+  uint64_t num_scanned = 0;
+
+  for ( size_t i = 0; i < trace.size(); i++ ) {
+    num_scanned += scanned[trace[i]];
+  }
+
+  fprintf( stdout, "lookups=%llu distinct_lfns=%llu scanned_lookups=%llu "
+           "cache_maxsize=%llu shards=%u\n",
+           static_cast<unsigned long long>( trace.size() ),
+           static_cast<unsigned long long>( lfns.size() ),
+           static_cast<unsigned long long>( num_scanned ),
+           static_cast<unsigned long long>( cache_maxsize ), num_shards );
+  fprintf( stdout, "%8s %10s %14s %12s %12s\n", "policy", "hit_ratio",
+           "non_scan_hits", "ns/lookup", "evicted" );
+
+  //............................................................................
+  // Replay the trace with each policy
+  //............................................................................
+  static const char* names[] = { "fifo", "s3fifo", "tinylfu" };
+  static const LfcCache::Policy policies[] = { LfcCache::eFifo, LfcCache::eS3Fifo,
+                                               LfcCache::eTinyLfu };
+  std::string pfn_prefix = "/eos/atlas/atlasdatadisk";
+  std::string pfn;
+
+  for ( int p = 0; p < 3; p++ ) {
+    LfcCache* cache = new LfcCache( 24 * 3600, cache_maxsize, num_shards, policies[p] );
+    uint64_t hits = 0;
+    uint64_t scan_hits = 0;
+    uint64_t start = NowNs();
+
+    for ( size_t i = 0; i < trace.size(); i++ ) {
+      const std::string& lfn = lfns[trace[i]];
+
+      if ( cache->GetEntry( lfn, pfn ) ) {
+        hits++;
+        scan_hits += scanned[trace[i]];
+      } else {
+        cache->Insert( lfn, pfn_prefix + lfn.substr( 10 ) );
+      }
+    }
+
+    uint64_t elapsed = NowNs() - start;
+    LfcCache::Stats stats;
+    cache->GetStats( stats );
+    uint64_t num_other = trace.size() - num_scanned;
+    fprintf( stdout, "%8s %10.4f %14.4f %12.1f %12llu\n", names[p],
+             trace.empty() ? 0.0 : static_cast<double>( hits ) / trace.size(),
+             num_other ? static_cast<double>( hits - scan_hits ) / num_other : 0.0,
+             trace.empty() ? 0.0 : static_cast<double>( elapsed ) / trace.size(),
+             static_cast<unsigned long long>( stats.mEvicted ) );
+    delete cache;
+  }
+
+  return 0;
+}
@@ -0,0 +1,160 @@
+//------------------------------------------------------------------------------
+// File: LfcRewriteBench.cc
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+//------------------------------------------------------------------------------
+//! Benchmark counting the memory allocations and measuring the latency of the
+//! lfn rewrites done on every cache miss. The rewrite based on LfcString::Split
+//! and LfcString::Join used before the tokenizer is compared with the one of
+//! the plugin, both must give the same paths.
+//!
+//! Usage: LfcRewriteBench [-n rewrites]
+//------------------------------------------------------------------------------
+
+/*----------------------------------------------------------------------------*/
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+/*----------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+/*----------------------------------------------------------------------------*/
+#include "LfcRewrite.hh"
+#include "LfcString.hh"
+#include "LfcAllocCount.hh"
+/*----------------------------------------------------------------------------*/
+
+//------------------------------------------------------------------------------
+// Current time in nanoseconds
+//------------------------------------------------------------------------------
+static uint64_t
+NowNs()
+{
+  struct timespec ts;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return static_cast<uint64_t>( ts.tv_sec ) * 1000000000ULL + ts.tv_nsec;
+}
+
+
+//------------------------------------------------------------------------------
+// Rewrite used before the tokenizer, it took the lfn by value
+//------------------------------------------------------------------------------
+static VectStrings
+SplitRewrite( const LfcString& path )
+{
+  LfcString lfn = path;
+  VectStrings ret;
+  LfcString rebuild_path;
+  ret.push_back( lfn );
+
+  if ( !lfn.StartsWith( "/grid" ) )
+    ret.push_back( "/grid" + lfn );
+
+  VectStrings components = lfn.Split( "/" );
+
+  if ( components.size() > 2 && components[0] == "atlas" ) {
+    if ( components[1] != "dq2" ) {
+      rebuild_path = LfcString::Join( VectStrings( components.begin() + 1, components.end() ), "/" );
+      ret.push_back( "/grid/atlas/dq2" + rebuild_path );
+    }
+  }
+
+  return ret;
+}
+
+
+//------------------------------------------------------------------------------
+// Run the rewrites and print the results for one implementation
+//------------------------------------------------------------------------------
+static void
+RunBench( const char* name, VectStrings( *rewrite )( const LfcString& ),
+          const VectStrings& lfns, uint64_t numRewrites )
+{
+  uint64_t num_paths = 0;
+  uint64_t allocs = LfcAllocCount();
+  uint64_t start = NowNs();
+
+  for ( uint64_t i = 0; i < numRewrites; i++ ) {
+    num_paths += rewrite( lfns[i % lfns.size()] ).size();
+  }
+
+  uint64_t elapsed = NowNs() - start;
+  allocs = LfcAllocCount() - allocs;
+  fprintf( stdout, "%8s %14.1f %16.2f %12.2f\n", name,
+           static_cast<double>( elapsed ) / numRewrites,
+           static_cast<double>( allocs ) / numRewrites,
+           static_cast<double>( num_paths ) / numRewrites );
+}
+
+
+//------------------------------------------------------------------------------
+// Main
+//------------------------------------------------------------------------------
+int
+main( int argc, char* argv[] )
+{
+  uint64_t num_rewrites = 1000000;
+  int opt;
+
+  while ( ( opt = getopt( argc, argv, "n:" ) ) != -1 ) {
+    switch ( opt ) {
+      case 'n':
+        num_rewrites = strtoull( optarg, NULL, 10 );
+        break;
+      default:
+        fprintf( stderr, "Usage: %s [-n rewrites]\n", argv[0] );
+        return 1;
+    }
+  }
+
+  //............................................................................
+  // Lfns in the different forms requested by the clients
+  //............................................................................
+  VectStrings lfns;
+  char buff[512];
+
+  for ( int i = 0; i < 100; i++ ) {
+    snprintf( buff, sizeof( buff ), "%s/mc12_8TeV/NTUP_SMWZ/mc12_8TeV.%06d.PowhegPythia8."
+              "merge.NTUP_SMWZ.e1169_s1469_r3542_p1328_tid%08d_00/"
+              "NTUP_SMWZ.%08d._000001.root.1",
+              ( i % 4 == 0 ) ? "/atlas" : ( i % 4 == 1 ) ? "/atlas/dq2" :
+              ( i % 4 == 2 ) ? "/grid/atlas/dq2" : "//atlas//user",
+              i, i * 3, i * 7 );
+    lfns.push_back( buff );
+  }
+
+  for ( size_t i = 0; i < lfns.size(); i++ ) {
+    if ( SplitRewrite( lfns[i] ) != LfcRewriteLfn( lfns[i] ) ) {
+      fprintf( stderr, "Error: rewrites differ for %s\n", lfns[i].c_str() );
+      return 1;
+    }
+  }
+
+  fprintf( stdout, "rewrites=%llu\n", static_cast<unsigned long long>( num_rewrites ) );
+  fprintf( stdout, "%8s %14s %16s %12s\n", "rewrite", "ns/rewrite", "allocs/rewrite",
+           "paths/lfn" );
+  RunBench( "split", SplitRewrite, lfns, num_rewrites );
+  RunBench( "tokens", LfcRewriteLfn, lfns, num_rewrites );
+  return 0;
+}
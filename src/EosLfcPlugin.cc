@@ -22,14 +22,22 @@
  ************************************************************************/
 
 /*----------------------------------------------------------------------------*/
+#include <climits>
+#include <cstdarg>
 #include <cstdio>
 #include <sstream>
 /*----------------------------------------------------------------------------*/
 #include <glob.h>
+#include <sys/stat.h>
 #include <unistd.h>
 /*----------------------------------------------------------------------------*/
 #include "EosLfcPlugin.hh"
 #include "LfcCache.hh"
+#include "LfcLog.hh"
+#include "LfcLogQueue.hh"
+#include "LfcRewrite.hh"
+#include "LfcSessionPool.hh"
+#include "LfcStats.hh"
 /*----------------------------------------------------------------------------*/
 #include "XrdOss/XrdOss.hh"
 #include "XrdSfs/XrdSfsInterface.hh"
@@ -42,13 +50,249 @@
 // Singleton variable
 static XrdCmsClient* instance = NULL;
 
+//! Opaque data around the pfn in a redirection to EOS
+static const char sLfnOpaque[] = "?eos.lfn=";
+static const char sAppOpaque[] = "&eos.app=lfc";
+
+
+//------------------------------------------------------------------------------
+//! Replica lookup run on a thread of the LFC session pool
+//------------------------------------------------------------------------------
+class ReplicaJob: public LfcJob
+{
+  public:
+
+    //--------------------------------------------------------------------------
+    //! Constructor
+    //!
+    //! @param lfn logical file name to look up, looked up by guid if it
+    //!        contains "!GUID="
+    //! @param stats statistics of the queries, NULL if none
+    //!
+    //--------------------------------------------------------------------------
+    ReplicaJob( const std::string& lfn, LfcStats* stats = NULL ):
+      mStatus( -1 ), mErrno( 0 ), mNumEntries( 0 ), mEntries( NULL ),
+      mStats( stats ) {
+      size_t pos = lfn.find( "!GUID=" );
+
+      if ( pos == std::string::npos ) {
+        mPath = lfn;
+      } else {
+        mGuid = lfn.substr( pos + 6 );
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    //! Destructor
+    //--------------------------------------------------------------------------
+    virtual ~ReplicaJob() {
+      if ( mEntries ) {
+        free( mEntries );
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    //! Query the replicas - serrno is only valid on the thread doing the query
+    //--------------------------------------------------------------------------
+    virtual void Run() {
+      uint64_t start = mStats ? LfcStats::Now() : 0;
+      mStatus = lfc_getreplica( mPath.empty() ? NULL : mPath.c_str(),
+                                mGuid.empty() ? NULL : mGuid.c_str(),
+                                NULL/*se*/, &mNumEntries, &mEntries );
+      mErrno = serrno;
+
+      if ( mStats ) {
+        mStats->Record( LfcStats::eLfcQuery, start );
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    //! Only the lookups by lfn can be done in bulk
+    //--------------------------------------------------------------------------
+    virtual bool CanBatch() const {
+      return !mPath.empty();
+    }
+
+    //--------------------------------------------------------------------------
+    //! Query the replicas of all the lfns of the batch at once
+    //--------------------------------------------------------------------------
+    virtual void RunBatch( std::vector<LfcJob*>& jobs );
+
+    std::string mPath;                  ///< lfn to look up
+    std::string mGuid;                  ///< guid to look up
+    int mStatus;                        ///< status returned by the LFC
+    int mErrno;                         ///< serrno after the query
+    int mNumEntries;                    ///< number of replicas
+    struct lfc_filereplica* mEntries;   ///< replicas
+    LfcStats* mStats;                   ///< statistics of the queries
+};
+
+
+//------------------------------------------------------------------------------
+//! Prefetch of the siblings of a resolved lfn run on a thread of the LFC
+//! session pool
+//------------------------------------------------------------------------------
+class PrefetchJob: public LfcJob
+{
+  public:
+
+    //--------------------------------------------------------------------------
+    //! Constructor
+    //!
+    //! @param plugin plugin object
+    //! @param catalogDir directory in the LFC
+    //! @param lfnDir directory of the requested lfns
+    //!
+    //--------------------------------------------------------------------------
+    PrefetchJob( EosLfcPlugin* plugin, const std::string& catalogDir,
+                 const std::string& lfnDir ):
+      mPlugin( plugin ), mCatalogDir( catalogDir ), mLfnDir( lfnDir ) {}
+
+    //--------------------------------------------------------------------------
+    //! List the directory and fill the cache
+    //--------------------------------------------------------------------------
+    virtual void Run() {
+      mPlugin->PrefetchDir( mCatalogDir, mLfnDir );
+    }
+
+  private:
+
+    EosLfcPlugin* mPlugin;    ///< plugin object
+    std::string mCatalogDir;  ///< directory in the LFC
+    std::string mLfnDir;      ///< directory of the requested lfns
+};
+
 using namespace XrdCms;
 
 namespace XrdCms {
   XrdSysError  LfcError( 0, "EosLfc_" );
   XrdOucTrace  Trace( &LfcError );
+  LfcLogQueue* LfcLogger = NULL;
 };
 
+
+//------------------------------------------------------------------------------
+// Format a message and append it to the log queue, or write it to the logger
+// straight away if the queue is not running
+//------------------------------------------------------------------------------
+void
+LfcLogWrite( const char* epname, const char* format, ... )
+{
+  va_list args;
+  va_start( args, format );
+  LfcLogQueue* queue = LfcLogger;
+
+  if ( queue ) {
+    ( void ) queue->Append( epname, format, args );
+  } else {
+    char msg[LFC_LOG_MSGLEN];
+    vsnprintf( msg, sizeof( msg ), format, args );
+    LfcError.Emsg( epname, msg );
+  }
+
+  va_end( args );
+}
+
+
+//------------------------------------------------------------------------------
+// Write the queued messages when the process exits, the plugin object is not
+// destroyed by the cmsd. If it was, the queue is already gone from LfcLogger.
+//------------------------------------------------------------------------------
+static void
+FlushLogQueue()
+{
+  LfcLogQueue* queue = __sync_lock_test_and_set( &LfcLogger, NULL );
+
+  if ( queue ) {
+    queue->Stop();
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Query the replicas of all the lfns of a batch at once
+//------------------------------------------------------------------------------
+void
+ReplicaJob::RunBatch( std::vector<LfcJob*>& jobs )
+{
+  std::vector<const char*> paths;
+  struct lfc_filereplicas* rep_entries = NULL;
+  int n_entries = 0;
+
+  for ( unsigned int i = 0; i < jobs.size(); i++ ) {
+    paths.push_back( static_cast<ReplicaJob*>( jobs[i] )->mPath.c_str() );
+  }
+
+  uint64_t start = mStats ? LfcStats::Now() : 0;
+  int status = lfc_getreplicasl( paths.size(), &paths[0], NULL/*se*/,
+                                 &n_entries, &rep_entries );
+
+  if ( mStats ) {
+    mStats->Record( LfcStats::eLfcBulkQuery, start );
+  }
+
+  //............................................................................
+  // The replicas come in the order of the lfns and the ones of the same file
+  // share the guid, an lfn which can't be resolved gives one entry with an
+  // error code. Group the entries by lfn this way and if the groups don't add
+  // up fall back to one query per lfn.
+  //............................................................................
+  std::vector<int> groups;
+
+  if ( !status ) {
+    for ( int i = 0; i < n_entries; i++ ) {
+      if ( !i || rep_entries[i].errcode || rep_entries[i - 1].errcode ||
+           strcmp( rep_entries[i].guid, rep_entries[i - 1].guid ) )
+      {
+        groups.push_back( i );
+      }
+    }
+  }
+
+  if ( status || ( groups.size() != jobs.size() ) ) {
+    if ( rep_entries ) {
+      free( rep_entries );
+    }
+
+    LfcJob::RunBatch( jobs );
+    return;
+  }
+
+  groups.push_back( n_entries );
+
+  for ( unsigned int i = 0; i < jobs.size(); i++ ) {
+    ReplicaJob* job = static_cast<ReplicaJob*>( jobs[i] );
+    struct lfc_filereplicas* first = &rep_entries[groups[i]];
+
+    if ( first->errcode ) {
+      job->mStatus = -1;
+      job->mErrno = first->errcode;
+      continue;
+    }
+
+    job->mStatus = 0;
+    job->mErrno = 0;
+    job->mNumEntries = groups[i + 1] - groups[i];
+    job->mEntries = static_cast<struct lfc_filereplica*>(
+                      calloc( job->mNumEntries, sizeof( struct lfc_filereplica ) ) );
+
+    if ( !job->mEntries ) {
+      job->mStatus = -1;
+      job->mErrno = ENOMEM;
+      job->mNumEntries = 0;
+      continue;
+    }
+
+    for ( int j = 0; j < job->mNumEntries; j++ ) {
+      job->mEntries[j].status = first[j].status;
+      strncpy( job->mEntries[j].host, first[j].host, sizeof( job->mEntries[j].host ) - 1 );
+      strncpy( job->mEntries[j].sfn, first[j].sfn, sizeof( job->mEntries[j].sfn ) - 1 );
+    }
+  }
+
+  free( rep_entries );
+}
+
 //------------------------------------------------------------------------------
 // CMS Client Instantiator
 //------------------------------------------------------------------------------
@@ -75,9 +319,46 @@ extern "C"
 EosLfcPlugin::EosLfcPlugin( XrdSysLogger* logger ):
   XrdCmsClient( XrdCmsClient::amRemote ),
   mRedirPort( 1094 ),
+  mPfnMaxLen( 0 ),
   mMetaMgrPort( 1094 ),
-  mSessionInitialised( false ),
-  mCache( NULL )
+  mLfcSessions( LFC_SESSIONS ),
+  mLfcSessionCheck( LFC_SESSION_CHECK ),
+  mSessionPool( NULL ),
+  mRewriteParallel( false ),
+  mBatchSize( LFC_BATCH_SIZE ),
+  mBatchWait( LFC_BATCH_WAIT ),
+  mPrefetch( false ),
+  mPrefetchMaxDir( LFC_PREFETCH_MAXDIR ),
+  mPrefetchRate( LFC_PREFETCH_RATE ),
+  mPrefetchDirs( NULL ),
+  mPrefetchSecond( 0 ),
+  mPrefetchCount( 0 ),
+  mWarmupThreads( LFC_WARMUP_THREADS ),
+  mWarmupRate( LFC_WARMUP_RATE ),
+  mWarmupCond( 0 ),
+  mWarmupStop( false ),
+  mWarmupBusy( 0 ),
+  mWarmupDone( 0 ),
+  mWarmupNumDirs( 0 ),
+  mWarmupEntries( 0 ),
+  mWarmupInserted( 0 ),
+  mWarmupLastLog( 0 ),
+  mCache( NULL ),
+  mNegCache( NULL ),
+  mCacheMaintInterval( LFC_CACHE_MAINT_INTERVAL ),
+  mCacheHighWatermark( LFC_CACHE_HIGH_WATERMARK ),
+  mSnapshotInterval( LFC_CACHE_SNAPSHOT_INTERVAL ),
+  mSnapshotRunning( false ),
+  mShutdown( false ),
+  mSnapshotCond( 0 ),
+  mLogQueueSize( LFC_LOG_QUEUE_SIZE ),
+  mLogQueue( NULL ),
+  mStatsInterval( LFC_STATS_INTERVAL ),
+  mStats( NULL ),
+  mStatsStart( 0 ),
+  mStatsRunning( false ),
+  mStatsCond( 0 ),
+  mCoalesced( 0 )
 {
   LfcError.logger( logger );
   mRoot.clear();
@@ -91,8 +372,74 @@ EosLfcPlugin::EosLfcPlugin( XrdSysLogger* logger ):
 //------------------------------------------------------------------------------
 EosLfcPlugin::~EosLfcPlugin()
 {
-  if ( mSessionInitialised ) {
-    ( void ) lfc_endsess();
+  //............................................................................
+  // Stop the warm-up threads
+  //............................................................................
+  mWarmupCond.Lock();
+  mWarmupStop = true;
+  mWarmupCond.Broadcast();
+  mWarmupCond.UnLock();
+
+  for ( unsigned int i = 0; i < mWarmupThreadIds.size(); i++ ) {
+    XrdSysThread::Join( mWarmupThreadIds[i], NULL );
+  }
+
+  //............................................................................
+  // Stop the statistics thread and dump the statistics one last time
+  //............................................................................
+  if ( mStatsRunning ) {
+    mStatsCond.Lock();
+    mShutdown = true;
+    mStatsCond.Signal();
+    mStatsCond.UnLock();
+    XrdSysThread::Join( mStatsThread, NULL );
+    DumpStats();
+  }
+
+  //............................................................................
+  // Stop the snapshot thread and save the cache one last time
+  //............................................................................
+  if ( mSnapshotRunning ) {
+    mSnapshotCond.Lock();
+    mShutdown = true;
+    mSnapshotCond.Signal();
+    mSnapshotCond.UnLock();
+    XrdSysThread::Join( mSnapshotThread, NULL );
+    SaveSnapshot();
+  }
+
+  //............................................................................
+  // Stop the cache maintenance threads
+  //............................................................................
+  if ( mCache ) {
+    mCache->StopMaintenance();
+  }
+
+  if ( mNegCache ) {
+    mNegCache->StopMaintenance();
+  }
+
+  if ( mPrefetchDirs ) {
+    mPrefetchDirs->StopMaintenance();
+  }
+
+  if ( mSessionPool ) {
+    delete mSessionPool;
+  }
+
+  if ( mStats ) {
+    delete mStats;
+  }
+
+  //............................................................................
+  // All the threads logging through the queue are joined: log synchronously
+  // from now on, then write the queued messages. LfcLogger is cleared only if
+  // it is still this queue and not already taken by the exit handler.
+  //............................................................................
+  if ( mLogQueue ) {
+    ( void ) __sync_bool_compare_and_swap( &LfcLogger, mLogQueue, NULL );
+    mLogQueue->Stop();
+    delete mLogQueue;
   }
 }
 
@@ -112,10 +459,10 @@ EosLfcPlugin::Configure( const char* cfn, char* params, XrdOucEnv* EnvInfo )
   // Set the bebug level based on the env variable LFCDEBUG
   if ( var ) {
     LfcError.Emsg( "Configure", "LFCDEBUG=", var );
-    LfcError.setMsgMask( atoi( var ) );
+    LfcError.setMsgMask( LfcLogMask( atoi( var ) ) );
   } else {
     LfcError.Emsg( "Configure", "LFCDEBUG=", 0 );
-    LfcError.setMsgMask( 0 );
+    LfcError.setMsgMask( LfcLogMask( 0 ) );
   }
 
   // Get the uplink host to which we redirect when the file is not in EOS
@@ -147,13 +494,118 @@ EosLfcPlugin::Configure( const char* cfn, char* params, XrdOucEnv* EnvInfo )
     return 0;
   }
 
+  //............................................................................
+  // Hand the messages to a writer thread so that requests do not wait for
+  // the logger
+  //............................................................................
+  if ( mLogQueueSize > 0 ) {
+    int retc;
+    mLogQueue = new LfcLogQueue( LfcError, mLogQueueSize );
+
+    if ( ( retc = mLogQueue->Start() ) ) {
+      LfcError.Emsg( "Configure", -retc, "start log writer thread" );
+      delete mLogQueue;
+      mLogQueue = NULL;
+      return 0;
+    }
+
+    LfcLogger = mLogQueue;
+
+    //..........................................................................
+    // The exit handler is registered once, whatever the number of plugins
+    // configured
+    //..........................................................................
+    static bool flush_registered = false;
+
+    if ( !flush_registered ) {
+      atexit( FlushLogQueue );
+      flush_registered = true;
+    }
+  }
+
+  if ( mStatsInterval > 0 ) {
+    mStats = new LfcStats();
+    mStatsStart = time( NULL );
+  }
+
+  //............................................................................
+  // Warm up the cache from the last snapshot and start saving it periodically
+  //............................................................................
+  if ( !mSnapshotPath.empty() && mCache ) {
+    uint64_t num_entries;
+    time_t start = time( NULL );
+    int retc = mCache->Load( mSnapshotPath, num_entries );
+
+    if ( retc ) {
+      LfcError.Emsg( "Configure", -retc, "load cache snapshot",
+                     mSnapshotPath.c_str() );
+    } else {
+      LFC_EMSG( "Configure", "Loaded %llu cache entries in %ld seconds from %s",
+                static_cast<unsigned long long>( num_entries ),
+                static_cast<long>( time( NULL ) - start ), mSnapshotPath.c_str() );
+    }
+
+    if ( XrdSysThread::Run( &mSnapshotThread, EosLfcPlugin::StartSnapshotThread,
+                            static_cast<void*>( this ), XRDSYSTHREAD_HOLD,
+                            "LFC cache snapshot" ) )
+    {
+      LfcError.Emsg( "Configure", errno, "start cache snapshot thread" );
+      return 0;
+    }
+
+    mSnapshotRunning = true;
+  }
+
+  //............................................................................
+  // Expire and evict the cache entries in the background so that the inserts
+  // done by the requests only append
+  //............................................................................
+  if ( mCacheMaintInterval > 0 ) {
+    LfcCache* caches[] = { mCache, mNegCache, mPrefetchDirs };
+
+    for ( unsigned int i = 0; i < sizeof( caches ) / sizeof( caches[0] ); i++ ) {
+      int retc;
+
+      if ( caches[i] &&
+           ( retc = caches[i]->StartMaintenance( mCacheMaintInterval,
+                                                 mCacheHighWatermark ) ) )
+      {
+        LfcError.Emsg( "Configure", -retc, "start cache maintenance thread" );
+        return 0;
+      }
+    }
+  }
+
   if ( Cthread_init() ) {
     LfcError.Emsg( "Configure", serrno, " Cthread_init error" );
     return 0;
   }
 
   if ( StartLfcSession() ) {
-    LfcError.Emsg( "Configure", "Error while starting LFC session" );
+    LfcError.Emsg( "Configure", "Error while starting LFC sessions" );
+    return 0;
+  }
+
+  //............................................................................
+  // Dump the statistics periodically
+  //............................................................................
+  if ( mStats ) {
+    if ( XrdSysThread::Run( &mStatsThread, EosLfcPlugin::StartStatsThread,
+                            static_cast<void*>( this ), XRDSYSTHREAD_HOLD,
+                            "LFC statistics" ) )
+    {
+      LfcError.Emsg( "Configure", errno, "start statistics thread" );
+      return 0;
+    }
+
+    mStatsRunning = true;
+  }
+
+  //............................................................................
+  // Fill the cache from the hot namespaces while already serving requests
+  //............................................................................
+  if ( !mWarmupPaths.empty() && mCache && StartWarmup() ) {
+    LfcError.Emsg( "Configure", "Error while starting the cache warm-up" );
     return 0;
   }
 
@@ -170,42 +622,55 @@ EosLfcPlugin::Locate( XrdOucErrInfo& Resp,
                       int            flags,
                       XrdOucEnv*     Info )
 {
-  XrdSecEntity* sec_entity = NULL;
+  bool timed = mStats && mStats->Sample();
+  uint64_t start = timed ? LfcStats::Now() : 0;
+  XrdSecEntity unknown_entity( "" );
+  const XrdSecEntity* sec_entity = NULL;
 
   if ( Info ) {
-    sec_entity = const_cast<XrdSecEntity*>( Info->secEnv() );
+    sec_entity = Info->secEnv();
   }
 
   if ( !sec_entity ) {
-    sec_entity = new XrdSecEntity( "" );
-    sec_entity->tident = new char[16];
-    sec_entity->tident = strncpy( sec_entity->tident, "unknown", 7 );
-    sec_entity->tident[7]='\0';
+    unknown_entity.tident = const_cast<char*>( "unknown" );
+    sec_entity = &unknown_entity;
   }
-  
-  std::string retString ;
-  LfcString pfn;
 
-  if ( !Lfn2Pfn( path, pfn, sec_entity ) ) {
-    const char* filePath;
-    filePath = strstr( pfn.c_str(), mRoot.c_str() );
-    retString = mRedirHost ;
-
-    if ( filePath ) {
-      retString += "?eos.lfn=";
-      retString += filePath;
-      retString += "&eos.app=lfc";
-    }
+  //............................................................................
+  // The pfn is written by Lfn2Pfn straight into the redirection, after the
+  // redirection host, and already starts at the storage root
+  //............................................................................
+  char redirect[LFC_REDIRECT_MAXLEN];
+  int len = snprintf( redirect, sizeof( redirect ), "%s%s", mRedirHost.c_str(),
+                      sLfnOpaque );
+  int pfn_size = sizeof( redirect ) - len - sizeof( sAppOpaque ) + 1;
 
+  if ( ( pfn_size > 1 ) &&
+       !Lfn2Pfn( path, redirect + len, pfn_size, sec_entity, timed ) )
+  {
+    strcat( redirect + len, sAppOpaque );
     Resp.setErrCode( mRedirPort );
+
+    if ( mStats ) {
+      mStats->Add( LfcStats::eRedirectEos );
+    }
   } else {
-    LfcError.Emsg( "Locate", sec_entity->tident,
-                   "error=pfn not found, redirect to meta_mgr for lfn=", path );
-    retString = mMetaMgrHost.c_str();
+    LFC_EMSG( "Locate", "%s error=pfn not found, redirect to meta_mgr for lfn=%s",
+              sec_entity->tident, path );
+    snprintf( redirect, sizeof( redirect ), "%s", mMetaMgrHost.c_str() );
     Resp.setErrCode( mMetaMgrPort );
+
+    if ( mStats ) {
+      mStats->Add( LfcStats::eRedirectMgr );
+    }
   }
-  
-  Resp.setErrData( retString.c_str() );
+
+  Resp.setErrData( redirect );
+
+  if ( timed ) {
+    mStats->Record( LfcStats::eLocate, start );
+  }
+
   return SFS_REDIRECT;
 }
 
@@ -226,35 +691,287 @@ EosLfcPlugin::Space( XrdOucErrInfo& Resp,
 
 
 //------------------------------------------------------------------------------
-// Start the LFC session
+// Start the pool of LFC sessions
 //------------------------------------------------------------------------------
 int
 EosLfcPlugin::StartLfcSession()
 {
   int status;
   char* lfc_host;
-  char comment[80];
 
   if ( !( lfc_host = getenv( "LFC_HOST" ) ) ) {
-    mSessionInitialised = false;
     LfcError.Emsg( "StartLfcSession", "LFC_HOST not set." );
     return -EINVAL;
   }
 
-  strncpy( comment, "EOS-LFC@", 8 );
-  gethostname( comment + 8 , 72 );
+  mSessionPool = new LfcSessionPool( lfc_host, mLfcSessions, mLfcSessionCheck,
+                                     mBatchSize, mBatchWait );
 
-  if ( ( status = lfc_startsess( lfc_host, comment ) ) ) {
-    mSessionInitialised = false;
-    LfcError.Emsg( "StartLfcSession", "Unable to open LFC session on: ", lfc_host );
+  if ( ( status = mSessionPool->Start() ) ) {
+    LfcError.Emsg( "StartLfcSession", "Unable to start LFC sessions on: ", lfc_host );
     return status;
   }
 
-  mSessionInitialised = true;
   return 0;
 }
 
 
+//------------------------------------------------------------------------------
+// Start function of the snapshot thread
+//------------------------------------------------------------------------------
+void*
+EosLfcPlugin::StartSnapshotThread( void* arg )
+{
+  EosLfcPlugin* plugin = static_cast<EosLfcPlugin*>( arg );
+  plugin->SnapshotLoop();
+  return NULL;
+}
+
+
+//------------------------------------------------------------------------------
+// Save the cache to the snapshot file periodically
+//------------------------------------------------------------------------------
+void
+EosLfcPlugin::SnapshotLoop()
+{
+  mSnapshotCond.Lock();
+
+  while ( !mShutdown ) {
+    mSnapshotCond.Wait( mSnapshotInterval );
+
+    if ( mShutdown ) {
+      break;
+    }
+
+    mSnapshotCond.UnLock();
+    SaveSnapshot();
+    mSnapshotCond.Lock();
+  }
+
+  mSnapshotCond.UnLock();
+}
+
+
+//------------------------------------------------------------------------------
+// Save the cache to the snapshot file
+//------------------------------------------------------------------------------
+void
+EosLfcPlugin::SaveSnapshot()
+{
+  uint64_t num_entries;
+  int retc = mCache->Save( mSnapshotPath, num_entries );
+
+  if ( retc ) {
+    LfcError.Emsg( "SaveSnapshot", -retc, "save cache snapshot",
+                   mSnapshotPath.c_str() );
+  } else {
+    LFC_DEBUG( "SaveSnapshot", "Saved %llu cache entries to %s",
+               static_cast<unsigned long long>( num_entries ), mSnapshotPath.c_str() );
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Start function of the statistics thread
+//------------------------------------------------------------------------------
+void*
+EosLfcPlugin::StartStatsThread( void* arg )
+{
+  EosLfcPlugin* plugin = static_cast<EosLfcPlugin*>( arg );
+  plugin->StatsLoop();
+  return NULL;
+}
+
+
+//------------------------------------------------------------------------------
+// Dump the statistics periodically
+//------------------------------------------------------------------------------
+void
+EosLfcPlugin::StatsLoop()
+{
+  mStatsCond.Lock();
+
+  while ( !mShutdown ) {
+    mStatsCond.Wait( mStatsInterval );
+
+    if ( mShutdown ) {
+      break;
+    }
+
+    mStatsCond.UnLock();
+    DumpStats();
+    mStatsCond.Lock();
+  }
+
+  mStatsCond.UnLock();
+}
+
+
+//------------------------------------------------------------------------------
+// Write the statistics to the log and to the stats file if configured
+//------------------------------------------------------------------------------
+void
+EosLfcPlugin::DumpStats()
+{
+  LfcStats::Block total;
+  LfcCache::Stats cache;
+  LfcCache::Stats neg_cache;
+  std::vector<uint64_t> batch_fill;
+  uint64_t rebuilds = 0;
+  uint64_t coalesced = __sync_fetch_and_add( &mCoalesced, 0 );
+  time_t now = time( NULL );
+  memset( &cache, 0, sizeof( cache ) );
+  memset( &neg_cache, 0, sizeof( neg_cache ) );
+  mStats->Collect( total );
+
+  if ( mCache ) {
+    mCache->GetStats( cache );
+  }
+
+  if ( mNegCache ) {
+    mNegCache->GetStats( neg_cache );
+  }
+
+  if ( mSessionPool ) {
+    rebuilds = mSessionPool->GetNumRebuilds();
+    mSessionPool->GetBatchFill( batch_fill );
+  }
+
+  //............................................................................
+  // The stats file has one key=value per line, the log a summary
+  //............................................................................
+  std::ostringstream out;
+  std::ostringstream rewrite_hits;
+  std::ostringstream fill;
+  out << "timestamp=" << now << "\n"
+      << "uptime=" << ( now - mStatsStart ) << "\n";
+
+  for ( int i = 0; i < LfcStats::eNumCounters; i++ ) {
+    LfcStats::Counter counter = static_cast<LfcStats::Counter>( i );
+    out << "counter." << LfcStats::GetName( counter ) << "="
+        << total.mCounters[i] << "\n";
+  }
+
+  for ( int i = 0; i < LfcStats::sNumRewrites; i++ ) {
+    rewrite_hits << ( i ? "," : "" ) << total.mCounters[LfcStats::eRewriteHit + i];
+  }
+
+  out << "counter.coalesced=" << coalesced << "\n"
+      << "cache.entries=" << cache.mEntries << "\n"
+      << "cache.hits=" << cache.mHits << "\n"
+      << "cache.misses=" << cache.mMisses << "\n"
+      << "cache.expired=" << cache.mExpired << "\n"
+      << "cache.evicted=" << cache.mEvicted << "\n"
+      << "neg_cache.entries=" << neg_cache.mEntries << "\n"
+      << "neg_cache.hits=" << neg_cache.mHits << "\n"
+      << "neg_cache.misses=" << neg_cache.mMisses << "\n"
+      << "neg_cache.expired=" << neg_cache.mExpired << "\n"
+      << "neg_cache.evicted=" << neg_cache.mEvicted << "\n"
+      << "pool.rebuilds=" << rebuilds << "\n";
+
+  for ( size_t i = 1; i < batch_fill.size(); i++ ) {
+    out << "pool.batch_fill." << i << "=" << batch_fill[i] << "\n";
+    fill << ( ( i > 1 ) ? "," : "" ) << batch_fill[i];
+  }
+
+  uint64_t lookups = cache.mHits + cache.mMisses;
+  LFC_EMSG( "Stats", "uptime=%lds locate=%llu redirect_eos=%llu redirect_mgr=%llu "
+            "coalesced=%llu", static_cast<long>( now - mStatsStart ),
+            static_cast<unsigned long long>( total.mCounters[LfcStats::eRedirectEos] +
+                                             total.mCounters[LfcStats::eRedirectMgr] ),
+            static_cast<unsigned long long>( total.mCounters[LfcStats::eRedirectEos] ),
+            static_cast<unsigned long long>( total.mCounters[LfcStats::eRedirectMgr] ),
+            static_cast<unsigned long long>( coalesced ) );
+  LFC_EMSG( "Stats", "cache entries=%llu hits=%llu misses=%llu hit_rate=%.1f%% "
+            "expired=%llu evicted=%llu neg_entries=%llu neg_hits=%llu",
+            static_cast<unsigned long long>( cache.mEntries ),
+            static_cast<unsigned long long>( cache.mHits ),
+            static_cast<unsigned long long>( cache.mMisses ),
+            lookups ? 100.0 * cache.mHits / lookups : 0.0,
+            static_cast<unsigned long long>( cache.mExpired ),
+            static_cast<unsigned long long>( cache.mEvicted ),
+            static_cast<unsigned long long>( neg_cache.mEntries ),
+            static_cast<unsigned long long>( neg_cache.mHits ) );
+  LFC_EMSG( "Stats", "lfc found=%llu not_found=%llu failed=%llu storage_root=%llu "
+            "rewrite_hits=%s rebuilds=%llu batch_fill=%s",
+            static_cast<unsigned long long>( total.mCounters[LfcStats::eLfcFound] ),
+            static_cast<unsigned long long>( total.mCounters[LfcStats::eLfcNotFound] ),
+            static_cast<unsigned long long>( total.mCounters[LfcStats::eLfcFailed] ),
+            static_cast<unsigned long long>( total.mCounters[LfcStats::eStorageRoot] ),
+            rewrite_hits.str().c_str(), static_cast<unsigned long long>( rebuilds ),
+            fill.str().c_str() );
+
+  //............................................................................
+  // The counts of the sampled stages are scaled back to the number of calls so
+  // that they compare with the counters, the percentiles are not affected
+  //............................................................................
+  for ( int i = 0; i < LfcStats::eNumStages; i++ ) {
+    LfcStats::Stage stage = static_cast<LfcStats::Stage>( i );
+    const LfcHistogram& hist = total.mStages[i];
+    const char* name = LfcStats::GetName( stage );
+    uint64_t rate = LfcStats::GetSampleRate( stage );
+    uint64_t count = hist.GetCount() * rate;
+    out << "stage." << name << ".sample_rate=" << rate << "\n"
+        << "stage." << name << ".count=" << count << "\n"
+        << "stage." << name << ".sum_ns=" << hist.GetSum() * rate << "\n"
+        << "stage." << name << ".max_ns=" << hist.GetMax() << "\n"
+        << "stage." << name << ".p50_ns=" << hist.GetPercentile( 0.5 ) << "\n"
+        << "stage." << name << ".p90_ns=" << hist.GetPercentile( 0.9 ) << "\n"
+        << "stage." << name << ".p99_ns=" << hist.GetPercentile( 0.99 ) << "\n"
+        << "stage." << name << ".p999_ns=" << hist.GetPercentile( 0.999 ) << "\n"
+        << "stage." << name << ".buckets=";
+
+    //..........................................................................
+    // Non empty buckets as lowest_value:count
+    //..........................................................................
+    bool first = true;
+
+    for ( int j = 0; j < LfcHistogram::sNumBuckets; j++ ) {
+      if ( hist.GetBucket( j ) ) {
+        out << ( first ? "" : "," ) << LfcHistogram::BucketLow( j ) << ":"
+            << hist.GetBucket( j ) * rate;
+        first = false;
+      }
+    }
+
+    out << "\n";
+
+    if ( count ) {
+      LFC_EMSG( "Stats", "stage=%s count=%llu mean=%.1fus p50=%.1fus p90=%.1fus "
+                "p99=%.1fus p999=%.1fus max=%.1fus", name,
+                static_cast<unsigned long long>( count ),
+                hist.GetSum() * rate / 1000.0 / count, hist.GetPercentile( 0.5 ) / 1000.0,
+                hist.GetPercentile( 0.9 ) / 1000.0, hist.GetPercentile( 0.99 ) / 1000.0,
+                hist.GetPercentile( 0.999 ) / 1000.0, hist.GetMax() / 1000.0 );
+    }
+  }
+
+  if ( mStatsFile.empty() ) {
+    return;
+  }
+
+  //............................................................................
+  // Replace the stats file atomically so that readers never see half of it
+  //............................................................................
+  std::string tmp_path = mStatsFile + ".tmp";
+  std::string data = out.str();
+  FILE* file = fopen( tmp_path.c_str(), "w" );
+
+  if ( !file ) {
+    LfcError.Emsg( "DumpStats", errno, "open statistics file", tmp_path.c_str() );
+    return;
+  }
+
+  bool failed = ( fwrite( data.c_str(), 1, data.length(), file ) != data.length() );
+  failed = ( fclose( file ) != 0 ) || failed;
+
+  if ( failed || rename( tmp_path.c_str(), mStatsFile.c_str() ) ) {
+    LfcError.Emsg( "DumpStats", errno, "write statistics file", mStatsFile.c_str() );
+    unlink( tmp_path.c_str() );
+  }
+}
+
+
 //------------------------------------------------------------------------------
 // Parse the parameters for the LFC session
 //------------------------------------------------------------------------------
@@ -263,6 +980,10 @@ EosLfcPlugin::ParseParameters( LfcString input )
 {
   long int cacheTtl = LFC_CACHE_TTL;
   long int cacheMaxSize = LFC_CACHE_MAXSIZE;
+  long int cacheShards = LFC_CACHE_SHARDS;
+  LfcCache::Policy cachePolicy = LfcCache::eFifo;
+  long int negCacheTtl = LFC_NEG_CACHE_TTL;
+  long int negCacheMaxSize = LFC_NEG_CACHE_MAXSIZE;
   VectStrings::iterator it;
   VectStrings tokens = input.Split( " \t" );
 
@@ -296,25 +1017,173 @@ EosLfcPlugin::ParseParameters( LfcString input )
         return EINVAL;
       }
     } else if ( key == "cache_maxsize" ) {
-      if ( !( stringstream( val ) >> cacheMaxSize ) ) {
+      if ( !( std::stringstream( val ) >> cacheMaxSize ) ) {
         LfcError.Emsg( "ParseParameters", "EOS-LFC: Invalid numeric cache_maxsize: ", val );
         return EINVAL;
       }
-    } else {
-      LfcError.Emsg( "ParseParameters", "EOS-LFC: Invalid parameter: ", key );
-      return EINVAL;
-    }
-  }
-
+    } else if ( key == "cache_shards" ) {
+      if ( !( std::stringstream( val ) >> cacheShards ) || ( cacheShards <= 0 ) ) {
+        LfcError.Emsg( "ParseParameters", "EOS-LFC: Invalid numeric cache_shards: ", val );
+        return EINVAL;
+      }
+    } else if ( key == "cache_policy" ) {
+      if ( val == "fifo" ) {
+        cachePolicy = LfcCache::eFifo;
+      } else if ( val == "s3fifo" ) {
+        cachePolicy = LfcCache::eS3Fifo;
+      } else if ( val == "tinylfu" ) {
+        cachePolicy = LfcCache::eTinyLfu;
+      } else {
+        LfcError.Emsg( "ParseParameters", "EOS-LFC: Invalid cache_policy: ", val );
+        return EINVAL;
+      }
+    } else if ( key == "cache_maint_interval" ) {
+      if ( !( std::stringstream( val ) >> mCacheMaintInterval ) || ( mCacheMaintInterval < 0 ) ) {
+        LfcError.Emsg( "ParseParameters", "EOS-LFC: Invalid numeric cache_maint_interval: ", val );
+        return EINVAL;
+      }
+    } else if ( key == "cache_high_watermark" ) {
+      if ( !( std::stringstream( val ) >> mCacheHighWatermark ) || ( mCacheHighWatermark < 0 ) ) {
+        LfcError.Emsg( "ParseParameters", "EOS-LFC: Invalid numeric cache_high_watermark: ", val );
+        return EINVAL;
+      }
+    } else if ( key == "neg_cache_ttl" ) {
+      if ( !( std::stringstream( val ) >> negCacheTtl ) ) {
+        LfcError.Emsg( "ParseParameters", "EOS-LFC: Invalid numeric neg_cache_ttl: ", val );
+        return EINVAL;
+      }
+    } else if ( key == "neg_cache_maxsize" ) {
+      if ( !( std::stringstream( val ) >> negCacheMaxSize ) ) {
+        LfcError.Emsg( "ParseParameters", "EOS-LFC: Invalid numeric neg_cache_maxsize: ", val );
+        return EINVAL;
+      }
+    } else if ( key == "lfc_sessions" ) {
+      if ( !( std::stringstream( val ) >> mLfcSessions ) || ( mLfcSessions <= 0 ) ) {
+        LfcError.Emsg( "ParseParameters", "EOS-LFC: Invalid numeric lfc_sessions: ", val );
+        return EINVAL;
+      }
+    } else if ( key == "lfc_session_check" ) {
+      if ( !( std::stringstream( val ) >> mLfcSessionCheck ) || ( mLfcSessionCheck <= 0 ) ) {
+        LfcError.Emsg( "ParseParameters", "EOS-LFC: Invalid numeric lfc_session_check: ", val );
+        return EINVAL;
+      }
+    } else if ( key == "batch_size" ) {
+      if ( !( std::stringstream( val ) >> mBatchSize ) || ( mBatchSize <= 0 ) ) {
+        LfcError.Emsg( "ParseParameters", "EOS-LFC: Invalid numeric batch_size: ", val );
+        return EINVAL;
+      }
+    } else if ( key == "batch_wait_ms" ) {
+      if ( !( std::stringstream( val ) >> mBatchWait ) || ( mBatchWait < 0 ) ) {
+        LfcError.Emsg( "ParseParameters", "EOS-LFC: Invalid numeric batch_wait_ms: ", val );
+        return EINVAL;
+      }
+    } else if ( key == "prefetch" ) {
+      if ( val == "on" ) {
+        mPrefetch = true;
+      } else if ( val == "off" ) {
+        mPrefetch = false;
+      } else {
+        LfcError.Emsg( "ParseParameters", "EOS-LFC: Invalid prefetch: ", val );
+        return EINVAL;
+      }
+    } else if ( key == "prefetch_maxdir" ) {
+      if ( !( std::stringstream( val ) >> mPrefetchMaxDir ) || ( mPrefetchMaxDir <= 0 ) ) {
+        LfcError.Emsg( "ParseParameters", "EOS-LFC: Invalid numeric prefetch_maxdir: ", val );
+        return EINVAL;
+      }
+    } else if ( key == "prefetch_rate" ) {
+      if ( !( std::stringstream( val ) >> mPrefetchRate ) || ( mPrefetchRate <= 0 ) ) {
+        LfcError.Emsg( "ParseParameters", "EOS-LFC: Invalid numeric prefetch_rate: ", val );
+        return EINVAL;
+      }
+    } else if ( key == "warmup_paths" ) {
+      mWarmupPaths = val.Split( "," );
+    } else if ( key == "warmup_threads" ) {
+      if ( !( std::stringstream( val ) >> mWarmupThreads ) || ( mWarmupThreads <= 0 ) ) {
+        LfcError.Emsg( "ParseParameters", "EOS-LFC: Invalid numeric warmup_threads: ", val );
+        return EINVAL;
+      }
+    } else if ( key == "warmup_rate" ) {
+      if ( !( std::stringstream( val ) >> mWarmupRate ) || ( mWarmupRate <= 0 ) ) {
+        LfcError.Emsg( "ParseParameters", "EOS-LFC: Invalid numeric warmup_rate: ", val );
+        return EINVAL;
+      }
+    } else if ( key == "rewrite_mode" ) {
+      if ( val == "parallel" ) {
+        mRewriteParallel = true;
+      } else if ( val == "serial" ) {
+        mRewriteParallel = false;
+      } else {
+        LfcError.Emsg( "ParseParameters", "EOS-LFC: Invalid rewrite_mode: ", val );
+        return EINVAL;
+      }
+    } else if ( key == "log_queue_size" ) {
+      if ( !( std::stringstream( val ) >> mLogQueueSize ) || ( mLogQueueSize < 0 ) ) {
+        LfcError.Emsg( "ParseParameters", "EOS-LFC: Invalid numeric log_queue_size: ", val );
+        return EINVAL;
+      }
+    } else if ( key == "stats_interval" ) {
+      if ( !( std::stringstream( val ) >> mStatsInterval ) || ( mStatsInterval < 0 ) ) {
+        LfcError.Emsg( "ParseParameters", "EOS-LFC: Invalid numeric stats_interval: ", val );
+        return EINVAL;
+      }
+    } else if ( key == "stats_file" ) {
+      mStatsFile = val;
+    } else if ( key == "cache_snapshot" ) {
+      mSnapshotPath = val;
+    } else if ( key == "cache_snapshot_interval" ) {
+      if ( !( std::stringstream( val ) >> mSnapshotInterval ) || ( mSnapshotInterval <= 0 ) ) {
+        LfcError.Emsg( "ParseParameters", "EOS-LFC: Invalid numeric cache_snapshot_interval: ", val );
+        return EINVAL;
+      }
+    } else {
+      LfcError.Emsg( "ParseParameters", "EOS-LFC: Invalid parameter: ", key );
+      return EINVAL;
+    }
+  }
+
   if ( mRedirHost.empty() || mMetaMgrHost.empty() ) {
     LfcError.Emsg( "ParseParameters", "The rdrhost and meta_mgr_host parameters are mandatory!" );
     return ENODATA;
   }
+
+  //............................................................................
+  // Pfns longer than what fits in the redirection built by Locate are never
+  // cached, a cache hit could not be served
+  //............................................................................
+  size_t opaque_len = mRedirHost.length() + strlen( sLfnOpaque ) + strlen( sAppOpaque );
+
+  if ( opaque_len + 1 >= LFC_REDIRECT_MAXLEN ) {
+    LfcError.Emsg( "ParseParameters", "EOS-LFC: rdrhost too long: ", mRedirHost.c_str() );
+    return EINVAL;
+  }
+
+  mPfnMaxLen = LFC_REDIRECT_MAXLEN - opaque_len - 1;
   
   //............................................................................
-  // Initialise the cache and the list of managers after getting all params
+  // Initialise the replica filter, the cache and the list of managers after
+  // getting all params
   //............................................................................
-  mCache = new LfcCache( cacheTtl, cacheMaxSize );
+  mMatcher.Build( mMatch, mNotMatch );
+  mRootSearcher.Set( mRoot );
+  mLfcCacheTtl = cacheTtl;
+  mLfcCacheMaxSize = cacheMaxSize;
+  mCache = new LfcCache( cacheTtl, cacheMaxSize, cacheShards, cachePolicy );
+
+  //............................................................................
+  // Negative caching can be disabled by setting its size or ttl to 0
+  //............................................................................
+  if ( ( negCacheTtl > 0 ) && ( negCacheMaxSize > 0 ) ) {
+    mNegCache = new LfcCache( negCacheTtl, negCacheMaxSize, cacheShards );
+  }
+
+  //............................................................................
+  // A directory is not prefetched again while its entries are still cached
+  //............................................................................
+  if ( mPrefetch ) {
+    mPrefetchDirs = new LfcCache( cacheTtl, cacheMaxSize / 10 + 1, cacheShards );
+  }
+
   return 0;
 }
 
@@ -323,219 +1192,654 @@ EosLfcPlugin::ParseParameters( LfcString input )
 // Logical file name to physical file name translation
 //------------------------------------------------------------------------------
 int
-EosLfcPlugin::Lfn2Pfn( LfcString           lfn,
-                       LfcString&          pfn,
-                       const XrdSecEntity* secEntity )
+EosLfcPlugin::Lfn2Pfn( const LfcStringView& lfn,
+                       char*                pfn,
+                       size_t               size,
+                       const XrdSecEntity*  secEntity,
+                       bool                 timed )
 {
-  char msg[4096];
-  bool cache_miss = false;
-  VectStrings::iterator it;
-  pfn = "";
+  size_t pfn_len;
+  const int lfn_len = static_cast<int>( lfn.length() );
 
   //............................................................................
-  // Check cache for lfn
+  // Check cache for lfn, a hit is served without copying the lfn or the pfn
   //............................................................................
-  if ( ( mCache && !( mCache->GetEntry( lfn, pfn ) ) ) || ( !mCache ) ) {
-    cache_miss = true;
-    sprintf( msg, "%s Cache miss for lfn=%s.", secEntity->tident,
-             static_cast<char*>( lfn ) );
-    LfcError.Log( SYS_LOG_01, "Lfn2Pfn", msg );
+  uint64_t start = timed ? LfcStats::Now() : 0;
+  bool hit = mCache && mCache->GetEntry( lfn.data(), lfn.length(), pfn, size, pfn_len );
 
-    if ( ( pfn = LfnIsPfn( lfn ) ) ) {
-      //........................................................................
-      // No LFC lookup needed, input filename contains storage root
-      //........................................................................
-      sprintf( msg, "%s No LFC lookup needed, file contains storage root.",
-               secEntity->tident );
-      LfcError.Emsg( "Lfn2Pfn", msg );
-    } else if ( !strcmp( lfn, "/atlas" ) ) {
-      //........................................................................
-      // We currently support translations only for /atlas files
-      //........................................................................
-      sprintf( msg, "%s Translations supported only for /atlas files.",
+  if ( timed ) {
+    mStats->Record( LfcStats::eCacheLookup, start );
+  }
+
+  if ( hit ) {
+    LFC_DEBUG( "Lfn2Pfn", "%s Cache hit for lfn=%.*s -> pfn=%s. ", secEntity->tident,
+               lfn_len, lfn.data(), pfn );
+    return SFS_OK;
+  }
+
+  LFC_DEBUG( "Lfn2Pfn", "%s Cache miss for lfn=%.*s.", secEntity->tident, lfn_len,
+             lfn.data() );
+  const char* root;
+  LfcString found;
+  bool lfc_queried = false;
+
+  if ( ( root = LfnIsPfn( lfn ) ) ) {
+    //..........................................................................
+    // No LFC lookup needed, input filename contains storage root
+    //..........................................................................
+    LFC_DEBUG( "Lfn2Pfn", "%s No LFC lookup needed, file contains storage root.",
                secEntity->tident );
-      LfcError.Emsg( "Lfn2Pfn", msg );
-      pfn = mRoot;
-    } else {
-      VectStrings possibles = RewriteLfn( lfn );
+    found.assign( root, lfn.data() + lfn.length() - root );
 
-      for ( it = possibles.begin(); it != possibles.end(); it++ ) {
-        sprintf( msg, "%s LFC rewrite lfn=%s as new_lfn=%s. ", secEntity->tident,
-                 static_cast<char*>( lfn ), static_cast<char*>( *it ) );
-        LfcError.Log( SYS_LOG_01, "Lfn2Pfn", msg ) ;
+    if ( mStats ) {
+      mStats->Add( LfcStats::eStorageRoot );
+    }
+  } else if ( lfn.Equals( "/atlas" ) ) {
+    //..........................................................................
+    // We currently support translations only for /atlas files
+    //..........................................................................
+    LFC_EMSG( "Lfn2Pfn", "%s Translations supported only for /atlas files.",
+              secEntity->tident );
+    found = mRoot;
+  } else if ( mNegCache &&
+              mNegCache->GetEntry( lfn.data(), lfn.length(), pfn, size, pfn_len ) )
+  {
+    //..........................................................................
+    // Recently looked up and not found in the LFC
+    //..........................................................................
+    if ( mStats ) {
+      mStats->Add( LfcStats::eNegCacheHit );
+    }
 
-        if ( ( pfn = QueryLfc( *it, secEntity ) ) ) {
-          break;
-        }
-      }
+    if ( LfcError.getMsgMask() & LFC_LOG_DEBUG ) {
+      uint64_t hits, misses;
+      mNegCache->GetStats( hits, misses );
+      LFC_DEBUG( "Lfn2Pfn", "%s Negative cache hit for lfn=%.*s, neg_hits=%llu "
+                 "neg_misses=%llu.", secEntity->tident, lfn_len, lfn.data(),
+                 static_cast<unsigned long long>( hits ),
+                 static_cast<unsigned long long>( misses ) );
     }
+
+    return -ENOENT;
   } else {
-    sprintf( msg, "%s Cache hit for lfn=%s -> pfn=%s. ", secEntity->tident,
-             static_cast<char*>( lfn ), static_cast<char*>( pfn ) );
-    LfcError.Emsg( "Lfn2Pfn", msg ) ;
+    //..........................................................................
+    // Query the LFC or wait for the result of a concurrent query of the lfn,
+    // the caches are updated by the thread doing the query
+    //..........................................................................
+    found = LookupLfc( lfn.str(), secEntity );
+    lfc_queried = true;
   }
 
-  if ( !pfn ) {
-    sprintf( msg, "%s No valid replica for lfn=%s. ", secEntity->tident,
-             static_cast<char*>( lfn ) );
-    LfcError.Emsg( "Lfn2Pfn", msg ) ;
+  if ( found.empty() ) {
+    LFC_EMSG( "Lfn2Pfn", "%s No valid replica for lfn=%.*s. ", secEntity->tident,
+              lfn_len, lfn.data() );
     return -ENOENT;
   }
 
-  if ( cache_miss ) {
+  if ( found.length() >= size ) {
+    LFC_EMSG( "Lfn2Pfn", "%s Pfn too long for lfn=%.*s. ", secEntity->tident,
+              lfn_len, lfn.data() );
+    return -ENAMETOOLONG;
+  }
+
+  if ( !lfc_queried && mCache ) {
     //..........................................................................
     // Insert the new entry in cache
     //..........................................................................
-    mCache->Insert( lfn, pfn );
+    mCache->Insert( lfn.str(), found );
   }
 
+  memcpy( pfn, found.c_str(), found.length() + 1 );
   return SFS_OK;
 }
 
 
 //------------------------------------------------------------------------------
-// Check if logical file name is already contains the storage root
+// Look up an lfn in the LFC coalescing the concurrent lookups of the same lfn
 //------------------------------------------------------------------------------
 LfcString
-EosLfcPlugin::LfnIsPfn( LfcString lfn )
+EosLfcPlugin::LookupLfc( const LfcString& lfn, const XrdSecEntity* secEntity )
 {
-  const char* pfn = NULL;
+  bool lfc_failed = false;
+  bool leader = false;
+  LfcString pfn;
+  LfcString resolved;
+  InFlight* flight = NULL;
+  std::map<std::string, InFlight*>::iterator iter;
 
-  if ( mRoot == "" ) {
-    return NULL;
+  //............................................................................
+  // The first thread looking up the lfn becomes the leader, the others wait
+  // for its result
+  //............................................................................
+  mInFlightMutex.Lock();      // -->
+  iter = mInFlight.find( lfn );
+
+  if ( iter == mInFlight.end() ) {
+    flight = new InFlight();
+    mInFlight.insert( std::make_pair( lfn, flight ) );
+    leader = true;
+  } else {
+    flight = iter->second;
+  }
+
+  flight->mRefCount++;
+  mInFlightMutex.UnLock();    // <--
+
+  if ( !leader ) {
+    uint64_t coalesced = __sync_add_and_fetch( &mCoalesced, 1 );
+    flight->mCond.Lock();
+
+    while ( !flight->mDone ) {
+      flight->mCond.Wait();
+    }
+
+    pfn = flight->mPfn;
+    flight->mCond.UnLock();
+    ReleaseInFlight( flight );
+    LFC_DEBUG( "LookupLfc", "%s Coalesced LFC lookup for lfn=%s, total_coalesced=%llu.",
+               secEntity->tident, lfn.c_str(),
+               static_cast<unsigned long long>( coalesced ) );
+    return pfn;
+  }
+
+  uint64_t start = mStats ? LfcStats::Now() : 0;
+  VectStrings possibles = LfcRewriteLfn( lfn );
+  size_t candidate = 0;
+
+  if ( mStats ) {
+    mStats->Record( LfcStats::eRewrite, start );
+  }
+
+  if ( mRewriteParallel && ( possibles.size() > 1 ) ) {
+    //..........................................................................
+    // Send the queries for all the rewrites at once and take the answers in
+    // the order of the rewrites, the queries not needed any more are dropped
+    //..........................................................................
+    std::vector<ReplicaJob*> jobs;
+    size_t i;
+
+    for ( i = 0; i < possibles.size(); i++ ) {
+      LFC_DEBUG( "Lfn2Pfn", "%s LFC rewrite lfn=%s as new_lfn=%s. ", secEntity->tident,
+                 lfn.c_str(), possibles[i].c_str() );
+      jobs.push_back( new ReplicaJob( possibles[i], mStats ) );
+      mSessionPool->Submit( jobs.back() );
+    }
+
+    for ( i = 0; i < jobs.size(); i++ ) {
+      jobs[i]->Wait();
+      pfn = SelectReplica( possibles[i], *jobs[i], secEntity, lfc_failed );
+      delete jobs[i];
+
+      if ( pfn ) {
+        resolved = possibles[i];
+        candidate = i;
+        break;
+      }
+    }
+
+    for ( i++; i < jobs.size(); i++ ) {
+      mSessionPool->Abandon( jobs[i] );
+    }
+  } else {
+    for ( VectStrings::iterator it = possibles.begin(); it != possibles.end(); it++ ) {
+      LFC_DEBUG( "Lfn2Pfn", "%s LFC rewrite lfn=%s as new_lfn=%s. ", secEntity->tident,
+                 lfn.c_str(), it->c_str() );
+
+      if ( ( pfn = QueryLfc( *it, secEntity, lfc_failed ) ) ) {
+        resolved = *it;
+        candidate = it - possibles.begin();
+        break;
+      }
+    }
+  }
+
+  //............................................................................
+  // Update the caches before dropping the in-flight lookup so that no new
+  // query is started for the lfn in between. The lfn is remembered as not
+  // being in EOS only if all the LFC queries gave a definitive answer.
+  //............................................................................
+  if ( pfn ) {
+    if ( pfn.length() > mPfnMaxLen ) {
+      LFC_EMSG( "LookupLfc", "%s Pfn too long to redirect, not cached for lfn=%s. ",
+                secEntity->tident, lfn.c_str() );
+    } else if ( mCache ) {
+      mCache->Insert( lfn, pfn );
+
+      if ( mPrefetch ) {
+        Prefetch( lfn, resolved );
+      }
+    }
+  } else if ( mNegCache && !lfc_failed ) {
+    mNegCache->Insert( lfn, "" );
+  }
+
+  mInFlightMutex.Lock();      // -->
+  mInFlight.erase( lfn );
+  mInFlightMutex.UnLock();    // <--
+
+  flight->mCond.Lock();
+  flight->mPfn = pfn;
+  flight->mDone = true;
+  flight->mCond.Broadcast();
+  flight->mCond.UnLock();
+  ReleaseInFlight( flight );
+
+  if ( mStats ) {
+    if ( pfn ) {
+      if ( candidate >= static_cast<size_t>( LfcStats::sNumRewrites ) ) {
+        candidate = LfcStats::sNumRewrites - 1;
+      }
+
+      mStats->Add( LfcStats::eLfcFound );
+      mStats->Add( static_cast<LfcStats::Counter>( LfcStats::eRewriteHit + candidate ) );
+    } else {
+      mStats->Add( LfcStats::eLfcNotFound );
+    }
+
+    mStats->Record( LfcStats::eLfcLookup, start );
   }
 
-  pfn = strstr( lfn.c_str(), mRoot.c_str() );
   return pfn;
 }
 
 
 //------------------------------------------------------------------------------
-// Compensate for varying conventions for LFC path
+// Drop a reference to an in-flight lookup
 //------------------------------------------------------------------------------
-VectStrings
-EosLfcPlugin::RewriteLfn( LfcString lfn )
+void
+EosLfcPlugin::ReleaseInFlight( InFlight* flight )
 {
-  VectStrings ret;
-  LfcString rebuild_path;
-  ret.push_back( lfn );                         // 0) Unmodified LFC path
+  bool last;
+  mInFlightMutex.Lock();      // -->
+  last = ( --flight->mRefCount == 0 );
+  mInFlightMutex.UnLock();    // <--
+
+  if ( last ) {
+    delete flight;
+  }
+}
+
 
-  if ( !lfn.StartsWith( "/grid" ) )
-    ret.push_back( "/grid" + lfn );             // 1) Try adding /grid prefix
+//------------------------------------------------------------------------------
+// Queue the prefetch of the siblings of a resolved lfn
+//------------------------------------------------------------------------------
+void
+EosLfcPlugin::Prefetch( const std::string& lfn, const std::string& resolved )
+{
+  size_t lfn_pos = lfn.rfind( '/' );
+  size_t resolved_pos = resolved.rfind( '/' );
 
-  VectStrings components = lfn.Split( "/" );
+  if ( ( lfn_pos == std::string::npos ) || ( resolved_pos == std::string::npos ) ||
+       ( resolved.find( "!GUID=" ) != std::string::npos ) )
+  {
+    return;
+  }
 
-  if ( components.size() > 2 && components[0] == "atlas" ) {
-    if ( components[1] != "dq2" ) {             // 2) /atlas/!dq2 -> /grid/atlas/dq2
-      rebuild_path = LfcString::Join( VectStrings( components.begin() + 1, components.end() ), "/" );
-      ret.push_back( "/grid/atlas/dq2" + rebuild_path );
+  std::string lfn_dir = lfn.substr( 0, lfn_pos + 1 );
+  std::string catalog_dir = resolved.substr( 0, resolved_pos + 1 );
+  std::string dummy;
+
+  //............................................................................
+  // Skip the directories prefetched recently and respect the rate limit
+  //............................................................................
+  if ( mPrefetchDirs->GetEntry( catalog_dir, dummy ) ) {
+    return;
+  }
+
+  time_t now = time( NULL );
+  mPrefetchMutex.Lock();      // -->
+
+  if ( now != mPrefetchSecond ) {
+    mPrefetchSecond = now;
+    mPrefetchCount = 0;
+  }
+
+  bool allowed = ( mPrefetchCount < mPrefetchRate );
+
+  if ( allowed ) {
+    mPrefetchCount++;
+  }
+
+  mPrefetchMutex.UnLock();    // <--
+
+  if ( !allowed ) {
+    LFC_DEBUG( "Prefetch", "Rate limit reached, skip prefetch of %s",
+               catalog_dir.c_str() );
+    return;
+  }
+
+  mPrefetchDirs->Insert( catalog_dir, "" );
+  mSessionPool->Submit( new PrefetchJob( this, catalog_dir, lfn_dir ), true );
+}
+
+
+//------------------------------------------------------------------------------
+// List a directory in the LFC and insert the replicas of its files in cache
+//------------------------------------------------------------------------------
+void
+EosLfcPlugin::PrefetchDir( const std::string& catalogDir, const std::string& lfnDir )
+{
+  int num_inserted = 0;
+  int num_entries = CacheDir( catalogDir, lfnDir, mPrefetchMaxDir, num_inserted, NULL );
+
+  if ( num_entries < 0 ) {
+    return;
+  }
+
+  LFC_DEBUG( "PrefetchDir", "Prefetched %i of %i entries from dir=%s", num_inserted,
+             num_entries, catalogDir.c_str() );
+}
+
+
+//------------------------------------------------------------------------------
+// List a directory in the LFC and insert the replicas of its files in cache
+//------------------------------------------------------------------------------
+int
+EosLfcPlugin::CacheDir( const std::string& catalogDir,
+                        const std::string& lfnDir,
+                        int                maxEntries,
+                        int&               numInserted,
+                        VectStrings*       subDirs )
+{
+  int num_entries = 0;
+  const char* matching;
+  struct lfc_direnrep* entry;
+  lfc_DIR* dirp = lfc_opendirg( catalogDir.c_str(), NULL );
+
+  if ( !dirp ) {
+    LfcError.Emsg( "CacheDir", serrno, "open LFC directory", catalogDir.c_str() );
+    return -1;
+  }
+
+  //............................................................................
+  // Each entry comes with its replicas, the first one passing the filters is
+  // used like in SelectReplica
+  //............................................................................
+  while ( ( num_entries < maxEntries ) &&
+          ( entry = lfc_readdirxr( dirp, NULL ) ) )
+  {
+    num_entries++;
+
+    if ( S_ISDIR( entry->filemode ) ) {
+      if ( subDirs ) {
+        subDirs->push_back( entry->d_name );
+      }
+
+      continue;
     }
 
-    //else if (components[1] != "pathena") {   // 3) /atlas/!pathena -> /grid/atlas/pathena
-    // 4) etc..
+    for ( int i = 0; i < entry->nbreplicas; i++ ) {
+      char* pfn = entry->rep[i].sfn;
+
+      if ( !pfn || !*pfn || !( pfn = FilterReplica( pfn, matching ) ) ) {
+        continue;
+      }
+
+      if ( strlen( pfn ) <= mPfnMaxLen ) {
+        mCache->Insert( lfnDir + entry->d_name, pfn );
+        numInserted++;
+      }
+
+      break;
+    }
   }
 
-  return ret;
+  ( void ) lfc_closedir( dirp );
+  return num_entries;
 }
 
 
 //------------------------------------------------------------------------------
-// Query the LFC about an lfn
+// Start the warm-up threads
 //------------------------------------------------------------------------------
-LfcString
-EosLfcPlugin::QueryLfc( LfcString lfn, const XrdSecEntity* secEntity )
+int
+EosLfcPlugin::StartWarmup()
 {
-  char msg[4096];
-  struct lfc_filereplica* rep_entries = NULL;
-  LfcString ret = NULL;
-  int status;
-  int n_entries;
-  char* pfn = NULL;
-  char* guid;
-  VectStrings::iterator it;
-  guid = strstr( ( char* )lfn, "!GUID=" );
   //............................................................................
-  // Query LFC
+  // Each warm-up path is either a directory in the LFC or a pair
+  // catalog_dir:lfn_dir when the lfns are requested under another prefix
   //............................................................................
-  if ( guid == NULL ) {
-    status = lfc_getreplica( lfn, NULL/*guid*/, NULL/*se*/, &n_entries, &rep_entries );
-  } else {
-    status = lfc_getreplica( NULL ,
-                             const_cast<const char*>( guid + 6 ),
-                             NULL/*se*/,
-                             &n_entries,
-                             &rep_entries );
+  for ( VectStrings::iterator it = mWarmupPaths.begin(); it != mWarmupPaths.end(); it++ ) {
+    VectStrings dirs = it->Split( ":" );
+
+    if ( ( dirs.size() < 1 ) || ( dirs.size() > 2 ) ) {
+      LfcError.Emsg( "StartWarmup", "Invalid warm-up path: ", it->c_str() );
+      return -EINVAL;
+    }
+
+    std::string catalog_dir = dirs[0];
+    std::string lfn_dir = ( dirs.size() == 2 ) ? dirs[1] : dirs[0];
+
+    if ( catalog_dir[catalog_dir.length() - 1] != '/' ) {
+      catalog_dir += '/';
+    }
+
+    if ( lfn_dir[lfn_dir.length() - 1] != '/' ) {
+      lfn_dir += '/';
+    }
+
+    mWarmupDirs.push_back( std::make_pair( catalog_dir, lfn_dir ) );
   }
 
-  if ( status ) {
-    //..........................................................................
-    // Got error, recovery possible here, but most likely lfn not found
-    //..........................................................................
-    //LfcError.Emsg( "QueryLfc", "Error while doing the query for lfn=", lfn );
-    return NULL;
+  gettimeofday( &mWarmupStart, NULL );
+  mWarmupLastLog = mWarmupStart.tv_sec;
+
+  for ( int i = 0; i < mWarmupThreads; i++ ) {
+    pthread_t thread;
+
+    if ( XrdSysThread::Run( &thread, EosLfcPlugin::StartWarmupThread,
+                            static_cast<void*>( this ), XRDSYSTHREAD_HOLD,
+                            "LFC cache warm-up" ) )
+    {
+      LfcError.Emsg( "StartWarmup", errno, "start cache warm-up thread" );
+      return -EAGAIN;
+    }
+
+    mWarmupThreadIds.push_back( thread );
   }
 
-  bool replica_found = false;
+  return 0;
+}
 
-  for ( int i = 0; i < n_entries; ++i ) {
-    pfn = rep_entries[i].sfn;
 
+//------------------------------------------------------------------------------
+// Start function of the warm-up threads
+//------------------------------------------------------------------------------
+void*
+EosLfcPlugin::StartWarmupThread( void* arg )
+{
+  EosLfcPlugin* plugin = static_cast<EosLfcPlugin*>( arg );
+  plugin->WarmupLoop();
+  return NULL;
+}
+
+
+//------------------------------------------------------------------------------
+// Walk the warm-up directory trees and fill the cache
+//------------------------------------------------------------------------------
+void
+EosLfcPlugin::WarmupLoop()
+{
+  //............................................................................
+  // The warm-up uses its own sessions so that it doesn't hold up the ones
+  // serving the Locate requests
+  //............................................................................
+  bool session = LfcSessionPool::OpenSession( mSessionPool->GetHost() );
+
+  mWarmupCond.Lock();
+
+  while ( true ) {
     //..........................................................................
-    // Reply may include empty names
+    // Wait for work while other threads are still listing directories which
+    // can add subdirectories to the queue
     //..........................................................................
-    if ( strlen( pfn ) == 0 ) {
-      continue;
+    while ( !mWarmupStop && mWarmupDirs.empty() && mWarmupBusy ) {
+      mWarmupCond.Wait();
+    }
+
+    if ( mWarmupStop || mWarmupDirs.empty() ||
+         ( mWarmupInserted >= static_cast<uint64_t>( mLfcCacheMaxSize ) ) )
+    {
+      break;
+    }
+
+    std::pair<std::string, std::string> dir = mWarmupDirs.front();
+    mWarmupDirs.pop_front();
+    mWarmupBusy++;
+    mWarmupCond.UnLock();
+
+    VectStrings sub_dirs;
+    int num_inserted = 0;
+    int num_entries = CacheDir( dir.first, dir.second, INT_MAX, num_inserted, &sub_dirs );
+
+    mWarmupCond.Lock();
+    mWarmupBusy--;
+
+    for ( VectStrings::iterator it = sub_dirs.begin(); it != sub_dirs.end(); it++ ) {
+      mWarmupDirs.push_back( std::make_pair( dir.first + *it + "/",
+                                             dir.second + *it + "/" ) );
+    }
+
+    mWarmupCond.Broadcast();
+    mWarmupNumDirs++;
+    mWarmupEntries += ( num_entries > 0 ) ? num_entries : 0;
+    mWarmupInserted += num_inserted;
+    time_t now = time( NULL );
+
+    if ( now - mWarmupLastLog >= sWarmupLogInterval ) {
+      mWarmupLastLog = now;
+      LFC_EMSG( "Warmup", "Warm-up in progress: dirs=%llu queued_dirs=%lu entries=%llu "
+                "cached=%llu elapsed=%lis",
+                static_cast<unsigned long long>( mWarmupNumDirs ),
+                static_cast<unsigned long>( mWarmupDirs.size() ),
+                static_cast<unsigned long long>( mWarmupEntries ),
+                static_cast<unsigned long long>( mWarmupInserted ),
+                static_cast<long>( now - mWarmupStart.tv_sec ) );
     }
 
-    sprintf( msg, "%s Testing pfn=%s. ", secEntity->tident, static_cast<char*>( pfn ) );
-    LfcError.Log( SYS_LOG_02, "Lfn2Pfn", msg ) ;
-    
     //..........................................................................
-    // Check for forbidden substrings
+    // Throughput limit - sleep until the entries read so far fit in the rate
     //..........................................................................
-    bool forbidden = false;
-
-    for ( it = mNotMatch.begin(); it !=  mNotMatch.end(); it++ ) {
-      if ( strstr( pfn, *it ) ) {
-        forbidden = true;
+    while ( !mWarmupStop ) {
+      struct timeval tv;
+      gettimeofday( &tv, NULL );
+      int64_t elapsed_ms = ( tv.tv_sec - mWarmupStart.tv_sec ) * 1000LL +
+                           ( tv.tv_usec - mWarmupStart.tv_usec ) / 1000;
+      int64_t ahead_ms = static_cast<int64_t>( mWarmupEntries ) * 1000 / mWarmupRate -
+                         elapsed_ms;
+
+      if ( ahead_ms <= 0 ) {
         break;
       }
-    }
 
-    if ( forbidden ) {
-      continue;
+      mWarmupCond.WaitMS( static_cast<int>( ahead_ms ) );
     }
+  }
+
+  //............................................................................
+  // The last thread to finish reports the outcome
+  //............................................................................
+  mWarmupCond.Broadcast();
+
+  if ( ++mWarmupDone == mWarmupThreads ) {
+    LFC_EMSG( "Warmup", "Warm-up %s: dirs=%llu entries=%llu cached=%llu elapsed=%lis",
+              mWarmupStop ? "stopped" : "done",
+              static_cast<unsigned long long>( mWarmupNumDirs ),
+              static_cast<unsigned long long>( mWarmupEntries ),
+              static_cast<unsigned long long>( mWarmupInserted ),
+              static_cast<long>( time( NULL ) - mWarmupStart.tv_sec ) );
+  }
+
+  mWarmupCond.UnLock();
+
+  if ( session ) {
+    ( void ) lfc_endsess();
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Check if logical file name is already contains the storage root
+//------------------------------------------------------------------------------
+const char*
+EosLfcPlugin::LfnIsPfn( const LfcStringView& lfn ) const
+{
+  if ( mRoot == "" ) {
+    return NULL;
+  }
+
+  return mRootSearcher.Find( lfn.data(), lfn.length() );
+}
+
+
+//------------------------------------------------------------------------------
+// Query the LFC about an lfn
+//------------------------------------------------------------------------------
+LfcString
+EosLfcPlugin::QueryLfc( const LfcString&    lfn,
+                        const XrdSecEntity* secEntity,
+                        bool&               failed )
+{
+  //............................................................................
+  // Query LFC using one of the sessions of the pool
+  //............................................................................
+  ReplicaJob job( lfn, mStats );
+  mSessionPool->Execute( &job );
+  return SelectReplica( lfn, job, secEntity, failed );
+}
+
+
+//------------------------------------------------------------------------------
+// Select the replica to use from the result of an LFC query
+//------------------------------------------------------------------------------
+LfcString
+EosLfcPlugin::SelectReplica( const LfcString&    lfn,
+                             ReplicaJob&         job,
+                             const XrdSecEntity* secEntity,
+                             bool&               failed )
+{
+  LfcString ret = NULL;
+  int n_entries = job.mNumEntries;
+  struct lfc_filereplica* rep_entries = job.mEntries;
+  char* pfn = NULL;
+  const char* matching = NULL;
 
+  if ( job.mStatus ) {
     //..........................................................................
-    // Check for required match string, if specified (match is boolean OR)
+    // Got error, recovery possible here, but most likely lfn not found
     //..........................................................................
-    bool match_found = mMatch.empty();  // empty list is trivial match
+    //LfcError.Emsg( "QueryLfc", "Error while doing the query for lfn=", lfn );
+    if ( job.mErrno != ENOENT ) {
+      failed = true;
 
-    for ( it = mMatch.begin(); it != mMatch.end(); it++ ) {
-      if ( strstr( pfn, *it ) ) {
-        match_found = true;
-        break;
+      if ( mStats ) {
+        mStats->Add( LfcStats::eLfcFailed );
       }
     }
 
-    if ( !match_found ) {
-      //LfcError.Emsg( "QueryLfc", "Warning match not found: ", pfn );
-      continue;
-    }
+    return NULL;
+  }
+
+  bool replica_found = false;
+
+  for ( int i = 0; i < n_entries; ++i ) {
+    pfn = rep_entries[i].sfn;
 
     //..........................................................................
-    // Scan for local filesystem mount point, if specified
+    // Reply may include empty names
     //..........................................................................
-    if ( ( mRoot != "" ) && !( pfn = strstr( pfn, mRoot.c_str() ) ) ) {
-      //LfcError.Emsg( "QueryLfc", "Warning no pfn not found for lfn=%s",
-      //               static_cast<char*>( lfn ) );
+    if ( strlen( pfn ) == 0 ) {
       continue;
     }
 
-    sprintf( msg, "%s Found match for rewritten lfn=%s -> pfn=%s using matching=%s. ",
-             secEntity->tident, static_cast<char*>( lfn ), static_cast<char*>( pfn ),
-             static_cast<char*>( *it ) );
-    LfcError.Emsg( "Lfn2Pfn", msg ) ;
+    LFC_TRACE( "Lfn2Pfn", "%s Testing pfn=%s. ", secEntity->tident, pfn );
+
+    if ( !( pfn = FilterReplica( pfn, matching ) ) ) {
+      continue;
+    }
+
+    LFC_DEBUG( "Lfn2Pfn", "%s Found match for rewritten lfn=%s -> pfn=%s using "
+               "matching=%s. ", secEntity->tident, lfn.c_str(), pfn, matching );
     replica_found = true;
     break;
   }
@@ -544,11 +1848,32 @@ EosLfcPlugin::QueryLfc( LfcString lfn, const XrdSecEntity* secEntity )
     ret = LfcString( pfn );
   }
 
-  if ( rep_entries ) {
-    free( rep_entries );
+  return ret;
+}
+
+
+//------------------------------------------------------------------------------
+// Apply the match, nomatch and root filters to a replica
+//------------------------------------------------------------------------------
+char*
+EosLfcPlugin::FilterReplica( char* sfn, const char*& matching ) const
+{
+  //............................................................................
+  // One pass over the replica checks both the forbidden substrings and the
+  // required ones (match is boolean OR, an empty list is a trivial match)
+  //............................................................................
+  if ( mMatcher.Scan( sfn, matching ) != LfcMatcher::eMatch ) {
+    return NULL;
   }
 
-  return ret;
+  //............................................................................
+  // Scan for local filesystem mount point, if specified
+  //............................................................................
+  if ( mRoot != "" ) {
+    return const_cast<char*>( mRootSearcher.Find( sfn ) );
+  }
+
+  return sfn;
 }
 
 
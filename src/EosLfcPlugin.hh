@@ -29,6 +29,10 @@
 #include <sys/types.h>
 #include <lfc_api.h>
 #include <serrno.h>
+#include <sys/time.h>
+#include <deque>
+#include <map>
+#include <stdint.h>
 /*----------------------------------------------------------------------------*/
 #include "XrdCms/XrdCmsClient.hh"
 #include "XrdOuc/XrdOucErrInfo.hh"
@@ -36,14 +40,39 @@
 #include "XrdSys/XrdSysPthread.hh"
 #include "XrdSec/XrdSecEntity.hh"
 /*----------------------------------------------------------------------------*/
+#include "LfcMatcher.hh"
+#include "LfcSearcher.hh"
 #include "LfcString.hh"
 /*----------------------------------------------------------------------------*/
 
 #define LFC_CACHE_TTL 2*3600         // 2 hours
 #define LFC_CACHE_MAXSIZE 500000
+#define LFC_CACHE_SHARDS 16
+#define LFC_NEG_CACHE_TTL 300         // 5 minutes
+#define LFC_NEG_CACHE_MAXSIZE 100000
+#define LFC_CACHE_SNAPSHOT_INTERVAL 600  // 10 minutes
+#define LFC_CACHE_MAINT_INTERVAL 0     // milliseconds, 0 to clean up on insert
+#define LFC_CACHE_HIGH_WATERMARK 10    // percent above the cache maximum size
+#define LFC_SESSIONS 8
+#define LFC_SESSION_CHECK 300          // 5 minutes
+#define LFC_BATCH_SIZE 1               // no batching
+#define LFC_BATCH_WAIT 2               // milliseconds
+#define LFC_PREFETCH_MAXDIR 5000
+#define LFC_PREFETCH_RATE 10           // directories per second
+#define LFC_WARMUP_THREADS 2
+#define LFC_WARMUP_RATE 2000           // entries per second
+#define LFC_PFN_MAXLEN 4096
+#define LFC_REDIRECT_MAXLEN ( LFC_PFN_MAXLEN + 512 )
+#define LFC_LOG_QUEUE_SIZE 4096        // records, 0 to log synchronously
+#define LFC_STATS_INTERVAL 0           // seconds, 0 to disable the statistics
 
 //! Forward declaration
 class LfcCache;
+class LfcLogQueue;
+class LfcStats;
+class LfcSessionPool;
+class ReplicaJob;
+class PrefetchJob;
 
 //..............................................................................
 //! Initialize Cthread library - should be called before any LFC-API function
@@ -59,6 +88,8 @@ extern "C"
 //------------------------------------------------------------------------------
 class EosLfcPlugin: public XrdCmsClient
 {
+  friend class PrefetchJob;
+
   public:
 
     //--------------------------------------------------------------------------
@@ -129,21 +160,140 @@ class EosLfcPlugin: public XrdCmsClient
   private:
 
     std::string mRoot;          ///< the root directory we are interested in
+    LfcSearcher mRootSearcher;  ///< search prepared for mRoot
     std::string mRedirHost;     ///< host to where we redirect in EOS
     unsigned int mRedirPort;    ///< port to where we redirect in EOS, by default 1094
+    size_t mPfnMaxLen;          ///< longest pfn fitting in a redirection to EOS
     std::string mMetaMgrHost;   ///< meta mgr to which we redirect when req is not in EOS
     unsigned int mMetaMgrPort;  ///< meta mgr port to where we redirect, by default 1094
-    bool mSessionInitialised;   ///< mark if the LFC session has been initialised
+    int mLfcSessions;           ///< number of LFC sessions used for the queries
+    int mLfcSessionCheck;       ///< idle time after which a session is checked
+    LfcSessionPool* mSessionPool; ///< threads owning the LFC sessions
+    bool mRewriteParallel;      ///< query all the rewrites of an lfn at once
+    int mBatchSize;             ///< maximum number of lfns queried in bulk
+    int mBatchWait;             ///< time in ms to wait for a bulk query to fill up
+
+    bool mPrefetch;             ///< prefetch the siblings of a resolved lfn
+    int mPrefetchMaxDir;        ///< maximum number of entries read from a directory
+    int mPrefetchRate;          ///< maximum number of directories prefetched per second
+    LfcCache* mPrefetchDirs;    ///< directories prefetched recently
+    XrdSysMutex mPrefetchMutex; ///< mutex protecting the rate limit
+    time_t mPrefetchSecond;     ///< second for which the prefetches are counted
+    int mPrefetchCount;         ///< number of prefetches started in mPrefetchSecond
+
+    //! Interval in seconds between two warm-up progress messages
+    static const int sWarmupLogInterval = 30;
+
+    VectStrings mWarmupPaths;   ///< directory trees read into the cache at startup
+    int mWarmupThreads;         ///< number of warm-up threads
+    int mWarmupRate;            ///< maximum number of entries read per second
+    std::deque< std::pair<std::string, std::string> > mWarmupDirs; ///< directories
+                                ///< left to read, in the LFC and as requested
+    std::vector<pthread_t> mWarmupThreadIds; ///< warm-up threads
+    XrdSysCondVar mWarmupCond;  ///< cond. variable protecting the warm-up state
+    bool mWarmupStop;           ///< mark if the warm-up must stop
+    int mWarmupBusy;            ///< number of threads reading a directory
+    int mWarmupDone;            ///< number of threads which finished
+    uint64_t mWarmupNumDirs;    ///< number of directories read
+    uint64_t mWarmupEntries;    ///< number of entries read
+    uint64_t mWarmupInserted;   ///< number of entries inserted in cache
+    struct timeval mWarmupStart; ///< time when the warm-up started
+    time_t mWarmupLastLog;      ///< time of the last progress message
     VectStrings mMatch;         ///< string to match in the path found
     VectStrings mNotMatch;      ///< string not to match in the path found
+    LfcMatcher mMatcher;        ///< mMatch and mNotMatch compiled for scanning
     XrdOucTList* mListMgr;      ///< list of managers up the tree
 
     int mLfcCacheTtl;           ///< time to live of the entries in cache
     int mLfcCacheMaxSize;       ///< max size of cache entries
     LfcCache* mCache;           ///< cache for the LFC entries
+    LfcCache* mNegCache;        ///< cache for the lfns not found in the LFC
+    int mCacheMaintInterval;    ///< time in ms between two cache maintenance
+                                ///< passes, 0 if the inserts clean up
+    int mCacheHighWatermark;    ///< percentage by which the caches can grow
+                                ///< before the inserts clean up anyway
+
+    std::string mSnapshotPath;  ///< file where the cache is saved, empty if none
+    int mSnapshotInterval;      ///< time between two cache snapshots in seconds
+    bool mSnapshotRunning;      ///< mark if the snapshot thread is running
+    bool mShutdown;             ///< mark if the plugin is being destroyed
+    pthread_t mSnapshotThread;  ///< thread saving the cache periodically
+    XrdSysCondVar mSnapshotCond;///< cond. variable used to stop the snapshot thread
+
+    int mLogQueueSize;          ///< number of records of the log queue
+    LfcLogQueue* mLogQueue;     ///< queue of the messages written by a thread
+
+    int mStatsInterval;         ///< time between two statistics dumps in seconds
+    std::string mStatsFile;     ///< file where the statistics are written, if any
+    LfcStats* mStats;           ///< counters and latencies, NULL if disabled
+    time_t mStatsStart;         ///< time when the statistics started
+    bool mStatsRunning;         ///< mark if the statistics thread is running
+    pthread_t mStatsThread;     ///< thread dumping the statistics periodically
+    XrdSysCondVar mStatsCond;   ///< cond. variable used to stop the stats thread
+
+    //--------------------------------------------------------------------------
+    //! LFC lookup in progress for an lfn, shared by the thread doing the
+    //! lookup and the threads waiting for its result
+    //--------------------------------------------------------------------------
+    struct InFlight {
+      InFlight(): mCond( 0 ), mDone( false ), mRefCount( 0 ) {}
+
+      XrdSysCondVar mCond;  ///< cond. variable signaled when the lookup is done
+      bool mDone;           ///< mark if the lookup is done
+      int mRefCount;        ///< number of threads using the object
+      LfcString mPfn;       ///< result of the lookup, empty if none found
+    };
+
+    std::map<std::string, InFlight*> mInFlight; ///< lookups in progress per lfn
+    XrdSysMutex mInFlightMutex; ///< mutex protecting the map of lookups
+    uint64_t mCoalesced;        ///< number of lookups served by a concurrent one
+
+    //--------------------------------------------------------------------------
+    //! Start function of the snapshot thread
+    //!
+    //! @param arg plugin object
+    //!
+    //--------------------------------------------------------------------------
+    static void* StartSnapshotThread( void* arg );
+
+
+    //--------------------------------------------------------------------------
+    //! Save the cache to the snapshot file every mSnapshotInterval seconds
+    //! until the plugin is destroyed
+    //--------------------------------------------------------------------------
+    void SnapshotLoop();
+
+
+    //--------------------------------------------------------------------------
+    //! Save the cache to the snapshot file and log the outcome
+    //--------------------------------------------------------------------------
+    void SaveSnapshot();
+
 
     //--------------------------------------------------------------------------
-    //! Start the LFC session
+    //! Start function of the statistics thread
+    //!
+    //! @param arg plugin object
+    //!
+    //--------------------------------------------------------------------------
+    static void* StartStatsThread( void* arg );
+
+
+    //--------------------------------------------------------------------------
+    //! Dump the statistics every mStatsInterval seconds until the plugin is
+    //! destroyed
+    //--------------------------------------------------------------------------
+    void StatsLoop();
+
+
+    //--------------------------------------------------------------------------
+    //! Write the statistics to the log and to the stats file if configured
+    //--------------------------------------------------------------------------
+    void DumpStats();
+
+
+    //--------------------------------------------------------------------------
+    //! Start the pool of LFC sessions
     //!
     //! @return 0 if successful, otherwise -errno
     //!
@@ -166,13 +316,17 @@ class EosLfcPlugin: public XrdCmsClient
     //! Logical file name to physical file name translation
     //!
     //! @param lfn logical file name to translate
-    //! @param pfn physical file name
+    //! @param pfn buffer receiving the null terminated physical file name,
+    //!        starting at the storage root
+    //! @param size size of the buffer
     //! @param secEntity security entity
+    //! @param timed if true the cache lookup is timed
     //!
     //! @return SFS_OK if successful, otherwise error code
     //!
     //--------------------------------------------------------------------------
-    int Lfn2Pfn( LfcString lfn, LfcString& pfn, const XrdSecEntity* secEntity );
+    int Lfn2Pfn( const LfcStringView& lfn, char* pfn, size_t size,
+                 const XrdSecEntity* secEntity, bool timed = false );
 
 
     //--------------------------------------------------------------------------
@@ -181,22 +335,34 @@ class EosLfcPlugin: public XrdCmsClient
     //!
     //! @param lfn logical file name
     //!
-    //! @return NULL if storage root not found in the lfc, otherwise the pfn which
-    //!              which begins with the storage root path
+    //! @return NULL if storage root not found in the lfn, otherwise pointer to
+    //!         the storage root in the lfn
     //!
     //--------------------------------------------------------------------------
-    LfcString LfnIsPfn( LfcString lfn );
+    const char* LfnIsPfn( const LfcStringView& lfn ) const;
 
 
     //--------------------------------------------------------------------------
-    //! Compensate for various conventions for the LFC path
+    //! Look up an lfn in the LFC trying all its rewrites and update the caches
+    //! with the result. Concurrent lookups of the same lfn are coalesced: only
+    //! the first one queries the LFC, the others wait for its result.
     //!
     //! @param lfn logical file name
+    //! @param secEntity security entity
+    //!
+    //! @return physical file name or NULL if none found
+    //!
+    //--------------------------------------------------------------------------
+    LfcString LookupLfc( const LfcString& lfn, const XrdSecEntity* secEntity );
+
+
+    //--------------------------------------------------------------------------
+    //! Drop a reference to an in-flight lookup, deleting it with the last one
     //!
-    //! @return a vector of path posibilities
+    //! @param flight in-flight lookup
     //!
     //--------------------------------------------------------------------------
-    VectStrings RewriteLfn( LfcString lfn );
+    void ReleaseInFlight( InFlight* flight );
 
 
     //--------------------------------------------------------------------------
@@ -204,11 +370,110 @@ class EosLfcPlugin: public XrdCmsClient
     //!
     //! @param lfn logical file name we query for
     //! @param secEntity security entity
+    //! @param failed set to true if the query failed for a reason other than
+    //!        the lfn not being in the LFC e.g. communication error
+    //!
+    //! @return physical file name or NULL if none found
+    //!
+    //--------------------------------------------------------------------------
+    LfcString QueryLfc( const LfcString& lfn, const XrdSecEntity* secEntity,
+                        bool& failed );
+
+
+    //--------------------------------------------------------------------------
+    //! Select the replica to use from the result of an LFC query, applying the
+    //! match, nomatch and root filters
+    //!
+    //! @param lfn logical file name which was queried
+    //! @param job finished LFC query
+    //! @param secEntity security entity
+    //! @param failed set to true if the query failed for a reason other than
+    //!        the lfn not being in the LFC
     //!
     //! @return physical file name or NULL if none found
     //!
     //--------------------------------------------------------------------------
-    LfcString QueryLfc( LfcString lfn, const XrdSecEntity* secEntity );
+    LfcString SelectReplica( const LfcString& lfn, ReplicaJob& job,
+                             const XrdSecEntity* secEntity, bool& failed );
+
+
+    //--------------------------------------------------------------------------
+    //! Apply the match, nomatch and root filters to a replica
+    //!
+    //! @param sfn storage file name of the replica
+    //! @param matching set to the match string found in the sfn, empty if no
+    //!        match strings are configured
+    //!
+    //! @return pointer to the pfn inside the sfn or NULL if the replica is
+    //!         not usable
+    //!
+    //--------------------------------------------------------------------------
+    char* FilterReplica( char* sfn, const char*& matching ) const;
+
+
+    //--------------------------------------------------------------------------
+    //! Queue the prefetch of the siblings of a resolved lfn, subject to the
+    //! rate limit and skipped if the directory was prefetched recently
+    //!
+    //! @param lfn logical file name as requested
+    //! @param resolved rewritten logical file name found in the LFC
+    //!
+    //--------------------------------------------------------------------------
+    void Prefetch( const std::string& lfn, const std::string& resolved );
+
+
+    //--------------------------------------------------------------------------
+    //! List a directory in the LFC and insert the replicas of its files which
+    //! pass the filters in the cache - called on a thread of the session pool
+    //!
+    //! @param catalogDir directory in the LFC, ending with '/'
+    //! @param lfnDir directory of the requested lfns, ending with '/'
+    //!
+    //--------------------------------------------------------------------------
+    void PrefetchDir( const std::string& catalogDir, const std::string& lfnDir );
+
+
+    //--------------------------------------------------------------------------
+    //! List a directory in the LFC and insert the replicas of its files which
+    //! pass the filters in the cache
+    //!
+    //! @param catalogDir directory in the LFC, ending with '/'
+    //! @param lfnDir directory of the requested lfns, ending with '/'
+    //! @param maxEntries maximum number of entries read from the directory
+    //! @param numInserted incremented for every entry inserted in cache
+    //! @param subDirs if not NULL, the names of the subdirectories are added
+    //!
+    //! @return number of entries read or -1 if the directory can't be opened
+    //!
+    //--------------------------------------------------------------------------
+    int CacheDir( const std::string& catalogDir, const std::string& lfnDir,
+                  int maxEntries, int& numInserted, VectStrings* subDirs );
+
+
+    //--------------------------------------------------------------------------
+    //! Start the threads walking the warm-up paths
+    //!
+    //! @return 0 if successful, otherwise -errno
+    //!
+    //--------------------------------------------------------------------------
+    int StartWarmup();
+
+
+    //--------------------------------------------------------------------------
+    //! Start function of the warm-up threads
+    //!
+    //! @param arg plugin object
+    //!
+    //--------------------------------------------------------------------------
+    static void* StartWarmupThread( void* arg );
+
+
+    //--------------------------------------------------------------------------
+    //! Take directories from the warm-up queue, insert their entries in the
+    //! cache and queue their subdirectories until all the trees were read, the
+    //! cache is full or the plugin is destroyed
+    //--------------------------------------------------------------------------
+    void WarmupLoop();
 };
 
 #endif // __EOS_PLUGIN_CMSLFCPLUGIN_HH__  
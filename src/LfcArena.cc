@@ -0,0 +1,171 @@
+//------------------------------------------------------------------------------
+// File: LfcArena.cc
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include <cstring>
+/*----------------------------------------------------------------------------*/
+#include "LfcArena.hh"
+/*----------------------------------------------------------------------------*/
+
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+LfcArena::LfcArena():
+  mChunks( NULL ),
+  mNumChunks( 0 ),
+  mChunkCapacity( 0 ),
+  mNext( 0 ),
+  mFreeLists( sUnitsPerChunk + 1, 0 )
+{
+  // empty
+}
+
+
+//------------------------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------------------------
+LfcArena::~LfcArena()
+{
+  for ( uint32_t i = 0; i < mNumChunks; i++ ) {
+    delete[] mChunks[i];
+  }
+
+  for ( size_t i = 0; i < mOldChunks.size(); i++ ) {
+    delete[] mOldChunks[i];
+  }
+
+  delete[] mChunks;
+}
+
+
+//------------------------------------------------------------------------------
+// Allocate a block
+//------------------------------------------------------------------------------
+uint32_t
+LfcArena::Alloc( size_t size )
+{
+  uint32_t units = ( size + ( 1 << sUnitShift ) - 1 ) >> sUnitShift;
+  uint32_t ref;
+
+  if ( !units || ( units > sUnitsPerChunk ) ) {
+    return 0;
+  }
+
+  //............................................................................
+  // Reuse a free block of the same size, the reference to the next free block
+  // is stored at the beginning of the block
+  //............................................................................
+  if ( ( ref = mFreeLists[units] ) ) {
+    memcpy( &mFreeLists[units], Ptr( ref ), sizeof( uint32_t ) );
+    return ref;
+  }
+
+  //............................................................................
+  // Take a new chunk if the block does not fit in the current one, the end of
+  // the current chunk is kept as a free block. The first chunk loses its
+  // first unit to the null reference, a block of a whole chunk then only
+  // fits in the next one. The next unit wraps to 0 once the last possible
+  // chunk is used up.
+  //............................................................................
+  while ( true ) {
+    uint32_t offset = mNext & ( sUnitsPerChunk - 1 );
+    bool in_chunk = mNext && ( ( mNext >> sChunkShift ) < mNumChunks );
+
+    if ( in_chunk && ( offset + units <= sUnitsPerChunk ) ) {
+      break;
+    }
+
+    if ( mNumChunks >= sMaxChunks ) {
+      return 0;
+    }
+
+    if ( in_chunk ) {
+      Free( mNext, static_cast<size_t>( sUnitsPerChunk - offset ) << sUnitShift );
+    }
+
+    mNext = mNumChunks << sChunkShift;
+    AddChunk( new char[sUnitsPerChunk << sUnitShift] );
+
+    //..........................................................................
+    // Reference 0 is reserved as the null reference
+    //..........................................................................
+    if ( !mNext ) {
+      mNext = 1;
+    }
+  }
+
+  ref = mNext;
+  mNext += units;
+  return ref;
+}
+
+
+//------------------------------------------------------------------------------
+// Free a block
+//------------------------------------------------------------------------------
+void
+LfcArena::Free( uint32_t ref, size_t size )
+{
+  uint32_t units = ( size + ( 1 << sUnitShift ) - 1 ) >> sUnitShift;
+
+  if ( !ref || !units || ( units > sUnitsPerChunk ) ) {
+    return;
+  }
+
+  memcpy( Ptr( ref ), &mFreeLists[units], sizeof( uint32_t ) );
+  mFreeLists[units] = ref;
+}
+
+
+//------------------------------------------------------------------------------
+// Append a chunk to the table of the chunks
+//------------------------------------------------------------------------------
+void
+LfcArena::AddChunk( char* chunk )
+{
+  //............................................................................
+  // A thread in Peek() may still use the old table, which is therefore kept
+  // until the owner takes it
+  //............................................................................
+  if ( mNumChunks == mChunkCapacity ) {
+    uint32_t capacity = mChunkCapacity ? 2 * mChunkCapacity : 16;
+    char** chunks = new char*[capacity];
+
+    if ( mChunks ) {
+      memcpy( chunks, mChunks, mNumChunks * sizeof( char* ) );
+      mOldChunks.push_back( mChunks );
+    }
+
+    __sync_synchronize();
+    mChunks = chunks;
+    mChunkCapacity = capacity;
+  }
+
+  //............................................................................
+  // The chunk must be in the table before Peek() can see it counted
+  //............................................................................
+  mChunks[mNumChunks] = chunk;
+  __sync_synchronize();
+  mNumChunks++;
+}
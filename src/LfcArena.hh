@@ -0,0 +1,196 @@
+//------------------------------------------------------------------------------
+// File: LfcArena.hh
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOS_PLUGIN_LFCARENA_HH__
+#define __EOS_PLUGIN_LFCARENA_HH__
+
+/*----------------------------------------------------------------------------*/
+#include <vector>
+/*----------------------------------------------------------------------------*/
+#include <stddef.h>
+#include <stdint.h>
+/*----------------------------------------------------------------------------*/
+
+
+//------------------------------------------------------------------------------
+//! Arena allocator for small variable sized records. Memory is taken from the
+//! heap in chunks of 64KB and handed out in multiples of 16 bytes. Freed blocks
+//! are kept on a free list per block size and reused by the next allocation of
+//! the same size. The chunks are only given back when the arena is destroyed.
+//!
+//! Blocks are referred to by a 32-bit reference instead of a pointer, which is
+//! half the size when used in indices and links. The reference 0 is never
+//! handed out and can be used as the null reference. The arena is not thread
+//! safe, the caller must serialize the calls, except for Peek() which can be
+//! called at any time by other threads: the table of the chunks is replaced
+//! when it grows but the old ones are kept until the owner takes them with
+//! TakeOldTables(), to free them once no Peek() can still use them, or the
+//! arena is destroyed. The new table is published before the number of chunks.
+//------------------------------------------------------------------------------
+class LfcArena
+{
+  public:
+
+    static const uint32_t sUnitShift = 4;    ///< blocks are multiples of 16 bytes
+    static const uint32_t sChunkShift = 12;  ///< 4096 units per chunk ( 64KB )
+    static const uint32_t sUnitsPerChunk = 1 << sChunkShift;
+    static const uint32_t sMaxChunks = 1 << ( 32 - sChunkShift );
+
+    //--------------------------------------------------------------------------
+    //! Constructor
+    //--------------------------------------------------------------------------
+    LfcArena();
+
+
+    //--------------------------------------------------------------------------
+    //! Destructor
+    //--------------------------------------------------------------------------
+    ~LfcArena();
+
+
+    //--------------------------------------------------------------------------
+    //! Allocate a block
+    //!
+    //! @param size size in bytes of the block
+    //!
+    //! @return reference to the block or 0 if the block is bigger than a chunk
+    //!         or the arena is full
+    //!
+    //--------------------------------------------------------------------------
+    uint32_t Alloc( size_t size );
+
+
+    //--------------------------------------------------------------------------
+    //! Free a block
+    //!
+    //! @param ref reference to the block
+    //! @param size size in bytes used when the block was allocated
+    //!
+    //--------------------------------------------------------------------------
+    void Free( uint32_t ref, size_t size );
+
+
+    //--------------------------------------------------------------------------
+    //! Get the address of a block
+    //!
+    //! @param ref reference to the block
+    //!
+    //! @return pointer to the block
+    //!
+    //--------------------------------------------------------------------------
+    char* Ptr( uint32_t ref ) const {
+      return mChunks[ref >> sChunkShift] +
+             ( ( ref & ( sUnitsPerChunk - 1 ) ) << sUnitShift );
+    }
+
+
+    //--------------------------------------------------------------------------
+    //! Get the address of a block without serializing with the other calls.
+    //! The reference may be stale or not refer to a block at all, the memory
+    //! returned is then only guaranteed to be readable.
+    //!
+    //! @param ref reference to the block
+    //! @param avail number of bytes readable from the address
+    //!
+    //! @return pointer to the block, NULL if the reference is outside the
+    //!         chunks
+    //!
+    //--------------------------------------------------------------------------
+    const char* Peek( uint32_t ref, size_t& avail ) const {
+      uint32_t chunk = ref >> sChunkShift;
+      uint32_t offset = ( ref & ( sUnitsPerChunk - 1 ) ) << sUnitShift;
+
+      if ( chunk >= *const_cast<const volatile uint32_t*>( &mNumChunks ) ) {
+        return NULL;
+      }
+
+      ReadBarrier();
+      avail = ( sUnitsPerChunk << sUnitShift ) - offset;
+      return ( *const_cast<char* const* const volatile*>( &mChunks ) )[chunk] + offset;
+    }
+
+
+    //--------------------------------------------------------------------------
+    //! Keep the loads before the barrier from being done after the ones
+    //! following it. x86 does not reorder loads, only the compiler has to be
+    //! stopped there.
+    //--------------------------------------------------------------------------
+    static void ReadBarrier() {
+#if defined( __x86_64__ ) || defined( __i386__ )
+      __asm__ __volatile__( "" ::: "memory" );
+#else
+      __sync_synchronize();
+#endif
+    }
+
+
+    //--------------------------------------------------------------------------
+    //! Get the amount of memory taken from the heap
+    //!
+    //! @return number of bytes
+    //!
+    //--------------------------------------------------------------------------
+    uint64_t GetReserved() const {
+      return static_cast<uint64_t>( mNumChunks ) <<
+             ( sChunkShift + sUnitShift );
+    }
+
+
+    //--------------------------------------------------------------------------
+    //! Hand over the chunk tables replaced since the last call, the caller
+    //! frees them with delete[]
+    //!
+    //! @param tables vector to which the tables are appended
+    //!
+    //--------------------------------------------------------------------------
+    void TakeOldTables( std::vector<char**>& tables ) {
+      tables.insert( tables.end(), mOldChunks.begin(), mOldChunks.end() );
+      mOldChunks.clear();
+    }
+
+  private:
+
+    char** mChunks;                    ///< addresses of the memory chunks
+    uint32_t mNumChunks;               ///< number of chunks
+    uint32_t mChunkCapacity;           ///< number of addresses mChunks can hold
+    std::vector<char**> mOldChunks;    ///< chunk tables replaced, not taken yet
+    uint32_t mNext;                    ///< next unused unit in the last chunk
+    std::vector<uint32_t> mFreeLists;  ///< free blocks indexed by number of units
+
+    //--------------------------------------------------------------------------
+    //! Append a chunk to the table of the chunks, replacing the table by a
+    //! bigger one if it is full
+    //!
+    //! @param chunk address of the chunk
+    //!
+    //--------------------------------------------------------------------------
+    void AddChunk( char* chunk );
+
+    //--------------------------------------------------------------------------
+    //! Disable copying
+    //--------------------------------------------------------------------------
+    LfcArena( const LfcArena& );
+    LfcArena& operator=( const LfcArena& );
+};
+
+#endif // __EOS_PLUGIN_LFCARENA_HH__
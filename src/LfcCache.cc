@@ -22,22 +22,92 @@
  ************************************************************************/
 
 /*----------------------------------------------------------------------------*/
-#include <utility>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <limits>
 /*----------------------------------------------------------------------------*/
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <time.h>
+#include <unistd.h>
 /*----------------------------------------------------------------------------*/
 #include "LfcCache.hh"
+#include "LfcHash.hh"
 /*----------------------------------------------------------------------------*/
 
+//! Set of lookup counters of the calling thread plus one, 0 if not chosen yet
+static __thread unsigned int counterSet = 0;
+
+//! Number of threads which chose a set of lookup counters
+static unsigned int numCounterThreads = 0;
+
+
+//------------------------------------------------------------------------------
+// Order the snapshot records by their insertion time
+//------------------------------------------------------------------------------
+static bool
+CompareFirst( const std::pair<time_t, size_t>& lhs,
+              const std::pair<time_t, size_t>& rhs )
+{
+  return ( lhs.first < rhs.first );
+}
+
 
 //------------------------------------------------------------------------------
 // Constructor
-//------------------------------------------------------------------------------`
-LfcCache::LfcCache( uint64_t cacheTtl, uint64_t cacheMaxSize ):
+//------------------------------------------------------------------------------
+LfcCache::LfcCache( uint64_t cacheTtl, uint64_t cacheMaxSize,
+                    unsigned int numShards, Policy policy ):
   mCacheTtl( cacheTtl ),
-  mCacheMaxSize( cacheMaxSize )
+  mCacheMaxSize( cacheMaxSize ),
+  mNumShards( numShards ? numShards : 1 ),
+  mEpoch( 0 ),
+  mNumRetired( 0 ),
+  mPolicy( policy ),
+  mShardHighWatermark( 0 ),
+  mMaintInterval( 0 ),
+  mMaintShard( 0 ),
+  mMaintRunning( false ),
+  mMaintStop( false ),
+  mMaintCond( 0 )
 {
-  //empty
+  //............................................................................
+  // Split the global size budget among the shards
+  //............................................................................
+  mShardMaxSize = ( mCacheMaxSize + mNumShards - 1 ) / mNumShards;
+
+  if ( !mShardMaxSize ) {
+    mShardMaxSize = 1;
+  }
+
+  mShards = new Shard[mNumShards];
+  mCounters = new Counters[sNumCounterSets];
+
+  //............................................................................
+  // The small queue of s3fifo takes 10% of the shard, the window of tinylfu 1%
+  //............................................................................
+  mWindowMaxSize = mShardMaxSize / ( ( mPolicy == eTinyLfu ) ? 100 : 10 );
+
+  if ( !mWindowMaxSize ) {
+    mWindowMaxSize = 1;
+  }
+
+  for ( unsigned int i = 0; i < mNumShards; i++ ) {
+    if ( mPolicy == eTinyLfu ) {
+      mShards[i].mSketch.Resize( mShardMaxSize );
+    } else if ( mPolicy == eS3Fifo ) {
+      size_t num_ghosts = sMinSlots;
+
+      while ( num_ghosts < mShardMaxSize ) {
+        num_ghosts <<= 1;
+      }
+
+      mShards[i].mGhost.assign( num_ghosts, 0 );
+    }
+  }
 }
 
 
@@ -46,7 +116,15 @@ LfcCache::LfcCache( uint64_t cacheTtl, uint64_t cacheMaxSize ):
 //------------------------------------------------------------------------------
 LfcCache::~LfcCache()
 {
-  // empty
+  StopMaintenance();
+
+  for ( size_t i = 0; i < mRetired.size(); i++ ) {
+    delete mRetired[i].mSlots;
+    delete[] mRetired[i].mChunks;
+  }
+
+  delete[] mShards;
+  delete[] mCounters;
 }
 
 
@@ -54,64 +132,129 @@ LfcCache::~LfcCache()
 // Insert a new entry in cache
 //------------------------------------------------------------------------------
 void
-LfcCache::Insert( std::string lfn, std::string pfn )
+LfcCache::Insert( const std::string& lfn, const std::string& pfn )
+{
+  InsertEntry( lfn.c_str(), lfn.length(), pfn.c_str(), pfn.length(), time( NULL ) );
+}
+
+
+//------------------------------------------------------------------------------
+// Insert a new entry in cache with a given insertion time
+//------------------------------------------------------------------------------
+void
+LfcCache::InsertEntry( const char* lfn, size_t lfnLen,
+                       const char* pfn, size_t pfnLen, time_t insertTime )
 {
+  if ( ( lfnLen > std::numeric_limits<uint16_t>::max() ) ||
+       ( pfnLen > std::numeric_limits<uint16_t>::max() ) )
+  {
+    return;
+  }
+
   time_t now = time( NULL );
+  uint64_t hash = LfcHash( lfn, lfnLen );
+  Shard* shard = GetShard( hash );
 
-  mRwLock.WriteLock();   // -->
+  LockShard( shard );           // -->
+  DrainAccesses( shard );
 
   //............................................................................
-  // Clear expired cache entries
+  // Nothing to do if a valid entry already exists for the lfn, an expired one
+  // which was not yet dropped is replaced
   //............................................................................
-  MapType::iterator iterMap;
-  ListType::iterator iterQ;
-
-  for ( iterQ = mAgingQueue.begin(); iterQ != mAgingQueue.end(); /*empty*/ ) {
-    if ( static_cast<uint64_t>( difftime( now , iterQ->second ) ) >= mCacheTtl ) {
-      iterMap = mLfn2Pfn.find( iterQ->first );
+  ssize_t pos = FindSlot( shard, hash, lfn, lfnLen );
 
-      if ( iterMap != mLfn2Pfn.end() ) {
-        mLfn2Pfn.erase( iterMap );
-      } else {
-        fprintf( stderr, "Warning1: Entry found in queue but not in map." );
-      }
+  if ( pos >= 0 ) {
+    uint32_t ref = shard->mSlots[pos].mRef;
 
-      mAgingQueue.erase( iterQ++ );
-    } else {
-      ++iterQ;
+    if ( !IsExpired( EntryPtr( shard, ref )->mTime, now ) ) {
+      UnlockShard( shard );     // <--
+      return;
     }
+
+    RemoveEntry( shard, ref );
+    shard->mExpired++;
   }
 
+  QueueId queue = SelectQueue( shard, hash );
+
   //............................................................................
-  // If still too many entries in cache - delete some more
+  // Clear expired cache entries and, if still too many entries in the shard,
+  // drop some to make room for the new entry. The number of expired entries
+  // dropped per insert is bounded, any left over are ignored by GetEntry and
+  // get removed by the following inserts or when they reach the head of
+  // their queue. While the maintenance thread runs this is left to it, unless
+  // the shard grew past the high watermark, and then only a few entries are
+  // dropped per insert to bring it back.
   //............................................................................
-  if ( mAgingQueue.size() >= mCacheMaxSize ) {
-    iterQ = mAgingQueue.begin();
+  if ( !mMaintRunning ) {
+    DropExpired( shard, now, sMaxExpirePerInsert );
+    MakeRoom( shard, 1, now, std::numeric_limits<size_t>::max() );
+  } else if ( shard->mSize >= mShardHighWatermark ) {
+    DropExpired( shard, now, sMaxExpirePerInsert );
+    MakeRoom( shard, 1, now, sMaxEvictPerInsert );
+  }
 
-    while ( ( mAgingQueue.size() > static_cast<size_t>( 0.9 * mCacheMaxSize ) ) &&
-            ( iterQ != mAgingQueue.end() ) )
-    {
-      iterMap = mLfn2Pfn.find( iterQ->first );
+  //............................................................................
+  // Split the lfn in directory and name and find the tail which the lfn and
+  // the pfn have in common, starting at a path separator. The part of the pfn
+  // in front of it, usually the storage element path, is the pfn prefix.
+  //............................................................................
+  size_t dir_len = lfnLen;
+  size_t suffix = 0;
 
-      if ( iterMap != mLfn2Pfn.end() ) {
-        mLfn2Pfn.erase( iterMap );
-      } else {
-        fprintf( stderr, "Warning2: Entry found in queue but not in map." );
-      }
+  while ( dir_len && ( lfn[dir_len - 1] != '/' ) ) {
+    dir_len--;
+  }
 
-      mAgingQueue.erase( iterQ++ );
-    }
+  while ( ( suffix < lfnLen ) && ( suffix < pfnLen ) &&
+          ( lfn[lfnLen - suffix - 1] == pfn[pfnLen - suffix - 1] ) )
+  {
+    suffix++;
+  }
+
+  while ( suffix && ( lfn[lfnLen - suffix] != '/' ) ) {
+    suffix--;
+  }
+
+  uint32_t lfn_dir = shard->mDict.Intern( lfn, dir_len );
+  uint32_t pfn_prefix = shard->mDict.Intern( pfn, pfnLen - suffix );
+
+  if ( !lfn_dir ) {
+    dir_len = 0;
   }
 
+  size_t name_len = lfnLen - dir_len;
+  size_t literal_len = pfn_prefix ? 0 : pfnLen - suffix;
+
   //............................................................................
-  // If entry is not in cach do the insert
+  // Build the entry and append it to its aging queue
   //............................................................................
-  if ( !mLfn2Pfn.count( lfn ) ) {
-    iterQ = mAgingQueue.insert( mAgingQueue.end(), std::make_pair( lfn, time( NULL ) ) );
-    mLfn2Pfn.insert( std::make_pair( lfn, std::make_pair( pfn, iterQ ) ) );
+  uint32_t ref = shard->mArena.Alloc( offsetof( Entry, mData ) +
+                                      name_len + literal_len );
+
+  if ( ref ) {
+    Entry* entry = EntryPtr( shard, ref );
+    entry->mTime = insertTime;
+    entry->mTag = static_cast<uint32_t>( hash );
+    entry->mLfnDir = lfn_dir;
+    entry->mPfnPrefix = pfn_prefix;
+    entry->mNameLen = name_len;
+    entry->mPfnLen = literal_len;
+    entry->mPfnSuffix = suffix;
+    memcpy( entry->mData, lfn + dir_len, name_len );
+    memcpy( entry->mData + name_len, pfn, literal_len );
+    entry->mFreq = 0;
+    Enqueue( shard, queue, ref );
+    AddSlot( shard, hash, ref );
+  } else {
+    shard->mDict.Release( lfn_dir );
+    shard->mDict.Release( pfn_prefix );
   }
 
-  mRwLock.UnLock();      // <--
+  RetireChunkTables( shard );
+  UnlockShard( shard );         // <--
+  Reclaim();
 }
 
 
@@ -119,30 +262,1332 @@ LfcCache::Insert( std::string lfn, std::string pfn )
 // Try to get an entry from cache
 //------------------------------------------------------------------------------
 bool
-LfcCache::GetEntry( std::string lfn, std::string& pfn )
+LfcCache::GetEntry( const std::string& lfn, std::string& pfn )
 {
-  MapType::iterator iterMap;
-  bool found = false;
-  time_t now;
-  mRwLock.ReadLock();    // -->
+  return GetEntry( lfn.c_str(), lfn.length(), pfn );
+}
 
-  if ( mLfn2Pfn.count( lfn ) ) {
-    iterMap = mLfn2Pfn.find( lfn );
-    now = time( NULL );
 
+//------------------------------------------------------------------------------
+// Try to get an entry from cache without building a string for the lfn
+//------------------------------------------------------------------------------
+bool
+LfcCache::GetEntry( const char* lfn, size_t len, std::string& pfn )
+{
+  char buff[sPfnBufferSize];
+  size_t pfn_len;
+  bool found = LookupEntry( lfn, len, buff, sizeof( buff ), pfn_len );
+
+  if ( found && ( pfn_len < sizeof( buff ) ) ) {
+    pfn.assign( buff, pfn_len );
+  } else if ( found ) {
     //..........................................................................
-    // Test if not expired
+    // A longer pfn is looked up again into the string, the entry can be
+    // dropped or replaced meanwhile
     //..........................................................................
-    if ( static_cast<uint64_t>( difftime( now, iterMap->second.second->second ) ) <
-         mCacheTtl )
-    {
-      pfn = iterMap->second.first;
+    do {
+      pfn.resize( pfn_len + 1 );
+      found = LookupEntry( lfn, len, &pfn[0], pfn.size(), pfn_len );
+    } while ( found && ( pfn_len >= pfn.size() ) );
+
+    if ( found ) {
+      pfn.resize( pfn_len );
+    }
+  }
+
+  CountLookup( found );
+  return found;
+}
+
+
+//------------------------------------------------------------------------------
+// Try to get an entry from cache into a buffer of the caller
+//------------------------------------------------------------------------------
+bool
+LfcCache::GetEntry( const char* lfn, size_t len, char* pfn, size_t size,
+                    size_t& pfnLen )
+{
+  bool found = LookupEntry( lfn, len, pfn, size, pfnLen ) && ( pfnLen < size );
+  CountLookup( found );
+  return found;
+}
+
+
+//------------------------------------------------------------------------------
+// Look up an lfn and copy its pfn into a buffer
+//------------------------------------------------------------------------------
+bool
+LfcCache::LookupEntry( const char* lfn, size_t len, char* pfn, size_t size,
+                       size_t& pfnLen )
+{
+  uint64_t hash = LfcHash( lfn, len );
+  Shard* shard = GetShard( hash );
+  time_t now = time( NULL );
+  uint32_t ref = 0;
+
+  //............................................................................
+  // The lookup counts itself in the current epoch until it is done with the
+  // memory of the shard, so that nothing it reads is freed meanwhile
+  //............................................................................
+  volatile uint32_t* readers = &GetCounters()->mReaders[mEpoch & 1];
+  __sync_fetch_and_add( readers, 1 );
+
+  for ( int i = 0; i < sMaxOptimisticReads; i++ ) {
+    int retc = PeekEntry( shard, hash, lfn, len, now, pfn, size, pfnLen, ref );
+
+    if ( retc >= 0 ) {
+      __sync_fetch_and_sub( readers, 1 );
+      RecordAccess( shard, hash, retc ? ref : 0 );
+      return ( retc == 1 );
+    }
+  }
+
+  __sync_fetch_and_sub( readers, 1 );
+
+  //............................................................................
+  // The writers kept changing the shard, wait for them
+  //............................................................................
+  bool found = false;
+  shard->mMutex.Lock();         // -->
+  ssize_t pos = FindSlot( shard, hash, lfn, len );
+
+  if ( pos >= 0 ) {
+    ref = shard->mSlots[pos].mRef;
+    Entry* entry = EntryPtr( shard, ref );
+
+    if ( !IsExpired( entry->mTime, now ) ) {
+      pfnLen = DecodePfn( shard, entry, pfn, size );
       found = true;
     }
   }
 
-  mRwLock.UnLock();      // <--
+  ApplyAccess( shard, static_cast<uint32_t>( hash ), found ? ref : 0 );
+  shard->mMutex.UnLock();       // <--
   return found;
 }
 
 
+//------------------------------------------------------------------------------
+// Look up an lfn in a shard without taking its lock
+//------------------------------------------------------------------------------
+int
+LfcCache::PeekEntry( const Shard* shard, uint64_t hash, const char* lfn,
+                     size_t len, time_t now, char* pfn, size_t size,
+                     size_t& pfnLen, uint32_t& ref ) const
+{
+  uint32_t seq = shard->mSeq;
+
+  if ( seq & 1 ) {
+    return -1;
+  }
+
+  //............................................................................
+  // The mask is read before the array, which is at least as big
+  //............................................................................
+  LfcArena::ReadBarrier();
+  size_t mask = *const_cast<const volatile size_t*>( &shard->mReadMask );
+  LfcArena::ReadBarrier();
+  const Slot* slots = *const_cast<const Slot* const volatile*>( &shard->mReadSlots );
+  uint32_t tag = static_cast<uint32_t>( hash );
+  size_t pos = hash & mask;
+  int found = 0;
+
+  //............................................................................
+  // A writer shifting the slots can leave the probe sequence without an empty
+  // slot for a while, the probing is therefore bounded
+  //............................................................................
+  for ( size_t i = 0; slots && ( i <= mask ); i++, pos = ( pos + 1 ) & mask ) {
+    const volatile Slot* slot = slots + pos;
+    uint32_t slot_ref = slot->mRef;
+
+    if ( !slot_ref ) {
+      break;
+    }
+
+    if ( slot->mTag != tag ) {
+      continue;
+    }
+
+    //..........................................................................
+    // The header of the entry is copied so that the lengths checked are the
+    // ones used
+    //..........................................................................
+    size_t avail;
+    const char* block = shard->mArena.Peek( slot_ref, avail );
+    Entry entry;
+
+    if ( !block || ( avail < offsetof( Entry, mData ) ) ) {
+      continue;
+    }
+
+    memcpy( &entry, block, offsetof( Entry, mData ) );
+    const char* name = block + offsetof( Entry, mData );
+    size_t dir_len;
+    const char* dir = shard->mDict.Peek( entry.mLfnDir, dir_len );
+
+    if ( ( offsetof( Entry, mData ) + entry.mNameLen + entry.mPfnLen > avail ) ||
+         !dir || ( dir_len + entry.mNameLen != len ) ||
+         memcmp( lfn + dir_len, name, entry.mNameLen ) ||
+         memcmp( lfn, dir, dir_len ) )
+    {
+      continue;
+    }
+
+    if ( !IsExpired( entry.mTime, now ) ) {
+      //........................................................................
+      // Same as DecodePfn, the lfn tail can start in the directory part
+      //........................................................................
+      size_t prefix_len;
+      const char* prefix = shard->mDict.Peek( entry.mPfnPrefix, prefix_len );
+      size_t from_dir = ( entry.mPfnSuffix > entry.mNameLen ) ?
+                        entry.mPfnSuffix - entry.mNameLen : 0;
+      size_t from_name = entry.mPfnSuffix - from_dir;
+
+      if ( prefix && ( from_dir <= dir_len ) ) {
+        pfnLen = prefix_len + entry.mPfnLen + entry.mPfnSuffix;
+
+        if ( pfnLen < size ) {
+          char* ptr = pfn;
+          memcpy( ptr, prefix, prefix_len );
+          ptr += prefix_len;
+          memcpy( ptr, name + entry.mNameLen, entry.mPfnLen );
+          ptr += entry.mPfnLen;
+          memcpy( ptr, dir + dir_len - from_dir, from_dir );
+          ptr += from_dir;
+          memcpy( ptr, name + entry.mNameLen - from_name, from_name );
+          ptr[from_name] = '\0';
+        }
+
+        ref = slot_ref;
+        found = 1;
+      }
+    }
+
+    break;
+  }
+
+  //............................................................................
+  // Whatever was read is valid only if no writer came in between
+  //............................................................................
+  LfcArena::ReadBarrier();
+  return ( ( shard->mSeq == seq ) ? found : -1 );
+}
+
+
+//------------------------------------------------------------------------------
+// Count a lookup in the counters of the calling thread
+//------------------------------------------------------------------------------
+void
+LfcCache::CountLookup( bool found )
+{
+  Counters* counters = GetCounters();
+
+  if ( found ) {
+    __sync_fetch_and_add( &counters->mHits, 1 );
+  } else {
+    __sync_fetch_and_add( &counters->mMisses, 1 );
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Record a lookup in an access buffer of the shard
+//------------------------------------------------------------------------------
+void
+LfcCache::RecordAccess( Shard* shard, uint64_t hash, uint32_t ref )
+{
+  uint64_t access = ( static_cast<uint64_t>( static_cast<uint32_t>( hash ) ) << 32 ) |
+                    ref;
+
+  if ( ( mPolicy == eFifo ) || !access ) {
+    return;
+  }
+
+  //............................................................................
+  // The threads share the buffers in the same turn as the counters. A full
+  // buffer is drained by the lookup if no writer holds the lock, otherwise
+  // the access is dropped rather than waiting.
+  //............................................................................
+  AccessBuffer* buffer = &shard->mAccesses[( GetCounters() - mCounters ) %
+                                           sNumAccessBuffers];
+  bool drained = false;
+
+  while ( true ) {
+    uint32_t tail = buffer->mTail;
+
+    if ( tail - buffer->mHead < sAccessBufferSize ) {
+      if ( __sync_bool_compare_and_swap( &buffer->mTail, tail, tail + 1 ) ) {
+        buffer->mSlots[tail & ( sAccessBufferSize - 1 )] = access;
+        return;
+      }
+
+      continue;
+    }
+
+    if ( drained || !shard->mMutex.CondLock() ) {
+      return;
+    }
+
+    DrainAccesses( shard );
+    shard->mMutex.UnLock();
+    drained = true;
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Apply the accesses recorded in the buffers of a shard
+//------------------------------------------------------------------------------
+void
+LfcCache::DrainAccesses( Shard* shard )
+{
+  if ( mPolicy == eFifo ) {
+    return;
+  }
+
+  for ( unsigned int i = 0; i < sNumAccessBuffers; i++ ) {
+    AccessBuffer* buffer = &shard->mAccesses[i];
+    uint32_t head = buffer->mHead;
+    uint32_t tail = buffer->mTail;
+
+    //..........................................................................
+    // A slot taken but not filled yet stops the draining, the slots applied
+    // are emptied before the head moves past them and a lookup reuses them
+    //..........................................................................
+    while ( head != tail ) {
+      volatile uint64_t* slot = &buffer->mSlots[head & ( sAccessBufferSize - 1 )];
+      uint64_t access = *slot;
+
+      if ( !access ) {
+        break;
+      }
+
+      *slot = 0;
+      head++;
+      ApplyAccess( shard, static_cast<uint32_t>( access >> 32 ),
+                   static_cast<uint32_t>( access ) );
+    }
+
+    __sync_synchronize();
+    buffer->mHead = head;
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Get the set of lookup counters of the calling thread
+//------------------------------------------------------------------------------
+LfcCache::Counters*
+LfcCache::GetCounters()
+{
+  //............................................................................
+  // The threads take the sets in turn, a set is only shared beyond
+  // sNumCounterSets threads
+  //............................................................................
+  if ( !counterSet ) {
+    counterSet = __sync_fetch_and_add( &numCounterThreads, 1 ) % sNumCounterSets + 1;
+  }
+
+  return &mCounters[counterSet - 1];
+}
+
+
+//------------------------------------------------------------------------------
+// Retire memory which the lookups without lock may still read
+//------------------------------------------------------------------------------
+void
+LfcCache::Retire( std::vector<Slot>* slots, char** chunks )
+{
+  //............................................................................
+  // The epoch is read after the memory was unpublished, under the mutex which
+  // also serializes the moves to the next epoch
+  //............................................................................
+  Retired retired;
+  retired.mSlots = slots;
+  retired.mChunks = chunks;
+
+  mRetireMutex.Lock();          // -->
+  retired.mEpoch = mEpoch;
+  mRetired.push_back( retired );
+  mNumRetired = mRetired.size();
+  mRetireMutex.UnLock();        // <--
+}
+
+
+//------------------------------------------------------------------------------
+// Retire the chunk tables replaced by the arenas of a shard
+//------------------------------------------------------------------------------
+void
+LfcCache::RetireChunkTables( Shard* shard )
+{
+  std::vector<char**> tables;
+  shard->mArena.TakeOldTables( tables );
+  shard->mDictArena.TakeOldTables( tables );
+
+  for ( size_t i = 0; i < tables.size(); i++ ) {
+    Retire( NULL, tables[i] );
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Move to the next epoch and free the memory whose grace period is over
+//------------------------------------------------------------------------------
+void
+LfcCache::Reclaim()
+{
+  if ( !mNumRetired ) {
+    return;
+  }
+
+  mRetireMutex.Lock();          // -->
+
+  //............................................................................
+  // The epoch moves on only once no lookup is counted in the parity of the
+  // next one, i.e. the lookups started in the previous epoch are done. After
+  // two moves every lookup which could have read the memory retired in an
+  // epoch is done.
+  //............................................................................
+  uint32_t epoch = mEpoch;
+  uint32_t parity = ( epoch + 1 ) & 1;
+  uint32_t num_readers = 0;
+  __sync_synchronize();
+
+  for ( unsigned int i = 0; i < sNumCounterSets; i++ ) {
+    num_readers += mCounters[i].mReaders[parity];
+  }
+
+  if ( !num_readers ) {
+    epoch = __sync_add_and_fetch( &mEpoch, 1 );
+  }
+
+  size_t num_kept = 0;
+
+  for ( size_t i = 0; i < mRetired.size(); i++ ) {
+    if ( epoch - mRetired[i].mEpoch >= 2 ) {
+      delete mRetired[i].mSlots;
+      delete[] mRetired[i].mChunks;
+    } else {
+      mRetired[num_kept++] = mRetired[i];
+    }
+  }
+
+  mRetired.resize( num_kept );
+  mNumRetired = num_kept;
+  mRetireMutex.UnLock();        // <--
+}
+
+
+//------------------------------------------------------------------------------
+// Get the number of cache hits and misses
+//------------------------------------------------------------------------------
+void
+LfcCache::GetStats( uint64_t& hits, uint64_t& misses ) const
+{
+  hits = 0;
+  misses = 0;
+
+  for ( unsigned int i = 0; i < sNumCounterSets; i++ ) {
+    hits += __sync_fetch_and_add( &mCounters[i].mHits, 0 );
+    misses += __sync_fetch_and_add( &mCounters[i].mMisses, 0 );
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Get the counters of the cache
+//------------------------------------------------------------------------------
+void
+LfcCache::GetStats( Stats& stats ) const
+{
+  memset( &stats, 0, sizeof( stats ) );
+  GetStats( stats.mHits, stats.mMisses );
+
+  for ( unsigned int i = 0; i < mNumShards; i++ ) {
+    Shard* shard = &mShards[i];
+    shard->mMutex.Lock();       // -->
+    stats.mEntries += shard->mSize;
+    stats.mExpired += shard->mExpired;
+    stats.mEvicted += shard->mEvicted;
+    shard->mMutex.UnLock();     // <--
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Save the valid entries of the cache to a snapshot file
+//------------------------------------------------------------------------------
+int
+LfcCache::Save( const std::string& path, uint64_t& numEntries ) const
+{
+  std::string tmp_path = path + ".tmp";
+  int fd = open( tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+  numEntries = 0;
+
+  if ( fd < 0 ) {
+    return -errno;
+  }
+
+  //............................................................................
+  // The header is written once all the records are known
+  //............................................................................
+  SnapshotHeader header;
+  memset( &header, 0, sizeof( header ) );
+  memcpy( header.mMagic, "LFCSNAP", 8 );
+  header.mVersion = sSnapshotVersion;
+  int retc = 0;
+
+  if ( lseek( fd, sizeof( header ), SEEK_SET ) < 0 ) {
+    retc = -errno;
+  }
+
+  std::string buffer;
+  time_t now = time( NULL );
+
+  for ( unsigned int i = 0; ( i < mNumShards ) && !retc; i++ ) {
+    Shard* shard = &mShards[i];
+    buffer.clear();
+
+    //..........................................................................
+    // Encode the shard while holding its lock and write it to the file after
+    // releasing it, the load puts the entries back in insertion order
+    //..........................................................................
+    shard->mMutex.Lock();       // -->
+
+    for ( int queue = 0; queue < eNumQueues; queue++ ) {
+      for ( uint32_t ref = shard->mQueues[queue].mOldest; ref;
+            ref = EntryPtr( shard, ref )->mNext ) {
+        const Entry* entry = EntryPtr( shard, ref );
+
+        if ( IsExpired( entry->mTime, now ) ) {
+          continue;
+        }
+
+        size_t dir_len;
+        size_t prefix_len;
+        const char* dir = shard->mDict.Get( entry->mLfnDir, dir_len );
+        const char* prefix = shard->mDict.Get( entry->mPfnPrefix, prefix_len );
+        SnapshotRecord record;
+        record.mTime = entry->mTime;
+        record.mLfnLen = dir_len + entry->mNameLen;
+        record.mPfnHeadLen = prefix_len + entry->mPfnLen;
+        record.mPfnSuffix = entry->mPfnSuffix;
+        record.mReserved = 0;
+        size_t size = sizeof( record ) + record.mLfnLen + record.mPfnHeadLen;
+        buffer.append( reinterpret_cast<const char*>( &record ), sizeof( record ) );
+        buffer.append( dir, dir_len );
+        buffer.append( entry->Name(), entry->mNameLen );
+        buffer.append( prefix, prefix_len );
+        buffer.append( entry->PfnLiteral(), entry->mPfnLen );
+        buffer.append( ( 8 - size % 8 ) % 8, '\0' );
+        numEntries++;
+      }
+    }
+
+    shard->mMutex.UnLock();     // <--
+    size_t offset = 0;
+
+    while ( offset < buffer.size() ) {
+      ssize_t nwrite = write( fd, buffer.data() + offset, buffer.size() - offset );
+
+      if ( nwrite < 0 ) {
+        if ( errno == EINTR ) {
+          continue;
+        }
+
+        retc = -errno;
+        break;
+      }
+
+      offset += nwrite;
+      header.mDataSize += nwrite;
+    }
+  }
+
+  header.mNumEntries = numEntries;
+
+  if ( !retc && ( pwrite( fd, &header, sizeof( header ), 0 ) !=
+                  static_cast<ssize_t>( sizeof( header ) ) ) )
+  {
+    retc = ( errno ? -errno : -EIO );
+  }
+
+  if ( !retc && fsync( fd ) ) {
+    retc = -errno;
+  }
+
+  if ( close( fd ) && !retc ) {
+    retc = -errno;
+  }
+
+  if ( !retc && rename( tmp_path.c_str(), path.c_str() ) ) {
+    retc = -errno;
+  }
+
+  if ( retc ) {
+    unlink( tmp_path.c_str() );
+  }
+
+  return retc;
+}
+
+
+//------------------------------------------------------------------------------
+// Load the entries from a snapshot file
+//------------------------------------------------------------------------------
+int
+LfcCache::Load( const std::string& path, uint64_t& numEntries )
+{
+  struct stat info;
+  int fd = open( path.c_str(), O_RDONLY );
+  numEntries = 0;
+
+  if ( fd < 0 ) {
+    return -errno;
+  }
+
+  if ( fstat( fd, &info ) ) {
+    int retc = -errno;
+    close( fd );
+    return retc;
+  }
+
+  if ( info.st_size < static_cast<off_t>( sizeof( SnapshotHeader ) ) ) {
+    close( fd );
+    return -EINVAL;
+  }
+
+  void* addr = mmap( NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+  close( fd );
+
+  if ( addr == MAP_FAILED ) {
+    return -errno;
+  }
+
+  ( void ) madvise( addr, info.st_size, MADV_SEQUENTIAL );
+  const char* data = static_cast<const char*>( addr );
+  const SnapshotHeader* header = reinterpret_cast<const SnapshotHeader*>( data );
+
+  if ( memcmp( header->mMagic, "LFCSNAP", 8 ) ||
+       ( header->mVersion != sSnapshotVersion ) ||
+       ( header->mDataSize != info.st_size - sizeof( SnapshotHeader ) ) ||
+       ( header->mNumEntries > header->mDataSize / sizeof( SnapshotRecord ) ) )
+  {
+    munmap( addr, info.st_size );
+    return -EINVAL;
+  }
+
+  //............................................................................
+  // Collect the records still valid, the snapshot keeps the insertion order
+  // at most per queue of a shard therefore they are sorted by their insertion
+  // time
+  //............................................................................
+  std::vector< std::pair<time_t, size_t> > records;
+  records.reserve( header->mNumEntries );
+  const char* end = data + info.st_size;
+  const char* ptr = data + sizeof( SnapshotHeader );
+  time_t now = time( NULL );
+  uint64_t num_records = 0;
+  int retc = 0;
+
+  while ( ptr < end ) {
+    SnapshotRecord record;
+
+    if ( end - ptr < static_cast<ssize_t>( sizeof( record ) ) ) {
+      retc = -EINVAL;
+      break;
+    }
+
+    memcpy( &record, ptr, sizeof( record ) );
+    size_t size = sizeof( record ) + record.mLfnLen + record.mPfnHeadLen;
+    size += ( 8 - size % 8 ) % 8;
+
+    if ( ( static_cast<size_t>( end - ptr ) < size ) ||
+         ( record.mPfnSuffix > record.mLfnLen ) )
+    {
+      retc = -EINVAL;
+      break;
+    }
+
+    if ( !IsExpired( record.mTime, now ) ) {
+      records.push_back( std::make_pair( static_cast<time_t>( record.mTime ),
+                                         static_cast<size_t>( ptr - data ) ) );
+    }
+
+    ptr += size;
+    num_records++;
+  }
+
+  //............................................................................
+  // A count not matching the records means a corrupt file
+  //............................................................................
+  if ( !retc && ( num_records != header->mNumEntries ) ) {
+    retc = -EINVAL;
+  }
+
+  if ( !retc ) {
+    std::stable_sort( records.begin(), records.end(), CompareFirst );
+    std::string pfn;
+
+    for ( size_t i = 0; i < records.size(); i++ ) {
+      SnapshotRecord record;
+      memcpy( &record, data + records[i].second, sizeof( record ) );
+      const char* lfn = data + records[i].second + sizeof( record );
+      pfn.assign( lfn + record.mLfnLen, record.mPfnHeadLen );
+      pfn.append( lfn + record.mLfnLen - record.mPfnSuffix, record.mPfnSuffix );
+      InsertEntry( lfn, record.mLfnLen, pfn.c_str(), pfn.length(), record.mTime );
+    }
+
+    numEntries = records.size();
+  }
+
+  munmap( addr, info.st_size );
+  return retc;
+}
+
+
+//------------------------------------------------------------------------------
+// Start the thread expiring and evicting the entries in the background
+//------------------------------------------------------------------------------
+int
+LfcCache::StartMaintenance( int interval, unsigned int highWatermark )
+{
+  if ( mMaintRunning ) {
+    return -EBUSY;
+  }
+
+  mMaintInterval = ( interval > 0 ) ? interval : 1;
+  mShardHighWatermark = mShardMaxSize + mShardMaxSize * highWatermark / 100;
+  mMaintStop = false;
+
+  if ( XrdSysThread::Run( &mMaintThread, LfcCache::StartMaintenanceThread,
+                          static_cast<void*>( this ), XRDSYSTHREAD_HOLD,
+                          "LFC cache maintenance" ) )
+  {
+    return ( errno ? -errno : -EAGAIN );
+  }
+
+  mMaintRunning = true;
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+// Stop the maintenance thread
+//------------------------------------------------------------------------------
+void
+LfcCache::StopMaintenance()
+{
+  if ( !mMaintRunning ) {
+    return;
+  }
+
+  mMaintCond.Lock();
+  mMaintStop = true;
+  mMaintCond.Signal();
+  mMaintCond.UnLock();
+  XrdSysThread::Join( mMaintThread, NULL );
+  mMaintRunning = false;
+}
+
+
+//------------------------------------------------------------------------------
+// Test if an entry inserted at the given time is expired
+//------------------------------------------------------------------------------
+bool
+LfcCache::IsExpired( time_t insertTime, time_t now ) const
+{
+  return ( static_cast<uint64_t>( difftime( now, insertTime ) ) >= mCacheTtl );
+}
+
+
+//------------------------------------------------------------------------------
+// Find the slot holding an lfn in the hash index of a shard
+//------------------------------------------------------------------------------
+ssize_t
+LfcCache::FindSlot( const Shard* shard, uint64_t hash,
+                    const char* lfn, size_t len ) const
+{
+  if ( shard->mSlots.empty() ) {
+    return -1;
+  }
+
+  uint32_t tag = static_cast<uint32_t>( hash );
+  size_t mask = shard->mSlots.size() - 1;
+  size_t pos = hash & mask;
+
+  //............................................................................
+  // The index is never full so the probing always ends
+  //............................................................................
+  while ( shard->mSlots[pos].mRef ) {
+    const Slot& slot = shard->mSlots[pos];
+
+    if ( slot.mTag == tag ) {
+      if ( Matches( shard, EntryPtr( shard, slot.mRef ), lfn, len ) ) {
+        return pos;
+      }
+    }
+
+    pos = ( pos + 1 ) & mask;
+  }
+
+  return -1;
+}
+
+
+//------------------------------------------------------------------------------
+// Add an entry to the hash index of a shard
+//------------------------------------------------------------------------------
+void
+LfcCache::AddSlot( Shard* shard, uint64_t hash, uint32_t ref )
+{
+  //............................................................................
+  // Double the index when it gets more than 3/4 full
+  //............................................................................
+  if ( 4 * ( shard->mSize + 1 ) > 3 * shard->mSlots.size() ) {
+    size_t num_slots = 2 * shard->mSlots.size();
+
+    if ( num_slots < sMinSlots ) {
+      num_slots = sMinSlots;
+    }
+
+    std::vector<Slot> old_slots( num_slots );
+    old_slots.swap( shard->mSlots );
+    size_t mask = shard->mSlots.size() - 1;
+
+    for ( size_t i = 0; i < old_slots.size(); i++ ) {
+      if ( old_slots[i].mRef ) {
+        size_t pos = old_slots[i].mTag & mask;
+
+        while ( shard->mSlots[pos].mRef ) {
+          pos = ( pos + 1 ) & mask;
+        }
+
+        shard->mSlots[pos] = old_slots[i];
+      }
+    }
+
+    //..........................................................................
+    // Publish the new array before its mask, so that a lookup never probes an
+    // array with the mask of a bigger one. The old array is retired since a
+    // lookup may still be probing it.
+    //..........................................................................
+    __sync_synchronize();
+    shard->mReadSlots = &shard->mSlots[0];
+    __sync_synchronize();
+    shard->mReadMask = mask;
+
+    if ( !old_slots.empty() ) {
+      std::vector<Slot>* retired = new std::vector<Slot>();
+      retired->swap( old_slots );
+      Retire( retired, NULL );
+    }
+  }
+
+  size_t mask = shard->mSlots.size() - 1;
+  size_t pos = hash & mask;
+
+  while ( shard->mSlots[pos].mRef ) {
+    pos = ( pos + 1 ) & mask;
+  }
+
+  shard->mSlots[pos].mTag = static_cast<uint32_t>( hash );
+  shard->mSlots[pos].mRef = ref;
+  shard->mSize++;
+}
+
+
+//------------------------------------------------------------------------------
+// Remove a slot from the hash index of a shard
+//------------------------------------------------------------------------------
+void
+LfcCache::RemoveSlot( Shard* shard, size_t pos )
+{
+  size_t mask = shard->mSlots.size() - 1;
+  size_t hole = pos;
+  size_t next = ( pos + 1 ) & mask;
+
+  //............................................................................
+  // Move back into the hole every following entry of the probe sequence whose
+  // ideal position is not between the hole and its current position
+  //............................................................................
+  while ( shard->mSlots[next].mRef ) {
+    size_t ideal = shard->mSlots[next].mTag & mask;
+
+    if ( ( ( next - ideal ) & mask ) >= ( ( next - hole ) & mask ) ) {
+      shard->mSlots[hole] = shard->mSlots[next];
+      hole = next;
+    }
+
+    next = ( next + 1 ) & mask;
+  }
+
+  shard->mSlots[hole].mTag = 0;
+  shard->mSlots[hole].mRef = 0;
+  shard->mSize--;
+}
+
+
+//------------------------------------------------------------------------------
+// Remove an entry from the shard and free its memory
+//------------------------------------------------------------------------------
+void
+LfcCache::RemoveEntry( Shard* shard, uint32_t ref )
+{
+  Entry* entry = EntryPtr( shard, ref );
+  bool found = false;
+  size_t mask = shard->mSlots.size() - 1;
+  size_t pos = entry->mTag & mask;
+
+  while ( shard->mSlots[pos].mRef ) {
+    if ( shard->mSlots[pos].mRef == ref ) {
+      RemoveSlot( shard, pos );
+      found = true;
+      break;
+    }
+
+    pos = ( pos + 1 ) & mask;
+  }
+
+  if ( !found ) {
+    fprintf( stderr, "Warning: Entry found in queue but not in index.\n" );
+  }
+
+  Dequeue( shard, ref );
+  shard->mDict.Release( entry->mLfnDir );
+  shard->mDict.Release( entry->mPfnPrefix );
+  shard->mArena.Free( ref, entry->BlockSize() );
+}
+
+
+//------------------------------------------------------------------------------
+// Select the aging queue of a new entry
+//------------------------------------------------------------------------------
+LfcCache::QueueId
+LfcCache::SelectQueue( Shard* shard, uint64_t hash )
+{
+  if ( mPolicy == eFifo ) {
+    return eMain;
+  }
+
+  //............................................................................
+  // An lfn dropped recently from the small queue of s3fifo goes to the main
+  // queue
+  //............................................................................
+  if ( mPolicy == eS3Fifo ) {
+    uint32_t tag = static_cast<uint32_t>( hash );
+    uint32_t& ghost = shard->mGhost[tag & ( shard->mGhost.size() - 1 )];
+
+    if ( tag && ( ghost == tag ) ) {
+      ghost = 0;
+      return eMain;
+    }
+  }
+
+  return eWindow;
+}
+
+
+//------------------------------------------------------------------------------
+// Drop the expired entries found at the heads of the aging queues
+//------------------------------------------------------------------------------
+size_t
+LfcCache::DropExpired( Shard* shard, time_t now, size_t maxEntries )
+{
+  //............................................................................
+  // The aging queues are kept in the order the entries were queued therefore
+  // the expired entries are mostly found at their heads. With fifo this is the
+  // insertion order and the head is the oldest entry.
+  //............................................................................
+  size_t num_expired = 0;
+
+  for ( int i = 0; i < eNumQueues; i++ ) {
+    Queue& queue = shard->mQueues[i];
+
+    while ( ( num_expired < maxEntries ) && queue.mOldest &&
+            IsExpired( EntryPtr( shard, queue.mOldest )->mTime, now ) )
+    {
+      RemoveEntry( shard, queue.mOldest );
+      num_expired++;
+    }
+  }
+
+  shard->mExpired += num_expired;
+  return num_expired;
+}
+
+
+//------------------------------------------------------------------------------
+// Drop entries until there is room for new ones
+//------------------------------------------------------------------------------
+bool
+LfcCache::MakeRoom( Shard* shard, size_t room, time_t now, size_t maxSteps )
+{
+  Queue& window = shard->mQueues[eWindow];
+  Queue& main = shard->mQueues[eMain];
+  size_t steps = 0;
+
+  if ( mPolicy == eFifo ) {
+    while ( main.mOldest && ( shard->mSize + room > mShardMaxSize ) ) {
+      if ( steps++ == maxSteps ) {
+        return false;
+      }
+
+      RemoveEntry( shard, main.mOldest );
+      shard->mEvicted++;
+    }
+
+    return true;
+  }
+
+  if ( mPolicy == eS3Fifo ) {
+    while ( shard->mSize + room > mShardMaxSize ) {
+      if ( steps++ == maxSteps ) {
+        return false;
+      }
+
+      if ( ( window.mSize < mWindowMaxSize ) && main.mOldest ) {
+        DropEntry( shard, SelectVictim( shard, now ), now );
+        continue;
+      }
+
+      //........................................................................
+      // The entries of the small queue looked up since they were queued move
+      // to the main queue, the others are dropped and remembered
+      //........................................................................
+      uint32_t ref = window.mOldest;
+      Entry* entry = EntryPtr( shard, ref );
+
+      if ( entry->mFreq && !IsExpired( entry->mTime, now ) ) {
+        entry->mFreq = 0;
+        Dequeue( shard, ref );
+        Enqueue( shard, eMain, ref );
+      } else {
+        if ( entry->mTag ) {
+          shard->mGhost[entry->mTag & ( shard->mGhost.size() - 1 )] = entry->mTag;
+        }
+
+        DropEntry( shard, ref, now );
+      }
+    }
+
+    return true;
+  }
+
+  //............................................................................
+  // The entry leaving the window of tinylfu goes to the main queue if there is
+  // room, otherwise it takes the place of the main queue victim only if it was
+  // looked up more often recently
+  //............................................................................
+  while ( window.mSize + room > mWindowMaxSize ) {
+    if ( steps++ == maxSteps ) {
+      return false;
+    }
+
+    uint32_t candidate = window.mOldest;
+    Entry* entry = EntryPtr( shard, candidate );
+
+    if ( IsExpired( entry->mTime, now ) ) {
+      DropEntry( shard, candidate, now );
+      continue;
+    }
+
+    if ( shard->mSize + room <= mShardMaxSize ) {
+      Dequeue( shard, candidate );
+      Enqueue( shard, eMain, candidate );
+      continue;
+    }
+
+    uint32_t victim = SelectVictim( shard, now );
+
+    if ( !victim ) {
+      DropEntry( shard, candidate, now );
+    } else if ( IsExpired( EntryPtr( shard, victim )->mTime, now ) ||
+                ( shard->mSketch.Frequency( entry->mTag ) >
+                  shard->mSketch.Frequency( EntryPtr( shard, victim )->mTag ) ) )
+    {
+      DropEntry( shard, victim, now );
+      Dequeue( shard, candidate );
+      Enqueue( shard, eMain, candidate );
+    } else {
+      DropEntry( shard, candidate, now );
+    }
+  }
+
+  while ( shard->mSize + room > mShardMaxSize ) {
+    if ( steps++ == maxSteps ) {
+      return false;
+    }
+
+    uint32_t victim = SelectVictim( shard, now );
+    DropEntry( shard, victim ? victim : window.mOldest, now );
+  }
+
+  return true;
+}
+
+
+//------------------------------------------------------------------------------
+// Select the entry to drop from the main queue
+//------------------------------------------------------------------------------
+uint32_t
+LfcCache::SelectVictim( Shard* shard, time_t now )
+{
+  Queue& main = shard->mQueues[eMain];
+
+  //............................................................................
+  // Every pass over an entry lowers its count, so the loop ends
+  //............................................................................
+  while ( main.mOldest ) {
+    uint32_t ref = main.mOldest;
+    Entry* entry = EntryPtr( shard, ref );
+
+    if ( !entry->mFreq || IsExpired( entry->mTime, now ) ) {
+      return ref;
+    }
+
+    entry->mFreq--;
+    Dequeue( shard, ref );
+    Enqueue( shard, eMain, ref );
+  }
+
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+// Remove an entry to make room
+//------------------------------------------------------------------------------
+void
+LfcCache::DropEntry( Shard* shard, uint32_t ref, time_t now )
+{
+  if ( IsExpired( EntryPtr( shard, ref )->mTime, now ) ) {
+    shard->mExpired++;
+  } else {
+    shard->mEvicted++;
+  }
+
+  RemoveEntry( shard, ref );
+}
+
+
+//------------------------------------------------------------------------------
+// Append an entry to an aging queue
+//------------------------------------------------------------------------------
+void
+LfcCache::Enqueue( Shard* shard, QueueId queue, uint32_t ref )
+{
+  Queue& q = shard->mQueues[queue];
+  Entry* entry = EntryPtr( shard, ref );
+  entry->mQueue = queue;
+  entry->mPrev = q.mNewest;
+  entry->mNext = 0;
+
+  if ( q.mNewest ) {
+    EntryPtr( shard, q.mNewest )->mNext = ref;
+  } else {
+    q.mOldest = ref;
+  }
+
+  q.mNewest = ref;
+  q.mSize++;
+}
+
+
+//------------------------------------------------------------------------------
+// Unlink an entry from its aging queue
+//------------------------------------------------------------------------------
+void
+LfcCache::Dequeue( Shard* shard, uint32_t ref )
+{
+  Entry* entry = EntryPtr( shard, ref );
+  Queue& q = shard->mQueues[entry->mQueue];
+
+  if ( entry->mPrev ) {
+    EntryPtr( shard, entry->mPrev )->mNext = entry->mNext;
+  } else {
+    q.mOldest = entry->mNext;
+  }
+
+  if ( entry->mNext ) {
+    EntryPtr( shard, entry->mNext )->mPrev = entry->mPrev;
+  } else {
+    q.mNewest = entry->mPrev;
+  }
+
+  q.mSize--;
+}
+
+
+//------------------------------------------------------------------------------
+// Test if an entry holds a given lfn
+//------------------------------------------------------------------------------
+bool
+LfcCache::Matches( const Shard* shard, const Entry* entry,
+                   const char* lfn, size_t len )
+{
+  size_t dir_len;
+  const char* dir = shard->mDict.Get( entry->mLfnDir, dir_len );
+
+  return ( ( dir_len + entry->mNameLen == len ) &&
+           !memcmp( lfn + dir_len, entry->Name(), entry->mNameLen ) &&
+           !memcmp( lfn, dir, dir_len ) );
+}
+
+
+//------------------------------------------------------------------------------
+// Rebuild the pfn of an entry
+//------------------------------------------------------------------------------
+void
+LfcCache::DecodePfn( const Shard* shard, const Entry* entry, std::string& pfn )
+{
+  size_t prefix_len;
+  size_t dir_len;
+  const char* prefix = shard->mDict.Get( entry->mPfnPrefix, prefix_len );
+  const char* dir = shard->mDict.Get( entry->mLfnDir, dir_len );
+
+  pfn.reserve( prefix_len + entry->mPfnLen + entry->mPfnSuffix );
+  pfn.assign( prefix, prefix_len );
+  pfn.append( entry->PfnLiteral(), entry->mPfnLen );
+
+  //............................................................................
+  // The lfn tail can start in the directory part of the lfn
+  //............................................................................
+  if ( entry->mPfnSuffix > entry->mNameLen ) {
+    size_t from_dir = entry->mPfnSuffix - entry->mNameLen;
+    pfn.append( dir + dir_len - from_dir, from_dir );
+    pfn.append( entry->Name(), entry->mNameLen );
+  } else {
+    pfn.append( entry->Name() + entry->mNameLen - entry->mPfnSuffix,
+                entry->mPfnSuffix );
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Get the shard responsible for a hash value
+//------------------------------------------------------------------------------
+LfcCache::Shard*
+LfcCache::GetShard( uint64_t hash ) const
+{
+  //............................................................................
+  // The low bits of the hash are used for the index inside the shard
+  //............................................................................
+  return &mShards[( hash >> 32 ) % mNumShards];
+}
+
+
+//------------------------------------------------------------------------------
+// Rebuild the pfn of an entry into a buffer
+//------------------------------------------------------------------------------
+size_t
+LfcCache::DecodePfn( const Shard* shard, const Entry* entry, char* pfn, size_t size )
+{
+  size_t prefix_len;
+  size_t dir_len;
+  const char* prefix = shard->mDict.Get( entry->mPfnPrefix, prefix_len );
+  const char* dir = shard->mDict.Get( entry->mLfnDir, dir_len );
+  size_t len = prefix_len + entry->mPfnLen + entry->mPfnSuffix;
+
+  if ( len >= size ) {
+    return len;
+  }
+
+  memcpy( pfn, prefix, prefix_len );
+  pfn += prefix_len;
+  memcpy( pfn, entry->PfnLiteral(), entry->mPfnLen );
+  pfn += entry->mPfnLen;
+
+  //............................................................................
+  // The lfn tail can start in the directory part of the lfn
+  //............................................................................
+  if ( entry->mPfnSuffix > entry->mNameLen ) {
+    size_t from_dir = entry->mPfnSuffix - entry->mNameLen;
+    memcpy( pfn, dir + dir_len - from_dir, from_dir );
+    memcpy( pfn + from_dir, entry->Name(), entry->mNameLen );
+  } else {
+    memcpy( pfn, entry->Name() + entry->mNameLen - entry->mPfnSuffix,
+            entry->mPfnSuffix );
+  }
+
+  pfn[entry->mPfnSuffix] = '\0';
+  return len;
+}
+
+
+//------------------------------------------------------------------------------
+// Start function of the maintenance thread
+//------------------------------------------------------------------------------
+void*
+LfcCache::StartMaintenanceThread( void* arg )
+{
+  LfcCache* cache = static_cast<LfcCache*>( arg );
+  cache->MaintenanceLoop();
+  return NULL;
+}
+
+
+//------------------------------------------------------------------------------
+// Run the maintenance passes until the thread is stopped
+//------------------------------------------------------------------------------
+void
+LfcCache::MaintenanceLoop()
+{
+  mMaintCond.Lock();
+
+  while ( !mMaintStop ) {
+    mMaintCond.WaitMS( mMaintInterval );
+
+    if ( mMaintStop ) {
+      break;
+    }
+
+    mMaintCond.UnLock();
+    Maintain();
+    mMaintCond.Lock();
+  }
+
+  mMaintCond.UnLock();
+}
+
+
+//------------------------------------------------------------------------------
+// Expire and evict entries in all the shards
+//------------------------------------------------------------------------------
+void
+LfcCache::Maintain()
+{
+  struct timespec start;
+  struct timespec now_ts;
+  unsigned int num_clean = 0;
+  clock_gettime( CLOCK_MONOTONIC, &start );
+
+  //............................................................................
+  // The shards are visited round robin, one batch per lock, until all of them
+  // are found clean in a row. A pass ending on its time slice resumes with
+  // the shard where it stopped.
+  //............................................................................
+  while ( num_clean < mNumShards ) {
+    Shard* shard = &mShards[mMaintShard];
+    time_t now = time( NULL );
+
+    LockShard( shard );           // -->
+    DrainAccesses( shard );
+    size_t num_dropped = DropExpired( shard, now, sMaintenanceBatch );
+    bool clean = ( num_dropped < sMaintenanceBatch ) &&
+                 MakeRoom( shard, 0, now, sMaintenanceBatch - num_dropped );
+    UnlockShard( shard );         // <--
+
+    num_clean = clean ? num_clean + 1 : 0;
+    mMaintShard = ( mMaintShard + 1 ) % mNumShards;
+    clock_gettime( CLOCK_MONOTONIC, &now_ts );
+
+    if ( ( now_ts.tv_sec - start.tv_sec ) * 1000 +
+         ( now_ts.tv_nsec - start.tv_nsec ) / 1000000 >= mMaintInterval )
+    {
+      break;
+    }
+  }
+
+  Reclaim();
+}
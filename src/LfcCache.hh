@@ -26,32 +26,94 @@
 
 /*----------------------------------------------------------------------------*/
 #include <XrdSys/XrdSysPthread.hh>
+#include <cstring>
 #include <string>
-#include <map>
-#include <list>
+#include <vector>
 /*----------------------------------------------------------------------------*/
+#include <stddef.h>
 #include <stdint.h>
+#include <sys/types.h>
+/*----------------------------------------------------------------------------*/
+#include "LfcArena.hh"
+#include "LfcDict.hh"
+#include "LfcSketch.hh"
 /*----------------------------------------------------------------------------*/
 
 
 //------------------------------------------------------------------------------
-//! Simple cache for the LFC entries
+//! Simple cache for the LFC entries. The entries are spread over a number of
+//! shards, selected by the hash of the lfn, each one having its own lock, hash
+//! index and aging queue so that concurrent inserts don't contend on the same
+//! lock. The hash index uses open addressing with linear probing and keeps part
+//! of the hash of every entry, so that a lookup can be done directly on a C
+//! string and most of the mismatching slots are skipped without touching the
+//! entry. Each entry is a single block in the arena of its shard, linked
+//! intrusively in the aging queue, and the parts of the lfn and pfn shared by
+//! many entries are kept only once in a dictionary. The content of the cache
+//! can be saved to a snapshot file and loaded back, keeping the insertion
+//! time of every entry.
+//!
+//! When a shard is full the entry to drop is chosen by the eviction policy:
+//!  - fifo: the oldest entry
+//!  - s3fifo: new entries go to a small queue holding 10% of the shard, those
+//!    looked up again before reaching its head move to the main queue, the
+//!    others are dropped and remembered in a ghost table so that they go
+//!    straight to the main queue if inserted again. The main queue gives a
+//!    second chance to the entries looked up since they were queued.
+//!  - tinylfu: new entries go to a window queue holding 1% of the shard, the
+//!    entry leaving the window replaces the victim of the main queue only if a
+//!    frequency sketch of the recent lookups says it is the more popular one.
+//!    The main queue gives a second chance like for s3fifo.
+//! A scan of lfns looked up once therefore doesn't flush the entries used by
+//! many jobs with s3fifo and tinylfu. The lookups only record the accesses,
+//! the queues are changed by the inserts under the write lock.
+//!
+//! The lookups take no lock and write only to the counters of their thread
+//! and, unless the eviction policy is fifo, to a small buffer of the shard
+//! where they append the accesses. The writers apply the buffered accesses
+//! to the entries and the sketch under the lock, a lookup finding the buffer
+//! full drains it itself if the lock is free and otherwise drops the access. The lock of a shard only serializes the
+//! writers, which make the sequence number of the shard odd while they change
+//! it. A lookup reads the sequence number, searches the shard and gives up its
+//! result if the number changed meanwhile, taking the lock after a few tries.
+//! A lookup never writes to the memory of an entry, which a writer can drop
+//! and reuse for another entry at any time. What it reads stays allocated:
+//! the arena chunks are only freed with the cache, and the arrays of the hash
+//! index and the chunk tables of the arenas replaced when they grow are
+//! retired and freed after a grace period. A lookup counts itself in the
+//! epoch it started in, the epoch only moves on once the lookups of the
+//! previous one are done, and retired memory is freed two epochs later. The
+//! hits and misses are counted per thread.
+//!
+//! By default the expired entries are dropped and room is made by the thread
+//! doing the insert. With the maintenance thread started, an insert only
+//! appends the new entry and the thread brings the shards back under their
+//! size in small batches, releasing the lock of the shard between two of
+//! them. An insert still cleans up if its shard grew past the high watermark
+//! because the thread does not keep up.
 //------------------------------------------------------------------------------
 class LfcCache
 {
   public:
 
-    typedef std::list< std::pair<std::string, time_t> > ListType;
-    typedef std::map<std::string, std::pair< std::string, ListType::iterator > > MapType;
+    //! Eviction policy
+    enum Policy {
+      eFifo,      ///< drop the oldest entry
+      eS3Fifo,    ///< small and main FIFO queues with a ghost table
+      eTinyLfu    ///< window and main queues with a frequency sketch admission
+    };
 
     //----------------------------------------------------------------------------
     //! Constructor
     //!
     //! @param cacheTtl time a record is valid in cache after insertion
     //! @param cacheMaxSize the maximum value to which the cache can grow
+    //! @param numShards number of shards among which the entries are distributed
+    //! @param policy eviction policy
     //!
     //----------------------------------------------------------------------------
-    LfcCache( uint64_t cacheTtl, uint64_t cacheMaxSize );
+    LfcCache( uint64_t cacheTtl, uint64_t cacheMaxSize, unsigned int numShards = 1,
+              Policy policy = eFifo );
 
 
     //----------------------------------------------------------------------------
@@ -67,7 +129,7 @@ class LfcCache
     //! @param pfn physiscal file name
     //
     //----------------------------------------------------------------------------
-    virtual void Insert( std::string lfn, std::string pfn );
+    virtual void Insert( const std::string& lfn, const std::string& pfn );
 
 
     //----------------------------------------------------------------------------
@@ -79,18 +141,738 @@ class LfcCache
     //! @return true if entry found in cache, false otherwise
     //!
     //----------------------------------------------------------------------------
-    virtual bool GetEntry( std::string lfn, std::string& pfn );
+    virtual bool GetEntry( const std::string& lfn, std::string& pfn );
+
+
+    //----------------------------------------------------------------------------
+    //! Try to get an entry from cache without building a string for the lfn
+    //!
+    //! @param lfn logical file name we are looking for
+    //! @param len length of the logical file name
+    //! @param pfn the pfn retrieved from cache
+    //!
+    //! @return true if entry found in cache, false otherwise
+    //!
+    //----------------------------------------------------------------------------
+    virtual bool GetEntry( const char* lfn, size_t len, std::string& pfn );
+
+
+    //----------------------------------------------------------------------------
+    //! Try to get an entry from cache into a buffer of the caller, without any
+    //! memory allocation
+    //!
+    //! @param lfn logical file name we are looking for
+    //! @param len length of the logical file name
+    //! @param pfn buffer receiving the null terminated pfn
+    //! @param size size of the buffer
+    //! @param pfnLen length of the pfn retrieved from cache
+    //!
+    //! @return true if entry found in cache and fits in the buffer, false
+    //!         otherwise
+    //!
+    //----------------------------------------------------------------------------
+    virtual bool GetEntry( const char* lfn, size_t len, char* pfn, size_t size,
+                           size_t& pfnLen );
+
+
+    //----------------------------------------------------------------------------
+    //! Save the valid entries of the cache to a snapshot file. The snapshot is
+    //! written to a temporary file which is then renamed, so that a reader
+    //! never sees a partially written snapshot.
+    //!
+    //! @param path path of the snapshot file
+    //! @param numEntries number of entries saved
+    //!
+    //! @return 0 if successful, otherwise -errno
+    //!
+    //----------------------------------------------------------------------------
+    int Save( const std::string& path, uint64_t& numEntries ) const;
+
+
+    //----------------------------------------------------------------------------
+    //! Load the entries from a snapshot file. The file is memory mapped and
+    //! the entries which did not expire in the meantime are inserted in the
+    //! order of their original insertion time, which they keep.
+    //!
+    //! @param path path of the snapshot file
+    //! @param numEntries number of entries loaded
+    //!
+    //! @return 0 if successful, otherwise -errno
+    //!
+    //----------------------------------------------------------------------------
+    int Load( const std::string& path, uint64_t& numEntries );
+
+
+    //----------------------------------------------------------------------------
+    //! Get the number of cache hits and misses since the cache was created
+    //!
+    //! @param hits number of lookups which found a valid entry
+    //! @param misses number of lookups which did not find a valid entry
+    //!
+    //----------------------------------------------------------------------------
+    void GetStats( uint64_t& hits, uint64_t& misses ) const;
+
+
+    //----------------------------------------------------------------------------
+    //! Counters of the cache since it was created
+    //----------------------------------------------------------------------------
+    struct Stats {
+      uint64_t mEntries;  ///< number of entries, expired ones not yet dropped included
+      uint64_t mHits;     ///< number of lookups which found a valid entry
+      uint64_t mMisses;   ///< number of lookups which did not find a valid entry
+      uint64_t mExpired;  ///< number of entries dropped because expired
+      uint64_t mEvicted;  ///< number of entries dropped to make room for new ones
+    };
+
+
+    //----------------------------------------------------------------------------
+    //! Get the counters of the cache
+    //!
+    //! @param stats filled with the counters
+    //!
+    //----------------------------------------------------------------------------
+    void GetStats( Stats& stats ) const;
+
+
+    //----------------------------------------------------------------------------
+    //! Start the thread expiring and evicting the entries in the background
+    //!
+    //! @param interval time in milliseconds between two maintenance passes, a
+    //!        pass lasting at most as long
+    //! @param highWatermark percentage of the maximum size by which a shard
+    //!        can grow before the inserts clean up themselves
+    //!
+    //! @return 0 if successful, otherwise -errno
+    //!
+    //----------------------------------------------------------------------------
+    int StartMaintenance( int interval, unsigned int highWatermark );
+
+
+    //----------------------------------------------------------------------------
+    //! Stop the maintenance thread, the inserts clean up themselves from now on
+    //----------------------------------------------------------------------------
+    void StopMaintenance();
 
   private:
 
-    uint64_t mCacheTtl;     ///< time a valid record can stay in cache
-    uint64_t mCacheMaxSize; ///< maximum cache size to which it can grow
-    XrdSysRWLock mRwLock;   ///< rw mutex for sync access to the cache
+    //! Maximum number of expired entries dropped during one insert
+    static const int sMaxExpirePerInsert = 64;
+
+    //! Maximum number of entries dropped during one insert past the high
+    //! watermark
+    static const size_t sMaxEvictPerInsert = 64;
+
+    //! Maximum number of entries handled by the maintenance thread per lock
+    static const size_t sMaintenanceBatch = 128;
+
+    //! Number of lookups without lock tried before taking the lock
+    static const int sMaxOptimisticReads = 4;
+
+    //! Size of the pfn buffer used by the lookups returning a string
+    static const size_t sPfnBufferSize = 1024;
+
+    //! Number of sets of lookup counters, shared by the threads beyond
+    static const unsigned int sNumCounterSets = 64;
+
+    //! Initial number of slots of the hash index of a shard
+    static const size_t sMinSlots = 16;
+
+    //! Version of the snapshot file format
+    static const uint32_t sSnapshotVersion = 1;
+
+    //! Highest access count kept in an entry
+    static const uint8_t sMaxFreq = 3;
+
+    //! Number of accesses held by a buffer of a shard, a power of 2
+    static const uint32_t sAccessBufferSize = 32;
+
+    //! Number of access buffers of a shard, shared by the threads in turn
+    static const unsigned int sNumAccessBuffers = 4;
+
+    //! Aging queues of a shard, fifo uses only the main one
+    enum QueueId {
+      eMain,      ///< main queue
+      eWindow,    ///< small queue of s3fifo, window of tinylfu
+      eNumQueues
+    };
+
+    //--------------------------------------------------------------------------
+    //! Header of the snapshot file, followed by the records
+    //--------------------------------------------------------------------------
+    struct SnapshotHeader {
+      char mMagic[8];        ///< file type identifier
+      uint32_t mVersion;     ///< version of the file format
+      uint32_t mReserved;    ///< unused, zero
+      uint64_t mNumEntries;  ///< number of records
+      uint64_t mDataSize;    ///< size in bytes of all the records
+    };
+
+    //--------------------------------------------------------------------------
+    //! Record of a cache entry in the snapshot file. It is followed by the lfn
+    //! and by the head of the pfn, the rest of the pfn being the tail of the
+    //! lfn. The records are padded to a multiple of 8 bytes.
+    //--------------------------------------------------------------------------
+    struct SnapshotRecord {
+      int64_t mTime;         ///< time when the entry was inserted in the cache
+      uint16_t mLfnLen;      ///< length of the lfn
+      uint16_t mPfnHeadLen;  ///< length of the pfn part stored in the record
+      uint16_t mPfnSuffix;   ///< length of the lfn tail which ends the pfn
+      uint16_t mReserved;    ///< unused, zero
+    };
+
+    //--------------------------------------------------------------------------
+    //! Cache entry, allocated as one block in the arena of the shard. The lfn is
+    //! split in its directory, kept in the dictionary of the shard, and its name
+    //! stored in the entry. The pfn is stored as a prefix from the dictionary,
+    //! usually the storage element path, followed by a literal part stored in
+    //! the entry and by the tail of the lfn which it has in common with the pfn.
+    //--------------------------------------------------------------------------
+    struct Entry {
+      time_t mTime;         ///< time when the entry was inserted in the cache
+      uint32_t mTag;        ///< low 32 bits of the hash of the logical file name
+      uint32_t mPrev;       ///< previous ( older ) entry in the aging queue
+      uint32_t mNext;       ///< next ( newer ) entry in the aging queue
+      uint32_t mLfnDir;     ///< dictionary reference of the lfn directory
+      uint32_t mPfnPrefix;  ///< dictionary reference of the pfn prefix
+      uint16_t mNameLen;    ///< length of the lfn after its directory
+      uint16_t mPfnLen;     ///< length of the literal part of the pfn
+      uint16_t mPfnSuffix;  ///< length of the lfn tail which ends the pfn
+      uint8_t mFreq;        ///< lookups since queued, up to sMaxFreq
+      uint8_t mQueue;       ///< aging queue holding the entry
+      char mData[2];        ///< lfn name followed by the literal part of the pfn
+
+      //! Get the name part of the logical file name
+      const char* Name() const {
+        return mData;
+      }
+
+      //! Get the literal part of the physical file name
+      const char* PfnLiteral() const {
+        return mData + mNameLen;
+      }
+
+      //! Get the size of the block holding the entry
+      size_t BlockSize() const {
+        return offsetof( Entry, mData ) + mNameLen + mPfnLen;
+      }
+    };
+
+    //--------------------------------------------------------------------------
+    //! Slot of the hash index, an empty slot has a null entry reference. The
+    //! tag holds the low 32 bits of the hash, enough to get the ideal position
+    //! of the entry in the index without touching the entry itself.
+    //--------------------------------------------------------------------------
+    struct Slot {
+      uint32_t mTag;  ///< low 32 bits of the hash of the lfn
+      uint32_t mRef;  ///< reference of the entry in the arena
+    };
+
+    //--------------------------------------------------------------------------
+    //! Aging queue, the entries are linked in the order they were queued
+    //--------------------------------------------------------------------------
+    struct Queue {
+      Queue(): mOldest( 0 ), mNewest( 0 ), mSize( 0 ) {}
+
+      uint32_t mOldest;         ///< head of the queue
+      uint32_t mNewest;         ///< tail of the queue
+      size_t mSize;             ///< number of entries in the queue
+    };
+
+    //--------------------------------------------------------------------------
+    //! Accesses recorded by the lookups of a shard, waiting to be applied under
+    //! the lock. A lookup takes a slot by moving the tail and then fills it, a
+    //! slot still empty ends the part which can be applied.
+    //--------------------------------------------------------------------------
+    struct AccessBuffer {
+      AccessBuffer(): mTail( 0 ), mHead( 0 ) {
+        memset( const_cast<uint64_t*>( mSlots ), 0, sizeof( mSlots ) );
+      }
+
+      volatile uint32_t mTail;  ///< next slot taken by a lookup
+      volatile uint32_t mHead;  ///< next slot applied, moved under the lock
+      char mPad[56];            ///< keep the slots apart from the positions
+      volatile uint64_t mSlots[sAccessBufferSize]; ///< tag of the lfn in the
+                                ///< high half, entry found or 0 in the low half
+    };
+
+    //--------------------------------------------------------------------------
+    //! Part of the cache protected by its own lock
+    //--------------------------------------------------------------------------
+    struct Shard {
+      Shard(): mSeq( 0 ), mReadSlots( NULL ), mReadMask( 0 ), mDict( mDictArena ),
+        mSize( 0 ), mExpired( 0 ), mEvicted( 0 ) {}
+
+      XrdSysMutex mMutex;       ///< mutex serializing the writers of the shard
+      volatile uint32_t mSeq;   ///< odd while a writer changes the shard
+      const Slot* mReadSlots;   ///< hash index as published to the lookups
+      size_t mReadMask;         ///< mask of mReadSlots, published after it
+      LfcArena mArena;          ///< memory for the entries of the shard
+      LfcArena mDictArena;      ///< memory for the strings of the dictionary,
+                                ///< kept apart so that an entry block is only
+                                ///< ever reused for another entry
+      LfcDict mDict;            ///< lfn directories and pfn prefixes
+      std::vector<Slot> mSlots; ///< hash index, the size is a power of 2
+      size_t mSize;             ///< number of entries in the shard
+      Queue mQueues[eNumQueues];///< aging queues
+      LfcSketch mSketch;        ///< recent lookups, used by tinylfu
+      std::vector<uint32_t> mGhost; ///< tags of entries dropped from the small
+                                    ///< queue, used by s3fifo
+      uint64_t mExpired;        ///< number of entries dropped because expired
+      uint64_t mEvicted;        ///< number of entries dropped because shard full
+      AccessBuffer mAccesses[sNumAccessBuffers]; ///< accesses not applied yet
+      char mPad[64];            ///< keep the locks of neighbouring shards apart
+    };
+
+    uint64_t mCacheTtl;      ///< time a valid record can stay in cache
+    uint64_t mCacheMaxSize;  ///< maximum cache size to which it can grow
+    uint64_t mShardMaxSize;  ///< maximum size to which one shard can grow
+    uint64_t mWindowMaxSize; ///< maximum size of the window queue of a shard
+    unsigned int mNumShards; ///< number of shards
+    Shard* mShards;          ///< array of shards
+
+    //--------------------------------------------------------------------------
+    //! Lookup counters of a set of threads, on their own cache lines
+    //--------------------------------------------------------------------------
+    struct Counters {
+      Counters(): mHits( 0 ), mMisses( 0 ) {
+        mReaders[0] = mReaders[1] = 0;
+      }
+
+      uint64_t mHits;           ///< number of lookups which found a valid entry
+      uint64_t mMisses;         ///< number of lookups which did not
+      volatile uint32_t mReaders[2]; ///< lookups without lock in progress, by
+                                     ///< parity of the epoch they started in
+      char mPad[104];           ///< keep the counters of other sets apart
+    };
+
+    //--------------------------------------------------------------------------
+    //! Memory replaced by a writer, freed once no lookup can still read it
+    //--------------------------------------------------------------------------
+    struct Retired {
+      uint32_t mEpoch;          ///< epoch in which the memory was retired
+      std::vector<Slot>* mSlots;///< old array of a hash index, or NULL
+      char** mChunks;           ///< old chunk table of an arena, or NULL
+    };
+
+    Counters* mCounters;     ///< lookup counters, sNumCounterSets of them
+    volatile uint32_t mEpoch;///< epoch of the lookups without lock
+    std::vector<Retired> mRetired; ///< memory waiting for its grace period
+    volatile size_t mNumRetired;   ///< size of mRetired, read without the lock
+    XrdSysMutex mRetireMutex;///< mutex serializing the retirements and epochs
+    Policy mPolicy;          ///< eviction policy
+    uint64_t mShardHighWatermark; ///< shard size from which the inserts clean up
+                                  ///< while the maintenance thread runs
+    int mMaintInterval;      ///< time in ms between two maintenance passes
+    unsigned int mMaintShard;///< shard where the next maintenance pass starts
+    bool mMaintRunning;      ///< mark if the maintenance thread is running
+    bool mMaintStop;         ///< mark if the maintenance thread must stop
+    pthread_t mMaintThread;  ///< maintenance thread
+    XrdSysCondVar mMaintCond;///< cond. variable used to stop the maintenance thread
+
+    //----------------------------------------------------------------------------
+    //! Get the shard responsible for a hash value
+    //!
+    //! @param hash hash of the lfn
+    //!
+    //! @return shard object
+    //!
+    //----------------------------------------------------------------------------
+    Shard* GetShard( uint64_t hash ) const;
+
+
+    //----------------------------------------------------------------------------
+    //! Get an entry of a shard from its reference
+    //----------------------------------------------------------------------------
+    static Entry* EntryPtr( const Shard* shard, uint32_t ref ) {
+      return reinterpret_cast<Entry*>( shard->mArena.Ptr( ref ) );
+    }
+
+
+    //----------------------------------------------------------------------------
+    //! Take the lock of a shard to change it, making its sequence number odd
+    //----------------------------------------------------------------------------
+    static void LockShard( Shard* shard ) {
+      shard->mMutex.Lock();
+      __sync_fetch_and_add( &shard->mSeq, 1 );
+    }
+
+
+    //----------------------------------------------------------------------------
+    //! Release the lock of a shard, making its sequence number even again
+    //----------------------------------------------------------------------------
+    static void UnlockShard( Shard* shard ) {
+      __sync_fetch_and_add( &shard->mSeq, 1 );
+      shard->mMutex.UnLock();
+    }
+
+
+    //----------------------------------------------------------------------------
+    //! Look up an lfn and copy its pfn into a buffer, without lock if possible
+    //!
+    //! @param lfn logical file name
+    //! @param len length of the logical file name
+    //! @param pfn buffer receiving the null terminated pfn
+    //! @param size size of the buffer
+    //! @param pfnLen length of the pfn, copied only if less than size
+    //!
+    //! @return true if a valid entry was found, otherwise false
+    //!
+    //----------------------------------------------------------------------------
+    bool LookupEntry( const char* lfn, size_t len, char* pfn, size_t size,
+                      size_t& pfnLen );
+
+
+    //----------------------------------------------------------------------------
+    //! Look up an lfn in a shard without taking its lock. Everything read from
+    //! the shard may be changed meanwhile by a writer, it is therefore checked
+    //! before being used to read further and the result is given up if the
+    //! sequence number of the shard changed.
+    //!
+    //! @param shard shard object
+    //! @param hash hash of the lfn
+    //! @param lfn logical file name
+    //! @param len length of the logical file name
+    //! @param now current time
+    //! @param pfn buffer receiving the null terminated pfn
+    //! @param size size of the buffer
+    //! @param pfnLen length of the pfn, copied only if less than size
+    //! @param ref reference of the entry found
+    //!
+    //! @return 1 if a valid entry was found, 0 if not, -1 if a writer changed
+    //!         the shard during the lookup
+    //!
+    //----------------------------------------------------------------------------
+    int PeekEntry( const Shard* shard, uint64_t hash, const char* lfn, size_t len,
+                   time_t now, char* pfn, size_t size, size_t& pfnLen,
+                   uint32_t& ref ) const;
+
+
+    //----------------------------------------------------------------------------
+    //! Count a lookup in the counters of the calling thread
+    //!
+    //! @param found true if a valid entry was found
+    //!
+    //----------------------------------------------------------------------------
+    void CountLookup( bool found );
+
+
+    //----------------------------------------------------------------------------
+    //! Get the set of lookup counters of the calling thread
+    //----------------------------------------------------------------------------
+    Counters* GetCounters();
+
+
+    //----------------------------------------------------------------------------
+    //! Retire memory which the lookups without lock may still read - the
+    //! write lock of the shard it belongs to must be held by the caller
+    //!
+    //! @param slots old array of a hash index, or NULL
+    //! @param chunks old chunk table of an arena, or NULL
+    //!
+    //----------------------------------------------------------------------------
+    void Retire( std::vector<Slot>* slots, char** chunks );
+
+
+    //----------------------------------------------------------------------------
+    //! Retire the chunk tables replaced by the arenas of a shard - the write
+    //! lock of the shard must be held by the caller
+    //!
+    //! @param shard shard object
+    //!
+    //----------------------------------------------------------------------------
+    void RetireChunkTables( Shard* shard );
 
-    MapType  mLfn2Pfn;    ///< map containing the lfn, pfn and iterator to the queue
-    ListType mAgingQueue; ///< list that holds the lfn and the timestap when it was
-                          ///< inserted in the cache ( it is used as a queue )
 
+    //----------------------------------------------------------------------------
+    //! Move to the next epoch if the lookups of the previous one are done and
+    //! free the memory retired at least two epochs ago
+    //----------------------------------------------------------------------------
+    void Reclaim();
+
+
+    //----------------------------------------------------------------------------
+    //! Insert a new entry in cache with a given insertion time
+    //!
+    //! @param lfn logical file name
+    //! @param lfnLen length of the logical file name
+    //! @param pfn physical file name
+    //! @param pfnLen length of the physical file name
+    //! @param insertTime time when the entry was first inserted in the cache
+    //!
+    //----------------------------------------------------------------------------
+    void InsertEntry( const char* lfn, size_t lfnLen,
+                      const char* pfn, size_t pfnLen, time_t insertTime );
+
+
+    //----------------------------------------------------------------------------
+    //! Test if an entry holds a given lfn
+    //!
+    //! @param shard shard object
+    //! @param entry cache entry
+    //! @param lfn logical file name
+    //! @param len length of the logical file name
+    //!
+    //! @return true if the entry is for the lfn, otherwise false
+    //!
+    //----------------------------------------------------------------------------
+    static bool Matches( const Shard* shard, const Entry* entry,
+                         const char* lfn, size_t len );
+
+
+    //----------------------------------------------------------------------------
+    //! Rebuild the pfn of an entry
+    //!
+    //! @param shard shard object
+    //! @param entry cache entry
+    //! @param pfn the physical file name
+    //!
+    //----------------------------------------------------------------------------
+    static void DecodePfn( const Shard* shard, const Entry* entry, std::string& pfn );
+
+
+    //----------------------------------------------------------------------------
+    //! Rebuild the pfn of an entry into a buffer
+    //!
+    //! @param shard shard object
+    //! @param entry cache entry
+    //! @param pfn buffer receiving the null terminated pfn
+    //! @param size size of the buffer
+    //!
+    //! @return length of the pfn, the pfn is written only if it is less than
+    //!         size
+    //!
+    //----------------------------------------------------------------------------
+    static size_t DecodePfn( const Shard* shard, const Entry* entry, char* pfn,
+                             size_t size );
+
+
+    //----------------------------------------------------------------------------
+    //! Test if an entry inserted at the given time is expired
+    //!
+    //! @param insertTime time when the entry was inserted in the cache
+    //! @param now current time
+    //!
+    //! @return true if entry expired, otherwise false
+    //!
+    //----------------------------------------------------------------------------
+    bool IsExpired( time_t insertTime, time_t now ) const;
+
+
+    //----------------------------------------------------------------------------
+    //! Find the slot holding an lfn in the hash index of a shard - the lock of
+    //! the shard must be held by the caller
+    //!
+    //! @param shard shard object
+    //! @param hash hash of the lfn
+    //! @param lfn logical file name
+    //! @param len length of the logical file name
+    //!
+    //! @return index of the slot or -1 if lfn not found
+    //!
+    //----------------------------------------------------------------------------
+    ssize_t FindSlot( const Shard* shard, uint64_t hash,
+                      const char* lfn, size_t len ) const;
+
+
+    //----------------------------------------------------------------------------
+    //! Add an entry to the hash index of a shard, growing the index if needed -
+    //! the write lock of the shard must be held by the caller
+    //!
+    //! @param shard shard object
+    //! @param hash hash of the lfn
+    //! @param ref reference of the entry
+    //!
+    //----------------------------------------------------------------------------
+    void AddSlot( Shard* shard, uint64_t hash, uint32_t ref );
+
+
+    //----------------------------------------------------------------------------
+    //! Remove a slot from the hash index of a shard, shifting back the
+    //! following entries of the probe sequence so that no tombstones are
+    //! needed - the write lock of the shard must be held by the caller
+    //!
+    //! @param shard shard object
+    //! @param pos index of the slot
+    //!
+    //----------------------------------------------------------------------------
+    void RemoveSlot( Shard* shard, size_t pos );
+
+
+    //----------------------------------------------------------------------------
+    //! Record a lookup for the eviction policy in an access buffer of the
+    //! shard - no lock is needed
+    //!
+    //! @param shard shard object
+    //! @param hash hash of the lfn
+    //! @param ref reference of the entry found, 0 if none
+    //!
+    //----------------------------------------------------------------------------
+    void RecordAccess( Shard* shard, uint64_t hash, uint32_t ref );
+
+
+    //----------------------------------------------------------------------------
+    //! Apply a lookup to the entry found and to the sketch - the lock of the
+    //! shard must be held by the caller. The entry may have been dropped since
+    //! it was found, its block is then free or holds another entry and the
+    //! access is only counted if the tag still matches.
+    //!
+    //! @param shard shard object
+    //! @param tag low 32 bits of the hash of the lfn
+    //! @param ref reference of the entry found, 0 if none
+    //!
+    //----------------------------------------------------------------------------
+    void ApplyAccess( Shard* shard, uint32_t tag, uint32_t ref ) {
+      if ( mPolicy == eFifo ) {
+        return;
+      }
+
+      if ( ref ) {
+        Entry* entry = EntryPtr( shard, ref );
+
+        if ( ( entry->mTag == tag ) && ( entry->mFreq < sMaxFreq ) ) {
+          entry->mFreq++;
+        }
+      }
+
+      if ( mPolicy == eTinyLfu ) {
+        shard->mSketch.Increment( tag );
+      }
+    }
+
+
+    //----------------------------------------------------------------------------
+    //! Apply the accesses recorded in the buffers of a shard - the lock of the
+    //! shard must be held by the caller
+    //!
+    //! @param shard shard object
+    //!
+    //----------------------------------------------------------------------------
+    void DrainAccesses( Shard* shard );
+
+
+    //----------------------------------------------------------------------------
+    //! Select the aging queue of a new entry according to the eviction policy -
+    //! the write lock of the shard must be held by the caller
+    //!
+    //! @param shard shard object
+    //! @param hash hash of the lfn of the new entry
+    //!
+    //! @return queue where the new entry goes
+    //!
+    //----------------------------------------------------------------------------
+    QueueId SelectQueue( Shard* shard, uint64_t hash );
+
+
+    //----------------------------------------------------------------------------
+    //! Drop the expired entries found at the heads of the aging queues - the
+    //! write lock of the shard must be held by the caller
+    //!
+    //! @param shard shard object
+    //! @param now current time
+    //! @param maxEntries maximum number of entries dropped
+    //!
+    //! @return number of entries dropped
+    //!
+    //----------------------------------------------------------------------------
+    size_t DropExpired( Shard* shard, time_t now, size_t maxEntries );
+
+
+    //----------------------------------------------------------------------------
+    //! Drop entries until there is room for new ones, according to the
+    //! eviction policy - the write lock of the shard must be held by the caller
+    //!
+    //! @param shard shard object
+    //! @param room number of entries about to be inserted
+    //! @param now current time
+    //! @param maxSteps maximum number of entries dropped or moved between the
+    //!        queues
+    //!
+    //! @return true if there is room, false if maxSteps was reached before
+    //!
+    //----------------------------------------------------------------------------
+    bool MakeRoom( Shard* shard, size_t room, time_t now, size_t maxSteps );
+
+
+    //----------------------------------------------------------------------------
+    //! Select the entry to drop from the main queue, giving a second chance to
+    //! the entries looked up since they were queued - the write lock of the
+    //! shard must be held by the caller
+    //!
+    //! @param shard shard object
+    //! @param now current time
+    //!
+    //! @return reference of the entry, 0 if the main queue is empty
+    //!
+    //----------------------------------------------------------------------------
+    uint32_t SelectVictim( Shard* shard, time_t now );
+
+
+    //----------------------------------------------------------------------------
+    //! Remove an entry to make room, counting it as expired or evicted - the
+    //! write lock of the shard must be held by the caller
+    //!
+    //! @param shard shard object
+    //! @param ref reference of the entry
+    //! @param now current time
+    //!
+    //----------------------------------------------------------------------------
+    void DropEntry( Shard* shard, uint32_t ref, time_t now );
+
+
+    //----------------------------------------------------------------------------
+    //! Append an entry to an aging queue - the write lock of the shard must be
+    //! held by the caller
+    //!
+    //! @param shard shard object
+    //! @param queue queue identifier
+    //! @param ref reference of the entry
+    //!
+    //----------------------------------------------------------------------------
+    void Enqueue( Shard* shard, QueueId queue, uint32_t ref );
+
+
+    //----------------------------------------------------------------------------
+    //! Unlink an entry from its aging queue - the write lock of the shard must
+    //! be held by the caller
+    //!
+    //! @param shard shard object
+    //! @param ref reference of the entry
+    //!
+    //----------------------------------------------------------------------------
+    void Dequeue( Shard* shard, uint32_t ref );
+
+
+    //----------------------------------------------------------------------------
+    //! Remove an entry from the shard and free its memory - the write lock of
+    //! the shard must be held by the caller
+    //!
+    //! @param shard shard object
+    //! @param ref reference of the entry
+    //!
+    //----------------------------------------------------------------------------
+    void RemoveEntry( Shard* shard, uint32_t ref );
+
+
+    //----------------------------------------------------------------------------
+    //! Start function of the maintenance thread
+    //!
+    //! @param arg cache object
+    //!
+    //----------------------------------------------------------------------------
+    static void* StartMaintenanceThread( void* arg );
+
+
+    //----------------------------------------------------------------------------
+    //! Run the maintenance passes until the thread is stopped
+    //----------------------------------------------------------------------------
+    void MaintenanceLoop();
+
+
+    //----------------------------------------------------------------------------
+    //! Expire and evict entries in all the shards, one batch per lock, until
+    //! they are clean or the pass used up its time slice
+    //----------------------------------------------------------------------------
+    void Maintain();
 };
 
 #endif // __EOS_PLUGIN_LFCCACHE_HH__
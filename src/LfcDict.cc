@@ -0,0 +1,190 @@
+//------------------------------------------------------------------------------
+// File: LfcDict.cc
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include <cstring>
+#include <limits>
+/*----------------------------------------------------------------------------*/
+#include "LfcDict.hh"
+#include "LfcHash.hh"
+/*----------------------------------------------------------------------------*/
+
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+LfcDict::LfcDict( LfcArena& arena ):
+  mArena( arena ),
+  mSize( 0 )
+{
+  // empty
+}
+
+
+//------------------------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------------------------
+LfcDict::~LfcDict()
+{
+  // empty - the memory belongs to the arena
+}
+
+
+//------------------------------------------------------------------------------
+// Add a string to the dictionary
+//------------------------------------------------------------------------------
+uint32_t
+LfcDict::Intern( const char* str, size_t len )
+{
+  if ( !len || ( len > std::numeric_limits<uint16_t>::max() ) ) {
+    return 0;
+  }
+
+  uint32_t tag = static_cast<uint32_t>( LfcHash( str, len ) );
+
+  if ( !mSlots.empty() ) {
+    size_t mask = mSlots.size() - 1;
+    size_t pos = tag & mask;
+
+    while ( mSlots[pos].mRef ) {
+      if ( mSlots[pos].mTag == tag ) {
+        Item* item = ItemPtr( mSlots[pos].mRef );
+
+        if ( ( item->mLen == len ) && !memcmp( item->mData, str, len ) ) {
+          item->mRefCount++;
+          return mSlots[pos].mRef;
+        }
+      }
+
+      pos = ( pos + 1 ) & mask;
+    }
+  }
+
+  //............................................................................
+  // New string - keep the index at most half full
+  //............................................................................
+  uint32_t ref = mArena.Alloc( offsetof( Item, mData ) + len );
+
+  if ( !ref ) {
+    return 0;
+  }
+
+  Item* item = ItemPtr( ref );
+  item->mRefCount = 1;
+  item->mTag = tag;
+  item->mLen = len;
+  memcpy( item->mData, str, len );
+
+  if ( 2 * ( mSize + 1 ) > mSlots.size() ) {
+    Grow();
+  }
+
+  size_t mask = mSlots.size() - 1;
+  size_t pos = tag & mask;
+
+  while ( mSlots[pos].mRef ) {
+    pos = ( pos + 1 ) & mask;
+  }
+
+  mSlots[pos].mTag = tag;
+  mSlots[pos].mRef = ref;
+  mSize++;
+  return ref;
+}
+
+
+//------------------------------------------------------------------------------
+// Drop a reference to a string
+//------------------------------------------------------------------------------
+void
+LfcDict::Release( uint32_t ref )
+{
+  if ( !ref ) {
+    return;
+  }
+
+  Item* item = ItemPtr( ref );
+
+  if ( --item->mRefCount ) {
+    return;
+  }
+
+  //............................................................................
+  // Remove from the index, shifting back the following entries of the probe
+  // sequence whose ideal position is not between the hole and their position
+  //............................................................................
+  size_t mask = mSlots.size() - 1;
+  size_t hole = item->mTag & mask;
+
+  while ( mSlots[hole].mRef != ref ) {
+    hole = ( hole + 1 ) & mask;
+  }
+
+  size_t next = ( hole + 1 ) & mask;
+
+  while ( mSlots[next].mRef ) {
+    size_t ideal = mSlots[next].mTag & mask;
+
+    if ( ( ( next - ideal ) & mask ) >= ( ( next - hole ) & mask ) ) {
+      mSlots[hole] = mSlots[next];
+      hole = next;
+    }
+
+    next = ( next + 1 ) & mask;
+  }
+
+  mSlots[hole].mTag = 0;
+  mSlots[hole].mRef = 0;
+  mSize--;
+  mArena.Free( ref, offsetof( Item, mData ) + item->mLen );
+}
+
+
+//------------------------------------------------------------------------------
+// Double the size of the index
+//------------------------------------------------------------------------------
+void
+LfcDict::Grow()
+{
+  size_t num_slots = 2 * mSlots.size();
+
+  if ( num_slots < sMinSlots ) {
+    num_slots = sMinSlots;
+  }
+
+  std::vector<Slot> old_slots( num_slots );
+  old_slots.swap( mSlots );
+  size_t mask = mSlots.size() - 1;
+
+  for ( size_t i = 0; i < old_slots.size(); i++ ) {
+    if ( old_slots[i].mRef ) {
+      size_t pos = old_slots[i].mTag & mask;
+
+      while ( mSlots[pos].mRef ) {
+        pos = ( pos + 1 ) & mask;
+      }
+
+      mSlots[pos] = old_slots[i];
+    }
+  }
+}
@@ -0,0 +1,192 @@
+//------------------------------------------------------------------------------
+// File: LfcDict.hh
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOS_PLUGIN_LFCDICT_HH__
+#define __EOS_PLUGIN_LFCDICT_HH__
+
+/*----------------------------------------------------------------------------*/
+#include <vector>
+/*----------------------------------------------------------------------------*/
+#include <stddef.h>
+#include <stdint.h>
+/*----------------------------------------------------------------------------*/
+#include "LfcArena.hh"
+/*----------------------------------------------------------------------------*/
+
+
+//------------------------------------------------------------------------------
+//! Dictionary of reference counted strings used to store only once the parts
+//! which are common to many cache entries, like the directory of the lfn or the
+//! storage element prefix of the pfn. The strings are kept in an arena given at
+//! construction and are referred to by their arena reference. The dictionary is
+//! not thread safe, the caller must serialize the calls, except for Peek().
+//------------------------------------------------------------------------------
+class LfcDict
+{
+  public:
+
+    //--------------------------------------------------------------------------
+    //! Constructor
+    //!
+    //! @param arena arena used for the strings
+    //!
+    //--------------------------------------------------------------------------
+    LfcDict( LfcArena& arena );
+
+
+    //--------------------------------------------------------------------------
+    //! Destructor
+    //--------------------------------------------------------------------------
+    ~LfcDict();
+
+
+    //--------------------------------------------------------------------------
+    //! Add a string to the dictionary or take a new reference to it if it is
+    //! already there
+    //!
+    //! @param str pointer to the string
+    //! @param len length of the string
+    //!
+    //! @return reference to the string, 0 for an empty string or on failure
+    //!
+    //--------------------------------------------------------------------------
+    uint32_t Intern( const char* str, size_t len );
+
+
+    //--------------------------------------------------------------------------
+    //! Drop a reference to a string, the string is removed from the dictionary
+    //! when no references are left
+    //!
+    //! @param ref reference to the string
+    //!
+    //--------------------------------------------------------------------------
+    void Release( uint32_t ref );
+
+
+    //--------------------------------------------------------------------------
+    //! Get a string from the dictionary
+    //!
+    //! @param ref reference to the string
+    //! @param len length of the string
+    //!
+    //! @return pointer to the string ( not null terminated )
+    //!
+    //--------------------------------------------------------------------------
+    const char* Get( uint32_t ref, size_t& len ) const {
+      if ( !ref ) {
+        len = 0;
+        return "";
+      }
+
+      const Item* item = ItemPtr( ref );
+      len = item->mLen;
+      return item->mData;
+    }
+
+
+    //--------------------------------------------------------------------------
+    //! Get a string from the dictionary without serializing with the other
+    //! calls. The reference may be stale, the string returned is then garbage
+    //! but readable.
+    //!
+    //! @param ref reference to the string
+    //! @param len length of the string
+    //!
+    //! @return pointer to the string ( not null terminated ), NULL if the
+    //!         reference does not point to a readable string
+    //!
+    //--------------------------------------------------------------------------
+    const char* Peek( uint32_t ref, size_t& len ) const {
+      if ( !ref ) {
+        len = 0;
+        return "";
+      }
+
+      size_t avail;
+      const Item* item = reinterpret_cast<const Item*>( mArena.Peek( ref, avail ) );
+
+      if ( !item || ( avail < offsetof( Item, mData ) ) ) {
+        return NULL;
+      }
+
+      len = *const_cast<const volatile uint16_t*>( &item->mLen );
+      return ( ( offsetof( Item, mData ) + len <= avail ) ? item->mData : NULL );
+    }
+
+
+    //--------------------------------------------------------------------------
+    //! Get the number of strings in the dictionary
+    //--------------------------------------------------------------------------
+    size_t GetSize() const {
+      return mSize;
+    }
+
+  private:
+
+    //! Initial number of slots of the index
+    static const size_t sMinSlots = 16;
+
+    //--------------------------------------------------------------------------
+    //! String stored in the arena
+    //--------------------------------------------------------------------------
+    struct Item {
+      uint32_t mRefCount; ///< number of references to the string
+      uint32_t mTag;      ///< low 32 bits of the hash of the string
+      uint16_t mLen;      ///< length of the string
+      char mData[2];      ///< the string ( not null terminated )
+    };
+
+    //--------------------------------------------------------------------------
+    //! Slot of the index, an empty slot has a null reference
+    //--------------------------------------------------------------------------
+    struct Slot {
+      uint32_t mTag;  ///< low 32 bits of the hash of the string
+      uint32_t mRef;  ///< reference of the item in the arena
+    };
+
+    LfcArena& mArena;         ///< arena holding the strings
+    std::vector<Slot> mSlots; ///< open-addressing index, the size is a power of 2
+    size_t mSize;             ///< number of strings in the dictionary
+
+    //--------------------------------------------------------------------------
+    //! Get an item from its reference
+    //--------------------------------------------------------------------------
+    Item* ItemPtr( uint32_t ref ) const {
+      return reinterpret_cast<Item*>( mArena.Ptr( ref ) );
+    }
+
+
+    //--------------------------------------------------------------------------
+    //! Double the size of the index
+    //--------------------------------------------------------------------------
+    void Grow();
+
+
+    //--------------------------------------------------------------------------
+    //! Disable copying
+    //--------------------------------------------------------------------------
+    LfcDict( const LfcDict& );
+    LfcDict& operator=( const LfcDict& );
+};
+
+#endif // __EOS_PLUGIN_LFCDICT_HH__
@@ -0,0 +1,88 @@
+//------------------------------------------------------------------------------
+// File: LfcHash.hh
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOS_PLUGIN_LFCHASH_HH__
+#define __EOS_PLUGIN_LFCHASH_HH__
+
+/*----------------------------------------------------------------------------*/
+#include <cstring>
+/*----------------------------------------------------------------------------*/
+#include <stddef.h>
+#include <stdint.h>
+/*----------------------------------------------------------------------------*/
+
+
+//------------------------------------------------------------------------------
+//! Compute the 64-bit hash of a string ( MurmurHash64A )
+//!
+//! @param data pointer to the string
+//! @param len length of the string
+//!
+//! @return hash value
+//!
+//------------------------------------------------------------------------------
+inline uint64_t
+LfcHash( const char* data, size_t len )
+{
+  const uint64_t m = 0xc6a4a7935bd1e995ULL;
+  const int r = 47;
+  uint64_t hash = 0x8445d61a4e774912ULL ^ ( len * m );
+  const char* end = data + ( len & ~static_cast<size_t>( 7 ) );
+  uint64_t k;
+
+  //............................................................................
+  // Consume the string eight bytes at a time
+  //............................................................................
+  for ( ; data != end; data += 8 ) {
+    memcpy( &k, data, sizeof( k ) );
+    k *= m;
+    k ^= k >> r;
+    k *= m;
+    hash ^= k;
+    hash *= m;
+  }
+
+  //............................................................................
+  // Remaining bytes
+  //............................................................................
+  k = 0;
+
+  switch ( len & 7 ) {
+    case 7: k ^= static_cast<uint64_t>( static_cast<unsigned char>( data[6] ) ) << 48;
+    case 6: k ^= static_cast<uint64_t>( static_cast<unsigned char>( data[5] ) ) << 40;
+    case 5: k ^= static_cast<uint64_t>( static_cast<unsigned char>( data[4] ) ) << 32;
+    case 4: k ^= static_cast<uint64_t>( static_cast<unsigned char>( data[3] ) ) << 24;
+    case 3: k ^= static_cast<uint64_t>( static_cast<unsigned char>( data[2] ) ) << 16;
+    case 2: k ^= static_cast<uint64_t>( static_cast<unsigned char>( data[1] ) ) << 8;
+    case 1: k ^= static_cast<uint64_t>( static_cast<unsigned char>( data[0] ) );
+      hash ^= k;
+      hash *= m;
+  }
+
+  hash ^= hash >> r;
+  hash *= m;
+  hash ^= hash >> r;
+  return hash;
+}
+
+#endif // __EOS_PLUGIN_LFCHASH_HH__
@@ -0,0 +1,108 @@
+//------------------------------------------------------------------------------
+// File: LfcLog.hh
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOS_PLUGIN_LFCLOG_HH__
+#define __EOS_PLUGIN_LFCLOG_HH__
+
+/*----------------------------------------------------------------------------*/
+#include <cstdio>
+/*----------------------------------------------------------------------------*/
+#include "XrdSys/XrdSysError.hh"
+/*----------------------------------------------------------------------------*/
+
+class LfcLogQueue;
+
+namespace XrdCms {
+  extern XrdSysError LfcError;
+  extern LfcLogQueue* LfcLogger;  ///< queue of the messages, NULL if synchronous
+};
+
+//! Mask of the messages logged from LFCDEBUG=1 on
+#define LFC_LOG_DEBUG SYS_LOG_01
+
+//! Mask of the messages logged only with LFCDEBUG=2
+#define LFC_LOG_TRACE SYS_LOG_02
+
+//! Maximum length of a message formatted without the queue
+#define LFC_LOG_MSGLEN 4096
+
+
+//------------------------------------------------------------------------------
+//! Format a message and append it to the log queue, or write it to the logger
+//! straight away if the queue is not running
+//!
+//! @param epname name of the calling function, a string literal
+//! @param format printf like format
+//!
+//------------------------------------------------------------------------------
+void LfcLogWrite( const char* epname, const char* format, ... )
+__attribute__( ( format( printf, 2, 3 ) ) );
+
+
+//------------------------------------------------------------------------------
+//! Format a message and log it, the arguments are not evaluated and nothing
+//! is formatted unless the mask is enabled by the LFCDEBUG level
+//!
+//! @param mask LFC_LOG_DEBUG or LFC_LOG_TRACE
+//! @param epname name of the calling function
+//! @param ... printf like format and arguments
+//!
+//------------------------------------------------------------------------------
+#define LFC_LOG( mask, epname, ... )                                      \
+  do {                                                                    \
+    if ( XrdCms::LfcError.getMsgMask() & ( mask ) ) {                     \
+      LfcLogWrite( ( epname ), __VA_ARGS__ );                             \
+    }                                                                     \
+  } while ( 0 )
+
+#define LFC_DEBUG( epname, ... ) LFC_LOG( LFC_LOG_DEBUG, epname, __VA_ARGS__ )
+#define LFC_TRACE( epname, ... ) LFC_LOG( LFC_LOG_TRACE, epname, __VA_ARGS__ )
+
+
+//------------------------------------------------------------------------------
+//! Format a message and log it whatever the LFCDEBUG level
+//!
+//! @param epname name of the calling function
+//! @param ... printf like format and arguments
+//!
+//------------------------------------------------------------------------------
+#define LFC_EMSG( epname, ... ) LfcLogWrite( ( epname ), __VA_ARGS__ )
+
+
+//------------------------------------------------------------------------------
+//! Get the message mask for an LFCDEBUG level, each level also logs the
+//! messages of the levels below it
+//!
+//! @param level 0 (no debug), 1 (debug) or 2 (full debug)
+//!
+//! @return message mask to set in the error object
+//!
+//------------------------------------------------------------------------------
+inline int
+LfcLogMask( int level )
+{
+  return ( ( level >= 1 ) ? LFC_LOG_DEBUG : 0 ) |
+         ( ( level >= 2 ) ? LFC_LOG_TRACE : 0 );
+}
+
+#endif // __EOS_PLUGIN_LFCLOG_HH__
@@ -0,0 +1,246 @@
+//------------------------------------------------------------------------------
+// File: LfcLogQueue.cc
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include <cerrno>
+#include <cstdio>
+/*----------------------------------------------------------------------------*/
+#include "LfcLogQueue.hh"
+/*----------------------------------------------------------------------------*/
+#include "XrdSys/XrdSysError.hh"
+/*----------------------------------------------------------------------------*/
+
+const size_t LfcLogQueue::sRecordLen;
+
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+LfcLogQueue::LfcLogQueue( XrdSysError& error, size_t numRecords ):
+  mError( error ),
+  mHead( 0 ),
+  mTail( 0 ),
+  mNumDropped( 0 ),
+  mNumReported( 0 ),
+  mRunning( false ),
+  mStop( false ),
+  mCond( 0 )
+{
+  uint64_t size = 2;
+
+  while ( size < numRecords ) {
+    size <<= 1;
+  }
+
+  mMask = size - 1;
+  mRecords = new Record[size];
+
+  for ( uint64_t i = 0; i < size; i++ ) {
+    mRecords[i].mSeq = i;
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------------------------
+LfcLogQueue::~LfcLogQueue()
+{
+  Stop();
+  delete[] mRecords;
+}
+
+
+//------------------------------------------------------------------------------
+// Start the writer thread
+//------------------------------------------------------------------------------
+int
+LfcLogQueue::Start()
+{
+  if ( XrdSysThread::Run( &mThread, LfcLogQueue::StartWriter,
+                          static_cast<void*>( this ), XRDSYSTHREAD_HOLD,
+                          "LFC log writer" ) )
+  {
+    return ( errno ? -errno : -EAGAIN );
+  }
+
+  mRunning = true;
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+// Write all the records appended so far and stop the writer thread
+//------------------------------------------------------------------------------
+void
+LfcLogQueue::Stop()
+{
+  if ( !mRunning ) {
+    Drain();
+    return;
+  }
+
+  mCond.Lock();
+  mStop = true;
+  mCond.Signal();
+  mCond.UnLock();
+  XrdSysThread::Join( mThread, NULL );
+  mRunning = false;
+}
+
+
+//------------------------------------------------------------------------------
+// Format a record and append it to the queue
+//------------------------------------------------------------------------------
+bool
+LfcLogQueue::Append( const char* epname, const char* format, va_list args )
+{
+  uint64_t pos = mHead;
+  Record* rec;
+
+  //............................................................................
+  // Take the slot at the head, unless another producer took it meanwhile or
+  // the writer did not free it yet because the ring is full
+  //............................................................................
+  while ( true ) {
+    rec = &mRecords[pos & mMask];
+    int64_t diff = static_cast<int64_t>( rec->mSeq - pos );
+
+    if ( diff == 0 ) {
+      if ( __sync_bool_compare_and_swap( &mHead, pos, pos + 1 ) ) {
+        break;
+      }
+
+      pos = mHead;
+    } else if ( diff < 0 ) {
+      __sync_fetch_and_add( &mNumDropped, 1 );
+      return false;
+    } else {
+      pos = mHead;
+    }
+  }
+
+  rec->mEpname = epname;
+  vsnprintf( rec->mText, sizeof( rec->mText ), format, args );
+
+  //............................................................................
+  // Publish the record once its text is complete
+  //............................................................................
+  __sync_synchronize();
+  rec->mSeq = pos + 1;
+
+  //............................................................................
+  // Wake up the writer every half ring rather than let it find the ring full
+  // after its poll interval, the signal is sent without the lock as a missed
+  // one only delays the writer until the end of its poll interval
+  //............................................................................
+  if ( !( ( pos + 1 ) & ( mMask >> 1 ) ) ) {
+    mCond.Signal();
+  }
+
+  return true;
+}
+
+
+//------------------------------------------------------------------------------
+// Start function of the writer thread
+//------------------------------------------------------------------------------
+void*
+LfcLogQueue::StartWriter( void* arg )
+{
+  LfcLogQueue* queue = static_cast<LfcLogQueue*>( arg );
+  queue->Writer();
+  return NULL;
+}
+
+
+//------------------------------------------------------------------------------
+// Write the records to the logger until the queue is stopped
+//------------------------------------------------------------------------------
+void
+LfcLogQueue::Writer()
+{
+  mCond.Lock();
+
+  while ( true ) {
+    mCond.UnLock();
+    size_t written = Drain();
+    mCond.Lock();
+
+    //..........................................................................
+    // Once stopped keep writing until the queue is found empty
+    //..........................................................................
+    if ( !written ) {
+      if ( mStop ) {
+        break;
+      }
+
+      mCond.WaitMS( sPollInterval );
+    }
+  }
+
+  mCond.UnLock();
+}
+
+
+//------------------------------------------------------------------------------
+// Write the ready records to the logger and report the dropped ones
+//------------------------------------------------------------------------------
+size_t
+LfcLogQueue::Drain()
+{
+  size_t written = 0;
+
+  while ( true ) {
+    Record* rec = &mRecords[mTail & mMask];
+
+    if ( rec->mSeq != mTail + 1 ) {
+      break;
+    }
+
+    __sync_synchronize();
+    mError.Emsg( rec->mEpname, rec->mText );
+
+    //..........................................................................
+    // Free the slot for the producer going round the ring
+    //..........................................................................
+    __sync_synchronize();
+    rec->mSeq = mTail + mMask + 1;
+    mTail++;
+    written++;
+  }
+
+  uint64_t dropped = GetNumDropped();
+
+  if ( dropped != mNumReported ) {
+    char msg[128];
+    snprintf( msg, sizeof( msg ), "Log queue full, dropped %llu records, "
+              "total_dropped=%llu",
+              static_cast<unsigned long long>( dropped - mNumReported ),
+              static_cast<unsigned long long>( dropped ) );
+    mError.Emsg( "LogQueue", msg );
+    mNumReported = dropped;
+  }
+
+  return written;
+}
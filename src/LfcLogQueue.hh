@@ -0,0 +1,164 @@
+//------------------------------------------------------------------------------
+// File: LfcLogQueue.hh
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOS_PLUGIN_LFCLOGQUEUE_HH__
+#define __EOS_PLUGIN_LFCLOGQUEUE_HH__
+
+/*----------------------------------------------------------------------------*/
+#include <XrdSys/XrdSysPthread.hh>
+/*----------------------------------------------------------------------------*/
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+/*----------------------------------------------------------------------------*/
+
+class XrdSysError;
+
+
+//------------------------------------------------------------------------------
+//! Bounded queue of log records written to the XRootD logger by a background
+//! thread, so that the threads serving requests never wait for the logger
+//! mutex or for the disk. Any number of threads append records and one thread
+//! drains them: the queue is a ring of fixed size records, each one with a
+//! sequence number telling whether it is free or ready, and a record is taken
+//! by a producer with a compare-and-swap on the head, so that appending takes
+//! no lock. The records are formatted directly in the ring.
+//!
+//! When the ring is full the record is dropped and counted, the writer thread
+//! reports the number of records lost. Stopping the queue writes all the
+//! records appended so far.
+//------------------------------------------------------------------------------
+class LfcLogQueue
+{
+  public:
+
+    //! Maximum length of a record, longer messages are truncated
+    static const size_t sRecordLen = 1024;
+
+    //! Time in ms the writer thread sleeps when the queue is empty
+    static const int sPollInterval = 20;
+
+    //--------------------------------------------------------------------------
+    //! Constructor
+    //!
+    //! @param error error object the records are written to
+    //! @param numRecords size of the ring, rounded up to a power of two
+    //!
+    //--------------------------------------------------------------------------
+    LfcLogQueue( XrdSysError& error, size_t numRecords );
+
+
+    //--------------------------------------------------------------------------
+    //! Destructor - stops the writer thread after writing all the records
+    //--------------------------------------------------------------------------
+    ~LfcLogQueue();
+
+
+    //--------------------------------------------------------------------------
+    //! Start the writer thread
+    //!
+    //! @return 0 if successful, otherwise -errno
+    //!
+    //--------------------------------------------------------------------------
+    int Start();
+
+
+    //--------------------------------------------------------------------------
+    //! Write all the records appended so far and stop the writer thread
+    //--------------------------------------------------------------------------
+    void Stop();
+
+
+    //--------------------------------------------------------------------------
+    //! Format a record and append it to the queue
+    //!
+    //! @param epname name of the calling function, must be a string literal or
+    //!        live as long as the queue as only the pointer is kept
+    //! @param format printf like format
+    //! @param args format arguments
+    //!
+    //! @return true if appended, false if dropped because the queue is full
+    //!
+    //--------------------------------------------------------------------------
+    bool Append( const char* epname, const char* format, va_list args );
+
+
+    //--------------------------------------------------------------------------
+    //! Get the number of records dropped because the queue was full
+    //--------------------------------------------------------------------------
+    uint64_t GetNumDropped() const {
+      return __sync_fetch_and_add( const_cast<uint64_t*>( &mNumDropped ), 0 );
+    }
+
+  private:
+
+    //--------------------------------------------------------------------------
+    //! Slot of the ring, free for position p when mSeq == p and ready to be
+    //! written to the logger when mSeq == p + 1
+    //--------------------------------------------------------------------------
+    struct Record {
+      volatile uint64_t mSeq;   ///< sequence number of the slot
+      const char* mEpname;      ///< name of the function which logged
+      char mText[sRecordLen];   ///< formatted message
+    };
+
+    XrdSysError& mError;        ///< error object the records are written to
+    Record* mRecords;           ///< ring of records
+    uint64_t mMask;             ///< size of the ring minus one
+    char mPad1[64];             ///< keep the head on its own cache line
+    volatile uint64_t mHead;    ///< next position taken by a producer
+    char mPad2[64];             ///< keep the writer state off the head line
+    uint64_t mTail;             ///< next position written by the writer thread
+    uint64_t mNumDropped;       ///< number of records dropped
+    uint64_t mNumReported;      ///< number of dropped records already reported
+    pthread_t mThread;          ///< writer thread
+    bool mRunning;              ///< mark if the writer thread is running
+    bool mStop;                 ///< mark if the writer thread must stop
+    XrdSysCondVar mCond;        ///< cond. variable to wake up the writer
+
+
+    //--------------------------------------------------------------------------
+    //! Start function of the writer thread
+    //!
+    //! @param arg queue object
+    //!
+    //--------------------------------------------------------------------------
+    static void* StartWriter( void* arg );
+
+
+    //--------------------------------------------------------------------------
+    //! Write the records to the logger until the queue is stopped
+    //--------------------------------------------------------------------------
+    void Writer();
+
+
+    //--------------------------------------------------------------------------
+    //! Write the ready records to the logger and report the dropped ones
+    //!
+    //! @return number of records written
+    //!
+    //--------------------------------------------------------------------------
+    size_t Drain();
+};
+
+#endif // __EOS_PLUGIN_LFCLOGQUEUE_HH__
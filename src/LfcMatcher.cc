@@ -0,0 +1,257 @@
+//------------------------------------------------------------------------------
+// File: LfcMatcher.cc
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include <cstring>
+#include <deque>
+/*----------------------------------------------------------------------------*/
+#include "LfcMatcher.hh"
+/*----------------------------------------------------------------------------*/
+
+const uint32_t LfcMatcher::sNone;
+
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+LfcMatcher::LfcMatcher():
+  mNumClasses( 1 ),
+  mWidth( 2 ),
+  mMaxLen( 1 ),
+  mAnyForbidden( false )
+{
+  memset( mClass, 0, sizeof( mClass ) );
+  mTable.assign( mWidth, 0 );
+  mTable[1] = sNone;
+}
+
+
+//------------------------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------------------------
+LfcMatcher::~LfcMatcher()
+{
+  // empty
+}
+
+
+//------------------------------------------------------------------------------
+// Compile the patterns
+//------------------------------------------------------------------------------
+void
+LfcMatcher::Build( const VectStrings& match, const VectStrings& notMatch )
+{
+  std::vector<std::string> patterns;
+  mMatch.assign( match.begin(), match.end() );
+  patterns.insert( patterns.end(), notMatch.begin(), notMatch.end() );
+  patterns.insert( patterns.end(), match.begin(), match.end() );
+  mAnyForbidden = !notMatch.empty();
+  mMaxLen = 1;
+
+  for ( size_t i = 0; i < patterns.size(); i++ ) {
+    if ( patterns[i].length() > mMaxLen ) {
+      mMaxLen = patterns[i].length();
+    }
+  }
+
+  //............................................................................
+  // The bytes not used by any pattern share column 0, this keeps the table
+  // small as the patterns use only a fraction of the alphabet
+  //............................................................................
+  memset( mClass, 0, sizeof( mClass ) );
+  mNumClasses = 1;
+
+  for ( size_t i = 0; i < patterns.size(); i++ ) {
+    for ( size_t j = 0; j < patterns[i].length(); j++ ) {
+      unsigned char c = patterns[i][j];
+
+      if ( !mClass[c] ) {
+        mClass[c] = mNumClasses++;
+      }
+    }
+  }
+
+  //............................................................................
+  // Build the trie of the patterns, 0 in the table means no child as the root
+  // is never a child
+  //............................................................................
+  std::vector<uint32_t> next( mNumClasses, 0 );
+  std::vector<uint32_t> best( 1, sNone );
+  std::vector<char> forbidden( 1, 0 );
+
+  for ( size_t i = 0; i < patterns.size(); i++ ) {
+    uint32_t state = 0;
+
+    for ( size_t j = 0; j < patterns[i].length(); j++ ) {
+      uint32_t col = mClass[static_cast<unsigned char>( patterns[i][j] )];
+
+      if ( !next[state * mNumClasses + col] ) {
+        next[state * mNumClasses + col] = best.size();
+        next.resize( next.size() + mNumClasses, 0 );
+        best.push_back( sNone );
+        forbidden.push_back( 0 );
+      }
+
+      state = next[state * mNumClasses + col];
+    }
+
+    if ( i < notMatch.size() ) {
+      forbidden[state] = 1;
+    } else if ( best[state] == sNone ) {
+      best[state] = i - notMatch.size();
+    }
+  }
+
+  //............................................................................
+  // Breadth first pass turning the trie into a complete automaton: missing
+  // transitions follow the failure link and every state inherits the outputs
+  // of its failure state, i.e. of its longest proper suffix in the trie
+  //............................................................................
+  std::vector<uint32_t> fail( best.size(), 0 );
+  std::deque<uint32_t> queue;
+
+  for ( uint32_t col = 0; col < mNumClasses; col++ ) {
+    if ( next[col] ) {
+      queue.push_back( next[col] );
+    }
+  }
+
+  while ( !queue.empty() ) {
+    uint32_t state = queue.front();
+    queue.pop_front();
+    uint32_t link = fail[state];
+    forbidden[state] |= forbidden[link];
+
+    if ( best[link] < best[state] ) {
+      best[state] = best[link];
+    }
+
+    for ( uint32_t col = 0; col < mNumClasses; col++ ) {
+      uint32_t& child = next[state * mNumClasses + col];
+
+      if ( child ) {
+        fail[child] = next[link * mNumClasses + col];
+        queue.push_back( child );
+      } else {
+        child = next[link * mNumClasses + col];
+      }
+    }
+  }
+
+  //............................................................................
+  // Final table: the transitions hold the offset of the target row and the
+  // last column of a row holds the output of the state, 0 if a forbidden
+  // pattern ends there, the index of the first required one plus 1 otherwise.
+  // A single comparison per byte then catches both kinds of patterns.
+  //............................................................................
+  mWidth = mNumClasses + 1;
+  mTable.assign( best.size() * mWidth, 0 );
+
+  for ( uint32_t state = 0; state < best.size(); state++ ) {
+    for ( uint32_t col = 0; col < mNumClasses; col++ ) {
+      mTable[state * mWidth + col] = next[state * mNumClasses + col] * mWidth;
+    }
+
+    mTable[state * mWidth + mNumClasses] =
+      forbidden[state] ? 0 : ( ( best[state] == sNone ) ? sNone : best[state] + 1 );
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Scan a string
+//------------------------------------------------------------------------------
+LfcMatcher::Result
+LfcMatcher::Scan( const char* text, const char*& matching ) const
+{
+  matching = "";
+
+  if ( mMatch.empty() && !mAnyForbidden ) {
+    return eMatch;
+  }
+
+  //............................................................................
+  // Each byte costs a table load which depends on the previous one, so the
+  // text is split in two halves scanned at the same time to overlap the
+  // loads. The second half starts early enough for a pattern crossing the
+  // middle to be found. Empty patterns end in the root and match any text
+  // like with strstr.
+  //............................................................................
+  const uint32_t* table = &mTable[0];
+  const uint32_t out_col = mWidth - 1;
+  const unsigned char* ptr1 = reinterpret_cast<const unsigned char*>( text );
+  const unsigned char* end2 = ptr1 + strlen( text );
+  const unsigned char* end1 = ptr1;
+  const unsigned char* ptr2 = ptr1;
+  uint32_t row1 = 0;
+  uint32_t row2 = 0;
+  uint32_t best = table[out_col];
+
+  if ( static_cast<size_t>( end2 - ptr1 ) > 2 * mMaxLen ) {
+    end1 = ptr1 + ( end2 - ptr1 ) / 2;
+    ptr2 = end1 - ( mMaxLen - 1 );
+
+    for ( ; best && ( ptr1 < end1 ); ptr1++, ptr2++ ) {
+      row1 = table[row1 + mClass[*ptr1]];
+      row2 = table[row2 + mClass[*ptr2]];
+      uint32_t out1 = table[row1 + out_col];
+      uint32_t out2 = table[row2 + out_col];
+      best = ( out1 < best ) ? out1 : best;
+      best = ( out2 < best ) ? out2 : best;
+    }
+  }
+
+  //............................................................................
+  // The rest of the second half, or the whole text if it is short
+  //............................................................................
+  for ( ; best && ( ptr2 < end2 ); ptr2++ ) {
+    row2 = table[row2 + mClass[*ptr2]];
+    uint32_t out = table[row2 + out_col];
+
+    if ( out < best ) {
+      best = out;
+
+      //........................................................................
+      // Nothing can change the outcome any more
+      //........................................................................
+      if ( ( best == 1 ) && !mAnyForbidden ) {
+        break;
+      }
+    }
+  }
+
+  if ( !best ) {
+    return eForbidden;
+  }
+
+  if ( mMatch.empty() ) {
+    return eMatch;
+  }
+
+  if ( best == sNone ) {
+    return eNoMatch;
+  }
+
+  matching = mMatch[best - 1].c_str();
+  return eMatch;
+}
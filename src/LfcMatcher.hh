@@ -0,0 +1,115 @@
+//------------------------------------------------------------------------------
+// File: LfcMatcher.hh
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOS_PLUGIN_LFCMATCHER_HH__
+#define __EOS_PLUGIN_LFCMATCHER_HH__
+
+/*----------------------------------------------------------------------------*/
+#include <string>
+#include <vector>
+/*----------------------------------------------------------------------------*/
+#include <stdint.h>
+/*----------------------------------------------------------------------------*/
+#include "LfcString.hh"
+/*----------------------------------------------------------------------------*/
+
+
+//------------------------------------------------------------------------------
+//! Multi-pattern substring matcher used to filter the replicas against the
+//! match and nomatch lists. All the patterns are compiled in one Aho-Corasick
+//! automaton so that a single pass over the replica decides if it contains a
+//! forbidden pattern and which of the required ones it contains. The result is
+//! the same as testing the nomatch patterns and then the match patterns in
+//! order with strstr. The matcher is read only after Build, so it can be used
+//! by many threads at the same time.
+//------------------------------------------------------------------------------
+class LfcMatcher
+{
+  public:
+
+    //--------------------------------------------------------------------------
+    //! Outcome of a scan
+    //--------------------------------------------------------------------------
+    enum Result {
+      eNoMatch = 0, ///< no required pattern found
+      eMatch,       ///< a required pattern was found, or none is required
+      eForbidden    ///< a forbidden pattern was found
+    };
+
+
+    //--------------------------------------------------------------------------
+    //! Constructor
+    //--------------------------------------------------------------------------
+    LfcMatcher();
+
+
+    //--------------------------------------------------------------------------
+    //! Destructor
+    //--------------------------------------------------------------------------
+    ~LfcMatcher();
+
+
+    //--------------------------------------------------------------------------
+    //! Compile the patterns, replacing the previous ones
+    //!
+    //! @param match required patterns, any of them is enough
+    //! @param notMatch forbidden patterns
+    //!
+    //--------------------------------------------------------------------------
+    void Build( const VectStrings& match, const VectStrings& notMatch );
+
+
+    //--------------------------------------------------------------------------
+    //! Scan a string
+    //!
+    //! @param text null terminated string to scan
+    //! @param matching set to the first required pattern, in the order given
+    //!        to Build, found in the text or to "" if none is required
+    //!
+    //! @return outcome of the scan
+    //!
+    //--------------------------------------------------------------------------
+    Result Scan( const char* text, const char*& matching ) const;
+
+  private:
+
+    //! No pattern ends in a state
+    static const uint32_t sNone = 0xffffffff;
+
+    std::vector<std::string> mMatch; ///< required patterns
+    unsigned char mClass[256];       ///< byte to column of the transition table
+    uint32_t mNumClasses;            ///< number of columns of the transition table
+    uint32_t mWidth;                 ///< width of a row of the table
+    std::vector<uint32_t> mTable;    ///< one row per state with the offsets of
+                                     ///< the next rows and the output of the state
+    size_t mMaxLen;                  ///< length of the longest pattern, at least 1
+    bool mAnyForbidden;              ///< if there are forbidden patterns
+
+    //--------------------------------------------------------------------------
+    //! Disable copying
+    //--------------------------------------------------------------------------
+    LfcMatcher( const LfcMatcher& );
+    LfcMatcher& operator=( const LfcMatcher& );
+};
+
+#endif // __EOS_PLUGIN_LFCMATCHER_HH__
@@ -0,0 +1,76 @@
+//------------------------------------------------------------------------------
+// File: LfcRewrite.cc
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include <cstring>
+/*----------------------------------------------------------------------------*/
+#include "LfcRewrite.hh"
+/*----------------------------------------------------------------------------*/
+
+
+//------------------------------------------------------------------------------
+// Compensate for varying conventions for LFC path
+//------------------------------------------------------------------------------
+VectStrings
+LfcRewriteLfn( const LfcString& lfn )
+{
+  VectStrings ret;
+  ret.reserve( 3 );
+  ret.push_back( lfn );                         // 0) Unmodified LFC path
+
+  if ( !lfn.StartsWith( "/grid" ) ) {           // 1) Try adding /grid prefix
+    ret.push_back( LfcString() );
+    ret.back().reserve( 5 + lfn.length() );
+    ret.back().append( "/grid" ).append( lfn );
+  }
+
+  //............................................................................
+  // The path components are looked at in place, only the rewritten path is
+  // built and in a buffer on the stack
+  //............................................................................
+  LfcTokenizer tokens( lfn, "/" );
+  LfcStringView first;
+  LfcStringView second;
+
+  if ( tokens.Next( first ) && first.Equals( "atlas" ) ) {
+    LfcTokenizer rest = tokens;
+
+    if ( tokens.Next( second ) && tokens.HasNext() &&
+         !second.Equals( "dq2" ) ) {            // 2) /atlas/!dq2 -> /grid/atlas/dq2
+      static const char prefix[] = "/grid/atlas/dq2";
+      char rebuild_path[LFC_REWRITE_MAXLEN];
+      memcpy( rebuild_path, prefix, sizeof( prefix ) );
+      size_t len = LfcString::Join( rest, "/", rebuild_path + sizeof( prefix ) - 1,
+                                    sizeof( rebuild_path ) - sizeof( prefix ) + 1 );
+
+      if ( len < sizeof( rebuild_path ) - sizeof( prefix ) + 1 ) {
+        ret.push_back( LfcString( rebuild_path ) );
+      }
+    }
+
+    //else if (components[1] != "pathena") {   // 3) /atlas/!pathena -> /grid/atlas/pathena
+    // 4) etc..
+  }
+
+  return ret;
+}
@@ -0,0 +1,47 @@
+//------------------------------------------------------------------------------
+// File: LfcRewrite.hh
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOS_PLUGIN_LFCREWRITE_HH__
+#define __EOS_PLUGIN_LFCREWRITE_HH__
+
+/*----------------------------------------------------------------------------*/
+#include "LfcString.hh"
+/*----------------------------------------------------------------------------*/
+
+//! Longest lfn built by LfcRewriteLfn, including the terminating null
+#define LFC_REWRITE_MAXLEN 4096
+
+
+//------------------------------------------------------------------------------
+//! Compensate for the various conventions for the LFC path: besides the lfn
+//! itself, try it under /grid and, for /atlas paths outside dq2, under
+//! /grid/atlas/dq2
+//!
+//! @param lfn logical file name
+//!
+//! @return the paths to look up in the LFC, in order
+//!
+//------------------------------------------------------------------------------
+VectStrings LfcRewriteLfn( const LfcString& lfn );
+
+#endif // __EOS_PLUGIN_LFCREWRITE_HH__
@@ -0,0 +1,132 @@
+//------------------------------------------------------------------------------
+// File: LfcSearcher.cc
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include <cstring>
+/*----------------------------------------------------------------------------*/
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+/*----------------------------------------------------------------------------*/
+#include "LfcSearcher.hh"
+/*----------------------------------------------------------------------------*/
+
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+LfcSearcher::LfcSearcher()
+{
+  // empty
+}
+
+
+//------------------------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------------------------
+LfcSearcher::~LfcSearcher()
+{
+  // empty
+}
+
+
+//------------------------------------------------------------------------------
+// Set the pattern to look for
+//------------------------------------------------------------------------------
+void
+LfcSearcher::Set( const std::string& pattern )
+{
+  mPattern = pattern;
+}
+
+
+//------------------------------------------------------------------------------
+// Find the first occurrence of the pattern
+//------------------------------------------------------------------------------
+const char*
+LfcSearcher::Find( const char* text, size_t len ) const
+{
+  const size_t pat_len = mPattern.length();
+  const char* pat = mPattern.c_str();
+  size_t pos = 0;
+
+  if ( !pat_len ) {
+    return text;
+  }
+
+  if ( pat_len > len ) {
+    return NULL;
+  }
+
+#ifdef __SSE2__
+  //............................................................................
+  // Compare 16 positions at a time against the first and the last byte of the
+  // pattern, only the positions where both match are compared in full. Only
+  // whole blocks inside the text are loaded, the rest is done by the scalar
+  // loop.
+  //............................................................................
+  const __m128i first = _mm_set1_epi8( pat[0] );
+  const __m128i last = _mm_set1_epi8( pat[pat_len - 1] );
+
+  while ( pos + pat_len - 1 + sBlockSize <= len ) {
+    __m128i head = _mm_loadu_si128( reinterpret_cast<const __m128i*>( text + pos ) );
+    __m128i tail = _mm_loadu_si128( reinterpret_cast<const __m128i*>( text + pos +
+                                    pat_len - 1 ) );
+    unsigned int mask = _mm_movemask_epi8( _mm_and_si128( _mm_cmpeq_epi8( head, first ),
+                                           _mm_cmpeq_epi8( tail, last ) ) );
+
+    while ( mask ) {
+      size_t offset = pos + __builtin_ctz( mask );
+
+      if ( !memcmp( text + offset + 1, pat + 1, ( pat_len > 2 ) ? pat_len - 2 : 0 ) ) {
+        return text + offset;
+      }
+
+      mask &= mask - 1;
+    }
+
+    pos += sBlockSize;
+  }
+
+#endif
+
+  //............................................................................
+  // Scalar search: look for the first byte and compare the rest
+  //............................................................................
+  while ( pos + pat_len <= len ) {
+    const char* ptr = static_cast<const char*>( memchr( text + pos, pat[0],
+                                                        len - pat_len + 1 - pos ) );
+
+    if ( !ptr ) {
+      return NULL;
+    }
+
+    if ( !memcmp( ptr + 1, pat + 1, pat_len - 1 ) ) {
+      return ptr;
+    }
+
+    pos = ptr - text + 1;
+  }
+
+  return NULL;
+}
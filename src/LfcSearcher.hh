@@ -0,0 +1,107 @@
+//------------------------------------------------------------------------------
+// File: LfcSearcher.hh
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOS_PLUGIN_LFCSEARCHER_HH__
+#define __EOS_PLUGIN_LFCSEARCHER_HH__
+
+/*----------------------------------------------------------------------------*/
+#include <cstring>
+#include <string>
+/*----------------------------------------------------------------------------*/
+
+
+//------------------------------------------------------------------------------
+//! Substring search for a pattern known in advance, like the storage root
+//! which is looked for in every lfn and replica. The search checks 16
+//! positions at a time with SSE vector compares of the first and last byte of
+//! the pattern, with a portable scalar version when SSE is not available. The
+//! searcher is read only after Set, so it can be used by many threads at the
+//! same time.
+//------------------------------------------------------------------------------
+class LfcSearcher
+{
+  public:
+
+    //--------------------------------------------------------------------------
+    //! Constructor
+    //--------------------------------------------------------------------------
+    LfcSearcher();
+
+
+    //--------------------------------------------------------------------------
+    //! Destructor
+    //--------------------------------------------------------------------------
+    ~LfcSearcher();
+
+
+    //--------------------------------------------------------------------------
+    //! Set the pattern to look for
+    //!
+    //! @param pattern pattern, an empty one is found at the start of any text
+    //!
+    //--------------------------------------------------------------------------
+    void Set( const std::string& pattern );
+
+
+    //--------------------------------------------------------------------------
+    //! Find the first occurrence of the pattern
+    //!
+    //! @param text text to search, it doesn't need to be null terminated
+    //! @param len length of the text
+    //!
+    //! @return pointer to the occurrence in the text or NULL if not found
+    //!
+    //--------------------------------------------------------------------------
+    const char* Find( const char* text, size_t len ) const;
+
+
+    //--------------------------------------------------------------------------
+    //! Find the first occurrence of the pattern in a null terminated text
+    //--------------------------------------------------------------------------
+    const char* Find( const char* text ) const {
+      return Find( text, strlen( text ) );
+    }
+
+
+    //--------------------------------------------------------------------------
+    //! Find the first occurrence of the pattern in a string
+    //--------------------------------------------------------------------------
+    const char* Find( const std::string& text ) const {
+      return Find( text.c_str(), text.length() );
+    }
+
+  private:
+
+    //! Number of positions compared at a time by the vector search
+    static const size_t sBlockSize = 16;
+
+    std::string mPattern;        ///< the pattern
+
+    //--------------------------------------------------------------------------
+    //! Disable copying
+    //--------------------------------------------------------------------------
+    LfcSearcher( const LfcSearcher& );
+    LfcSearcher& operator=( const LfcSearcher& );
+};
+
+#endif // __EOS_PLUGIN_LFCSEARCHER_HH__
@@ -0,0 +1,410 @@
+//------------------------------------------------------------------------------
+// File: LfcSessionPool.cc
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+/*----------------------------------------------------------------------------*/
+#define NSTYPE_LFC
+#include <sys/types.h>
+#include <lfc_api.h>
+#include <serrno.h>
+#include <sys/time.h>
+#include <unistd.h>
+/*----------------------------------------------------------------------------*/
+#include "LfcSessionPool.hh"
+/*----------------------------------------------------------------------------*/
+#include "XrdSys/XrdSysError.hh"
+/*----------------------------------------------------------------------------*/
+
+namespace XrdCms {
+  extern XrdSysError LfcError;
+};
+
+using namespace XrdCms;
+
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+LfcSessionPool::LfcSessionPool( const std::string& host,
+                                unsigned int numSessions,
+                                int idleCheck,
+                                unsigned int maxBatch,
+                                int batchWait ):
+  mHost( host ),
+  mNumSessions( numSessions ? numSessions : 1 ),
+  mIdleCheck( idleCheck ),
+  mMaxBatch( maxBatch ? maxBatch : 1 ),
+  mBatchWait( batchWait ),
+  mShutdown( false ),
+  mCollecting( false ),
+  mNumStarted( 0 ),
+  mNumConnected( 0 ),
+  mNumRebuilds( 0 ),
+  mBatchFill( mMaxBatch + 1, 0 ),
+  mQueueCond( 0 )
+{
+  // empty
+}
+
+
+//------------------------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------------------------
+LfcSessionPool::~LfcSessionPool()
+{
+  mQueueCond.Lock();
+  mShutdown = true;
+  mQueueCond.Broadcast();
+  mQueueCond.UnLock();
+
+  for ( unsigned int i = 0; i < mThreads.size(); i++ ) {
+    XrdSysThread::Join( mThreads[i], NULL );
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Start the threads of the pool
+//------------------------------------------------------------------------------
+int
+LfcSessionPool::Start()
+{
+  for ( unsigned int i = 0; i < mNumSessions; i++ ) {
+    pthread_t thread;
+
+    if ( XrdSysThread::Run( &thread, LfcSessionPool::StartWorker,
+                            static_cast<void*>( this ), XRDSYSTHREAD_HOLD,
+                            "LFC session" ) )
+    {
+      int retc = errno;
+      LfcError.Emsg( "LfcSessionPool", retc, "start LFC session thread" );
+      return ( retc ? -retc : -EAGAIN );
+    }
+
+    mThreads.push_back( thread );
+  }
+
+  //............................................................................
+  // Like the single session opened before the pool existed, fail if the LFC
+  // cannot be reached at all. A thread whose session failed retries it on
+  // its next job.
+  //............................................................................
+  mQueueCond.Lock();
+
+  while ( mNumStarted < mThreads.size() ) {
+    mQueueCond.Wait();
+  }
+
+  unsigned int connected = mNumConnected;
+  mQueueCond.UnLock();
+
+  if ( !connected ) {
+    LfcError.Emsg( "LfcSessionPool", "Unable to open any LFC session on: ",
+                   mHost.c_str() );
+    return -ENOTCONN;
+  }
+
+  return 0;
+}
+
+
+//------------------------------------------------------------------------------
+// Queue a job to be run by one of the threads of the pool
+//------------------------------------------------------------------------------
+void
+LfcSessionPool::Submit( LfcJob* job, bool detached )
+{
+  mQueueCond.Lock();
+  job->mAbandoned = detached;
+
+  if ( ( mMaxBatch > 1 ) && job->CanBatch() ) {
+    mBatchQueue.push_back( job );
+
+    //..........................................................................
+    // Wake up the thread collecting a batch if the batch is full
+    //..........................................................................
+    if ( mCollecting && ( mBatchQueue.size() >= mMaxBatch ) ) {
+      mQueueCond.Broadcast();
+    } else {
+      mQueueCond.Signal();
+    }
+  } else {
+    //..........................................................................
+    // A signal could be taken by the thread collecting a batch
+    //..........................................................................
+    mQueue.push_back( job );
+
+    if ( mCollecting ) {
+      mQueueCond.Broadcast();
+    } else {
+      mQueueCond.Signal();
+    }
+  }
+
+  mQueueCond.UnLock();
+}
+
+
+//------------------------------------------------------------------------------
+// Give up a submitted job
+//------------------------------------------------------------------------------
+void
+LfcSessionPool::Abandon( LfcJob* job )
+{
+  mQueueCond.Lock();
+  std::deque<LfcJob*>::iterator iter = std::find( mQueue.begin(), mQueue.end(), job );
+  std::deque<LfcJob*>::iterator iter_batch = std::find( mBatchQueue.begin(),
+                                                        mBatchQueue.end(), job );
+
+  if ( iter != mQueue.end() ) {
+    mQueue.erase( iter );
+    delete job;
+  } else if ( iter_batch != mBatchQueue.end() ) {
+    mBatchQueue.erase( iter_batch );
+    delete job;
+  } else if ( job->mFinished ) {
+    delete job;
+  } else {
+    job->mAbandoned = true;
+  }
+
+  mQueueCond.UnLock();
+}
+
+
+//------------------------------------------------------------------------------
+// Get the batch fill histogram
+//------------------------------------------------------------------------------
+void
+LfcSessionPool::GetBatchFill( std::vector<uint64_t>& fill )
+{
+  mQueueCond.Lock();
+  fill = mBatchFill;
+  mQueueCond.UnLock();
+}
+
+
+//------------------------------------------------------------------------------
+// Take the next jobs to run from the queues
+//------------------------------------------------------------------------------
+void
+LfcSessionPool::TakeJobs( std::vector<LfcJob*>& jobs )
+{
+  if ( !mQueue.empty() ) {
+    jobs.push_back( mQueue.front() );
+    mQueue.pop_front();
+    return;
+  }
+
+  //............................................................................
+  // Only one thread at a time collects a batch, waiting for the batch to get
+  // full or for the batch window to end
+  //............................................................................
+  mCollecting = true;
+  struct timeval start;
+  struct timeval now;
+  gettimeofday( &start, NULL );
+
+  while ( !mShutdown && ( mBatchQueue.size() < mMaxBatch ) ) {
+    gettimeofday( &now, NULL );
+    int waited = ( now.tv_sec - start.tv_sec ) * 1000 +
+                 ( now.tv_usec - start.tv_usec ) / 1000;
+
+    if ( waited >= mBatchWait ) {
+      break;
+    }
+
+    mQueueCond.WaitMS( mBatchWait - waited );
+  }
+
+  while ( !mBatchQueue.empty() && ( jobs.size() < mMaxBatch ) ) {
+    jobs.push_back( mBatchQueue.front() );
+    mBatchQueue.pop_front();
+  }
+
+  mCollecting = false;
+
+  //............................................................................
+  // A batch window that ended without any job is not a batch
+  //............................................................................
+  if ( !jobs.empty() ) {
+    mBatchFill[jobs.size()]++;
+  }
+
+  if ( !mBatchQueue.empty() ) {
+    mQueueCond.Signal();
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Start function of the threads of the pool
+//------------------------------------------------------------------------------
+void*
+LfcSessionPool::StartWorker( void* arg )
+{
+  LfcSessionPool* pool = static_cast<LfcSessionPool*>( arg );
+  pool->Worker();
+  return NULL;
+}
+
+
+//------------------------------------------------------------------------------
+// Run the jobs of the queue until the pool is stopped
+//------------------------------------------------------------------------------
+void
+LfcSessionPool::Worker()
+{
+  char info[256];
+  bool session = OpenSession( mHost );
+  mQueueCond.Lock();
+  mNumStarted++;
+  mNumConnected += ( session ? 1 : 0 );
+  mQueueCond.Broadcast();
+
+  while ( true ) {
+    while ( !mShutdown && mQueue.empty() &&
+            ( mBatchQueue.empty() || mCollecting ) )
+    {
+      //........................................................................
+      // Check the session if it was idle for a while - the server or a
+      // firewall in between may have dropped the connection
+      //........................................................................
+      if ( mQueueCond.Wait( mIdleCheck ) && session ) {
+        mQueueCond.UnLock();
+
+        if ( lfc_ping( const_cast<char*>( mHost.c_str() ), info ) ) {
+          LfcError.Emsg( "LfcSessionPool", serrno, "ping idle LFC session on",
+                         mHost.c_str() );
+          ( void ) lfc_endsess();
+          session = false;
+          __sync_fetch_and_add( &mNumRebuilds, 1 );
+        }
+
+        mQueueCond.Lock();
+      }
+    }
+
+    //..........................................................................
+    // The jobs already queued are still run so that nobody waits forever
+    //..........................................................................
+    if ( mShutdown && mQueue.empty() && mBatchQueue.empty() ) {
+      break;
+    }
+
+    std::vector<LfcJob*> jobs;
+    TakeJobs( jobs );
+
+    if ( jobs.empty() ) {
+      continue;
+    }
+
+    mQueueCond.UnLock();
+
+    //..........................................................................
+    // Without a session every LFC call opens its own connection, so the job
+    // is run even if the session could not be opened
+    //..........................................................................
+    if ( !session ) {
+      session = OpenSession( mHost );
+    }
+
+    serrno = 0;
+
+    if ( jobs.size() > 1 ) {
+      jobs[0]->RunBatch( jobs );
+    } else {
+      jobs[0]->Run();
+    }
+
+    if ( session && IsCommError( serrno ) ) {
+      LfcError.Emsg( "LfcSessionPool", serrno, "query LFC, rebuilding session on",
+                     mHost.c_str() );
+      ( void ) lfc_endsess();
+      session = false;
+      __sync_fetch_and_add( &mNumRebuilds, 1 );
+    }
+
+    //..........................................................................
+    // The state of the job is protected by the lock of the queue
+    //..........................................................................
+    mQueueCond.Lock();
+
+    for ( unsigned int i = 0; i < jobs.size(); i++ ) {
+      if ( jobs[i]->mAbandoned ) {
+        delete jobs[i];
+      } else {
+        jobs[i]->mFinished = true;
+        jobs[i]->mDone.Post();
+      }
+    }
+  }
+
+  mQueueCond.UnLock();
+
+  if ( session ) {
+    ( void ) lfc_endsess();
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Open an LFC session for the calling thread
+//------------------------------------------------------------------------------
+bool
+LfcSessionPool::OpenSession( const std::string& host )
+{
+  char local_host[64];
+  char comment[80];
+
+  if ( gethostname( local_host, sizeof( local_host ) ) ) {
+    local_host[0] = '\0';
+  }
+
+  local_host[sizeof( local_host ) - 1] = '\0';
+  snprintf( comment, sizeof( comment ), "EOS-LFC@%s", local_host );
+
+  if ( lfc_startsess( const_cast<char*>( host.c_str() ), comment ) ) {
+    LfcError.Emsg( "LfcSessionPool", "Unable to open LFC session on: ",
+                   host.c_str() );
+    return false;
+  }
+
+  return true;
+}
+
+
+//------------------------------------------------------------------------------
+// Test if an LFC error means that the session is broken
+//------------------------------------------------------------------------------
+bool
+LfcSessionPool::IsCommError( int err )
+{
+  return ( ( err == SECOMERR ) || ( err == SECONNDROP ) ||
+           ( err == SETIMEDOUT ) || ( err == SENOSHOST ) ||
+           ( err == ENSNACT ) );
+}
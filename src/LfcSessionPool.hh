@@ -0,0 +1,285 @@
+//------------------------------------------------------------------------------
+// File: LfcSessionPool.hh
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOS_PLUGIN_LFCSESSIONPOOL_HH__
+#define __EOS_PLUGIN_LFCSESSIONPOOL_HH__
+
+/*----------------------------------------------------------------------------*/
+#include <XrdSys/XrdSysPthread.hh>
+#include <deque>
+#include <string>
+#include <vector>
+/*----------------------------------------------------------------------------*/
+#include <stdint.h>
+/*----------------------------------------------------------------------------*/
+
+
+//------------------------------------------------------------------------------
+//! Unit of work executed by a thread of the LFC session pool. The job is run
+//! on a thread which owns an LFC session, therefore it can use the LFC API
+//! directly and serrno is the one of that thread during Run().
+//------------------------------------------------------------------------------
+class LfcJob
+{
+  public:
+
+    //--------------------------------------------------------------------------
+    //! Constructor
+    //--------------------------------------------------------------------------
+    LfcJob(): mDone( 0 ), mFinished( false ), mAbandoned( false ) {}
+
+
+    //--------------------------------------------------------------------------
+    //! Destructor
+    //--------------------------------------------------------------------------
+    virtual ~LfcJob() {}
+
+
+    //--------------------------------------------------------------------------
+    //! Do the LFC calls of the job
+    //--------------------------------------------------------------------------
+    virtual void Run() = 0;
+
+
+    //--------------------------------------------------------------------------
+    //! Test if the job can be run in a batch together with other jobs
+    //--------------------------------------------------------------------------
+    virtual bool CanBatch() const {
+      return false;
+    }
+
+
+    //--------------------------------------------------------------------------
+    //! Run a batch of jobs which can be batched, all of the same type as this
+    //! job which is the first one of the batch. By default each job is run on
+    //! its own.
+    //!
+    //! @param jobs jobs of the batch
+    //!
+    //--------------------------------------------------------------------------
+    virtual void RunBatch( std::vector<LfcJob*>& jobs ) {
+      for ( unsigned int i = 0; i < jobs.size(); i++ ) {
+        jobs[i]->Run();
+      }
+    }
+
+
+    //--------------------------------------------------------------------------
+    //! Wait until the job was run by the pool
+    //--------------------------------------------------------------------------
+    void Wait() {
+      mDone.Wait();
+    }
+
+  private:
+
+    friend class LfcSessionPool;
+    XrdSysSemaphore mDone;  ///< posted once the job was run
+    bool mFinished;         ///< mark if the job was run
+    bool mAbandoned;        ///< mark if the job is to be deleted once run
+};
+
+
+//------------------------------------------------------------------------------
+//! Pool of threads each one owning an LFC session. The LFC client keeps the
+//! session of a thread in its Cthread context, so the only way to spread the
+//! queries over several sessions is to run them from several threads. The
+//! sessions are opened when the threads start, rebuilt after a communication
+//! error and checked with a ping when they were idle for a while.
+//!
+//! Jobs which can be batched are collected in a separate queue by one thread
+//! at a time, until the batch is full or the batch window has passed, and run
+//! together with a single bulk query.
+//------------------------------------------------------------------------------
+class LfcSessionPool
+{
+  public:
+
+    //--------------------------------------------------------------------------
+    //! Constructor
+    //!
+    //! @param host LFC server
+    //! @param numSessions number of sessions, and threads, of the pool
+    //! @param idleCheck time in seconds after which an idle session is checked
+    //! @param maxBatch maximum number of jobs run in one batch, 1 to disable
+    //!        batching
+    //! @param batchWait time in milliseconds to wait for a batch to fill up
+    //!
+    //--------------------------------------------------------------------------
+    LfcSessionPool( const std::string& host, unsigned int numSessions,
+                    int idleCheck, unsigned int maxBatch = 1, int batchWait = 0 );
+
+
+    //--------------------------------------------------------------------------
+    //! Destructor - stops the threads and closes their sessions
+    //--------------------------------------------------------------------------
+    ~LfcSessionPool();
+
+
+    //--------------------------------------------------------------------------
+    //! Start the threads of the pool and wait for them to open their session
+    //!
+    //! @return 0 if successful, -ENOTCONN if no session could be opened,
+    //!         otherwise -errno
+    //!
+    //--------------------------------------------------------------------------
+    int Start();
+
+
+    //--------------------------------------------------------------------------
+    //! Queue a job to be run by one of the threads of the pool, the caller
+    //! must either Wait() for the job before reusing or deleting it or give
+    //! it up with Abandon()
+    //!
+    //! @param job job to run
+    //! @param detached if true the job, allocated with new, is deleted by the
+    //!        pool once run and the caller must not use it any more
+    //!
+    //--------------------------------------------------------------------------
+    void Submit( LfcJob* job, bool detached = false );
+
+
+    //--------------------------------------------------------------------------
+    //! Run a job on one of the threads of the pool and wait for it
+    //!
+    //! @param job job to run
+    //!
+    //--------------------------------------------------------------------------
+    void Execute( LfcJob* job ) {
+      Submit( job );
+      job->Wait();
+    }
+
+
+    //--------------------------------------------------------------------------
+    //! Give up a submitted job whose result is not needed any more. The job
+    //! is dropped if it did not start yet, otherwise it is deleted once run.
+    //! The job must have been allocated with new and must not be used by the
+    //! caller after this call.
+    //!
+    //! @param job job to give up
+    //!
+    //--------------------------------------------------------------------------
+    void Abandon( LfcJob* job );
+
+
+    //--------------------------------------------------------------------------
+    //! Get the LFC server of the sessions
+    //--------------------------------------------------------------------------
+    const std::string& GetHost() const {
+      return mHost;
+    }
+
+
+    //--------------------------------------------------------------------------
+    //! Get the number of sessions rebuilt since the pool was started
+    //--------------------------------------------------------------------------
+    uint64_t GetNumRebuilds() const {
+      return __sync_fetch_and_add( const_cast<uint64_t*>( &mNumRebuilds ), 0 );
+    }
+
+
+    //--------------------------------------------------------------------------
+    //! Get the batch fill histogram
+    //!
+    //! @param fill number of batches run for every batch size, the index
+    //!        being the number of jobs in the batch
+    //!
+    //--------------------------------------------------------------------------
+    void GetBatchFill( std::vector<uint64_t>& fill );
+
+
+    //--------------------------------------------------------------------------
+    //! Open an LFC session for the calling thread, commented with the name of
+    //! the local host
+    //!
+    //! @param host LFC server
+    //!
+    //! @return true if successful, otherwise false
+    //!
+    //--------------------------------------------------------------------------
+    static bool OpenSession( const std::string& host );
+
+  private:
+
+    std::string mHost;                ///< LFC server
+    unsigned int mNumSessions;        ///< number of sessions of the pool
+    int mIdleCheck;                   ///< idle time after which a session is checked
+    unsigned int mMaxBatch;           ///< maximum number of jobs in a batch
+    int mBatchWait;                   ///< time to wait for a batch to fill up in ms
+    bool mShutdown;                   ///< mark if the pool is being stopped
+    bool mCollecting;                 ///< mark if a thread is collecting a batch
+    unsigned int mNumStarted;         ///< threads which tried to open their session
+    unsigned int mNumConnected;       ///< threads which opened their session
+    uint64_t mNumRebuilds;            ///< number of sessions rebuilt
+    std::vector<uint64_t> mBatchFill; ///< number of batches per batch size
+    std::deque<LfcJob*> mQueue;       ///< jobs waiting for a thread
+    std::deque<LfcJob*> mBatchQueue;  ///< jobs waiting to be batched
+    XrdSysCondVar mQueueCond;         ///< cond. variable protecting the queue
+    std::vector<pthread_t> mThreads;  ///< threads of the pool
+
+    //--------------------------------------------------------------------------
+    //! Start function of the threads of the pool
+    //!
+    //! @param arg pool object
+    //!
+    //--------------------------------------------------------------------------
+    static void* StartWorker( void* arg );
+
+
+    //--------------------------------------------------------------------------
+    //! Run the jobs of the queue until the pool is stopped
+    //--------------------------------------------------------------------------
+    void Worker();
+
+
+    //--------------------------------------------------------------------------
+    //! Take the next jobs to run from the queues, collecting a batch if there
+    //! are only jobs which can be batched - the queue lock must be held by the
+    //! caller
+    //!
+    //! @param jobs jobs to run, empty if another thread took them meanwhile
+    //!
+    //--------------------------------------------------------------------------
+    void TakeJobs( std::vector<LfcJob*>& jobs );
+
+
+    //--------------------------------------------------------------------------
+    //! Test if an LFC error means that the session is broken
+    //!
+    //! @param err serrno value
+    //!
+    //! @return true if communication error, otherwise false
+    //!
+    //--------------------------------------------------------------------------
+    static bool IsCommError( int err );
+
+
+    //--------------------------------------------------------------------------
+    //! Disable copying
+    //--------------------------------------------------------------------------
+    LfcSessionPool( const LfcSessionPool& );
+    LfcSessionPool& operator=( const LfcSessionPool& );
+};
+
+#endif // __EOS_PLUGIN_LFCSESSIONPOOL_HH__
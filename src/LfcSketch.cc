@@ -0,0 +1,131 @@
+//------------------------------------------------------------------------------
+// File: LfcSketch.cc
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include "LfcSketch.hh"
+/*----------------------------------------------------------------------------*/
+
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+LfcSketch::LfcSketch():
+  mMask( 0 ),
+  mSampleSize( 0 ),
+  mAdditions( 0 )
+{
+  Resize( 1 );
+}
+
+
+//------------------------------------------------------------------------------
+// Size the sketch
+//------------------------------------------------------------------------------
+void
+LfcSketch::Resize( uint64_t numKeys )
+{
+  //............................................................................
+  // One word per key rounded up to a power of 2, that is 16 counters per key
+  //............................................................................
+  size_t num_words = 8;
+
+  while ( num_words < numKeys ) {
+    num_words <<= 1;
+  }
+
+  mTable.assign( num_words, 0 );
+  mMask = num_words - 1;
+  mSampleSize = 10 * ( numKeys ? numKeys : 1 );
+  mAdditions = 0;
+}
+
+
+//------------------------------------------------------------------------------
+// Record an access to a key
+//------------------------------------------------------------------------------
+void
+LfcSketch::Increment( uint64_t hash )
+{
+  uint64_t& word = mTable[Word( hash )];
+  unsigned int min_count = sMaxCount;
+
+  for ( int i = 0; i < 4; i++ ) {
+    unsigned int count = ( word >> Shift( hash, i ) ) & 0xF;
+
+    if ( count < min_count ) {
+      min_count = count;
+    }
+  }
+
+  if ( min_count == sMaxCount ) {
+    return;
+  }
+
+  uint64_t new_val = word;
+
+  for ( int i = 0; i < 4; i++ ) {
+    if ( ( ( word >> Shift( hash, i ) ) & 0xF ) == min_count ) {
+      new_val += 1ULL << Shift( hash, i );
+    }
+  }
+
+  word = new_val;
+
+  if ( ++mAdditions == mSampleSize ) {
+    Reset();
+    mAdditions -= mSampleSize / 2;
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Estimate the number of recent accesses to a key
+//------------------------------------------------------------------------------
+unsigned int
+LfcSketch::Frequency( uint64_t hash ) const
+{
+  uint64_t word = mTable[Word( hash )];
+  unsigned int min_count = sMaxCount;
+
+  for ( int i = 0; i < 4; i++ ) {
+    unsigned int count = ( word >> Shift( hash, i ) ) & 0xF;
+
+    if ( count < min_count ) {
+      min_count = count;
+    }
+  }
+
+  return min_count;
+}
+
+
+//------------------------------------------------------------------------------
+// Halve all the counters
+//------------------------------------------------------------------------------
+void
+LfcSketch::Reset()
+{
+  for ( size_t i = 0; i < mTable.size(); i++ ) {
+    mTable[i] = ( mTable[i] >> 1 ) & 0x7777777777777777ULL;
+  }
+}
@@ -0,0 +1,124 @@
+//------------------------------------------------------------------------------
+// File: LfcSketch.hh
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOS_PLUGIN_LFCSKETCH_HH__
+#define __EOS_PLUGIN_LFCSKETCH_HH__
+
+/*----------------------------------------------------------------------------*/
+#include <vector>
+/*----------------------------------------------------------------------------*/
+#include <stddef.h>
+#include <stdint.h>
+/*----------------------------------------------------------------------------*/
+
+
+//------------------------------------------------------------------------------
+//! Count-min sketch estimating how often the keys were accessed recently, as
+//! used by the TinyLFU admission filter. Each key has four 4-bit counters in
+//! the same 64-bit word, selected from its hash, and the estimate is the
+//! smallest of them. Only the smallest counters are incremented (conservative
+//! update) and they saturate at 15. All the counters are halved once the
+//! number of increments reaches ten times the number of keys tracked, so that
+//! the keys popular a long time ago fade out.
+//!
+//! The sketch is not thread safe, the caller must serialize the calls. The
+//! cache updates and reads it under the lock of the shard, the lookups only
+//! buffer their accesses for the writers to apply.
+//------------------------------------------------------------------------------
+class LfcSketch
+{
+  public:
+
+    static const unsigned int sMaxCount = 15;  ///< saturation value of a counter
+
+    //--------------------------------------------------------------------------
+    //! Constructor
+    //--------------------------------------------------------------------------
+    LfcSketch();
+
+
+    //--------------------------------------------------------------------------
+    //! Size the sketch, forgetting all the counts
+    //!
+    //! @param numKeys number of keys to track, usually the cache capacity
+    //!
+    //--------------------------------------------------------------------------
+    void Resize( uint64_t numKeys );
+
+
+    //--------------------------------------------------------------------------
+    //! Record an access to a key
+    //!
+    //! @param hash 64-bit hash of the key
+    //!
+    //--------------------------------------------------------------------------
+    void Increment( uint64_t hash );
+
+
+    //--------------------------------------------------------------------------
+    //! Estimate the number of recent accesses to a key
+    //!
+    //! @param hash 64-bit hash of the key
+    //!
+    //! @return estimate between 0 and sMaxCount
+    //!
+    //--------------------------------------------------------------------------
+    unsigned int Frequency( uint64_t hash ) const;
+
+  private:
+
+    std::vector<uint64_t> mTable;  ///< 16 counters per word
+    uint64_t mMask;                ///< number of words - 1
+    uint64_t mSampleSize;          ///< increments between two halvings
+    uint64_t mAdditions;           ///< increments since the last halving
+
+    //--------------------------------------------------------------------------
+    //! Get the word holding the counters of a key
+    //--------------------------------------------------------------------------
+    size_t Word( uint64_t hash ) const {
+      return ( ( hash * 0x9E3779B97F4A7C15ULL ) >> 32 ) & mMask;
+    }
+
+
+    //--------------------------------------------------------------------------
+    //! Get the shift of one of the four counters of a key in its word, the
+    //! counter i is one of the four counters of the group i of the word
+    //--------------------------------------------------------------------------
+    static int Shift( uint64_t hash, int i ) {
+      return ( ( i << 2 ) + static_cast<int>( ( hash >> ( i << 3 ) ) & 3 ) ) << 2;
+    }
+
+
+    //--------------------------------------------------------------------------
+    //! Halve all the counters
+    //--------------------------------------------------------------------------
+    void Reset();
+
+    //--------------------------------------------------------------------------
+    //! Disable copying
+    //--------------------------------------------------------------------------
+    LfcSketch( const LfcSketch& );
+    LfcSketch& operator=( const LfcSketch& );
+};
+
+#endif // __EOS_PLUGIN_LFCSKETCH_HH__
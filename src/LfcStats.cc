@@ -0,0 +1,213 @@
+//------------------------------------------------------------------------------
+// File: LfcStats.cc
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+/*----------------------------------------------------------------------------*/
+#include <cstring>
+/*----------------------------------------------------------------------------*/
+#include "LfcStats.hh"
+/*----------------------------------------------------------------------------*/
+
+const int LfcHistogram::sSubCount;
+const int LfcHistogram::sNumBuckets;
+
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+LfcHistogram::LfcHistogram():
+  mCount( 0 ),
+  mSum( 0 ),
+  mMax( 0 )
+{
+  memset( mBuckets, 0, sizeof( mBuckets ) );
+}
+
+
+//------------------------------------------------------------------------------
+// Add the values recorded in another histogram
+//------------------------------------------------------------------------------
+void
+LfcHistogram::Add( const LfcHistogram& other )
+{
+  for ( int i = 0; i < sNumBuckets; i++ ) {
+    mBuckets[i] += other.mBuckets[i];
+  }
+
+  mCount += other.mCount;
+  mSum += other.mSum;
+
+  if ( other.mMax > mMax ) {
+    mMax = other.mMax;
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Get the value below which a fraction of the recorded values are
+//------------------------------------------------------------------------------
+uint64_t
+LfcHistogram::GetPercentile( double fraction ) const
+{
+  uint64_t rank = static_cast<uint64_t>( fraction * mCount + 0.5 );
+  uint64_t seen = 0;
+
+  if ( !rank ) {
+    rank = 1;
+  }
+
+  for ( int i = 0; i < sNumBuckets - 1; i++ ) {
+    seen += mBuckets[i];
+
+    if ( seen >= rank ) {
+      uint64_t high = BucketLow( i + 1 ) - 1;
+      return ( high < mMax ) ? high : mMax;
+    }
+  }
+
+  return mMax;
+}
+
+
+//------------------------------------------------------------------------------
+// Constructor of a block
+//------------------------------------------------------------------------------
+LfcStats::Block::Block():
+  mOwner( NULL ),
+  mTicks( 0 )
+{
+  memset( mCounters, 0, sizeof( mCounters ) );
+}
+
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+LfcStats::LfcStats()
+{
+  pthread_key_create( &mKey, LfcStats::ReleaseBlock );
+}
+
+
+//------------------------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------------------------
+LfcStats::~LfcStats()
+{
+  pthread_key_delete( mKey );
+
+  for ( unsigned int i = 0; i < mBlocks.size(); i++ ) {
+    delete mBlocks[i];
+  }
+}
+
+
+//------------------------------------------------------------------------------
+// Sum up the blocks of all the threads
+//------------------------------------------------------------------------------
+void
+LfcStats::Collect( Block& total )
+{
+  mMutex.Lock();     // -->
+
+  for ( unsigned int i = 0; i < mBlocks.size(); i++ ) {
+    for ( int j = 0; j < eNumCounters; j++ ) {
+      total.mCounters[j] += mBlocks[i]->mCounters[j];
+    }
+
+    for ( int j = 0; j < eNumStages; j++ ) {
+      total.mStages[j].Add( mBlocks[i]->mStages[j] );
+    }
+  }
+
+  mMutex.UnLock();   // <--
+}
+
+
+//------------------------------------------------------------------------------
+// Get the name of a stage
+//------------------------------------------------------------------------------
+const char*
+LfcStats::GetName( Stage stage )
+{
+  static const char* names[eNumStages] = {
+    "locate", "cache_lookup", "rewrite", "lfc_lookup", "lfc_query",
+    "lfc_bulk_query"
+  };
+
+  return names[stage];
+}
+
+
+//------------------------------------------------------------------------------
+// Get the name of a counter
+//------------------------------------------------------------------------------
+const char*
+LfcStats::GetName( Counter counter )
+{
+  static const char* names[eNumCounters] = {
+    "redirect_eos", "redirect_mgr", "storage_root", "neg_cache_hit",
+    "lfc_found", "lfc_not_found", "lfc_failed", "rewrite_hit_0",
+    "rewrite_hit_1", "rewrite_hit_2", "rewrite_hit_3", "rewrite_hit_4",
+    "rewrite_hit_5", "rewrite_hit_6", "rewrite_hit_7"
+  };
+
+  return names[counter];
+}
+
+
+//------------------------------------------------------------------------------
+// Give a block to the calling thread
+//------------------------------------------------------------------------------
+LfcStats::Block*
+LfcStats::NewBlock()
+{
+  Block* block;
+  mMutex.Lock();     // -->
+
+  if ( mFree.empty() ) {
+    block = new Block();
+    block->mOwner = this;
+    mBlocks.push_back( block );
+  } else {
+    block = mFree.back();
+    mFree.pop_back();
+  }
+
+  mMutex.UnLock();   // <--
+  pthread_setspecific( mKey, block );
+  return block;
+}
+
+
+//------------------------------------------------------------------------------
+// Release the block of a thread which exits
+//------------------------------------------------------------------------------
+void
+LfcStats::ReleaseBlock( void* arg )
+{
+  Block* block = static_cast<Block*>( arg );
+  LfcStats* stats = block->mOwner;
+  stats->mMutex.Lock();     // -->
+  stats->mFree.push_back( block );
+  stats->mMutex.UnLock();   // <--
+}
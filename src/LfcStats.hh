@@ -0,0 +1,326 @@
+//------------------------------------------------------------------------------
+// File: LfcStats.hh
+// Author: Elvin-Alin Sindrilaru - CERN
+//------------------------------------------------------------------------------
+
+/************************************************************************
+ * EOS - the CERN Disk Storage System                                   *
+ * Copyright (C) 2011 CERN/Switzerland                                  *
+ *                                                                      *
+ * This program is free software: you can redistribute it and/or modify *
+ * it under the terms of the GNU General Public License as published by *
+ * the Free Software Foundation, either version 3 of the License, or    *
+ * (at your option) any later version.                                  *
+ *                                                                      *
+ * This program is distributed in the hope that it will be useful,      *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of       *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        *
+ * GNU General Public License for more details.                         *
+ *                                                                      *
+ * You should have received a copy of the GNU General Public License    *
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.*
+ ************************************************************************/
+
+#ifndef __EOS_PLUGIN_LFCSTATS_HH__
+#define __EOS_PLUGIN_LFCSTATS_HH__
+
+/*----------------------------------------------------------------------------*/
+#include <XrdSys/XrdSysPthread.hh>
+#include <string>
+#include <vector>
+/*----------------------------------------------------------------------------*/
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+/*----------------------------------------------------------------------------*/
+
+
+//------------------------------------------------------------------------------
+//! Latency histogram with logarithmic buckets, each power of two being split
+//! in sSubCount linear sub-buckets, so that any value is recorded with a
+//! relative error below 1 / sSubCount. Values above 2^sMaxBits are recorded
+//! in the last bucket.
+//------------------------------------------------------------------------------
+class LfcHistogram
+{
+  public:
+
+    static const int sSubBits = 4;                 ///< log2 of sSubCount
+    static const int sSubCount = 1 << sSubBits;    ///< sub-buckets per power of 2
+    static const int sMaxBits = 40;                ///< highest power of 2 kept
+    static const int sNumBuckets = ( sMaxBits - sSubBits + 2 ) * sSubCount;
+
+    //--------------------------------------------------------------------------
+    //! Constructor
+    //--------------------------------------------------------------------------
+    LfcHistogram();
+
+
+    //--------------------------------------------------------------------------
+    //! Record a value
+    //--------------------------------------------------------------------------
+    void Record( uint64_t value ) {
+      mBuckets[BucketIndex( value )]++;
+      mCount++;
+      mSum += value;
+
+      if ( value > mMax ) {
+        mMax = value;
+      }
+    }
+
+
+    //--------------------------------------------------------------------------
+    //! Add the values recorded in another histogram
+    //--------------------------------------------------------------------------
+    void Add( const LfcHistogram& other );
+
+
+    //--------------------------------------------------------------------------
+    //! Get the value below which a fraction of the recorded values are
+    //!
+    //! @param fraction between 0 and 1
+    //!
+    //! @return highest value of the bucket reached, at most the maximum
+    //!
+    //--------------------------------------------------------------------------
+    uint64_t GetPercentile( double fraction ) const;
+
+
+    //--------------------------------------------------------------------------
+    //! Get the counters
+    //--------------------------------------------------------------------------
+    uint64_t GetCount() const {
+      return mCount;
+    }
+
+    uint64_t GetSum() const {
+      return mSum;
+    }
+
+    uint64_t GetMax() const {
+      return mMax;
+    }
+
+    uint64_t GetBucket( int index ) const {
+      return mBuckets[index];
+    }
+
+
+    //--------------------------------------------------------------------------
+    //! Get the bucket of a value
+    //--------------------------------------------------------------------------
+    static int BucketIndex( uint64_t value ) {
+      if ( value < static_cast<uint64_t>( sSubCount ) ) {
+        return static_cast<int>( value );
+      }
+
+      int msb = 63 - __builtin_clzll( value );
+
+      if ( msb > sMaxBits ) {
+        return sNumBuckets - 1;
+      }
+
+      return ( msb - sSubBits + 1 ) * sSubCount +
+             static_cast<int>( ( value >> ( msb - sSubBits ) ) & ( sSubCount - 1 ) );
+    }
+
+
+    //--------------------------------------------------------------------------
+    //! Get the lowest value of a bucket
+    //--------------------------------------------------------------------------
+    static uint64_t BucketLow( int index ) {
+      if ( index < sSubCount ) {
+        return index;
+      }
+
+      int msb = index / sSubCount + sSubBits - 1;
+      uint64_t sub = index % sSubCount;
+      return ( sSubCount + sub ) << ( msb - sSubBits );
+    }
+
+  private:
+
+    uint64_t mCount;                  ///< number of values recorded
+    uint64_t mSum;                    ///< sum of the values recorded
+    uint64_t mMax;                    ///< highest value recorded
+    uint64_t mBuckets[sNumBuckets];   ///< number of values per bucket
+};
+
+
+//------------------------------------------------------------------------------
+//! Counters and latency histograms of the plugin. Every thread updates its own
+//! block of counters, found through a thread specific key, so that recording
+//! takes no lock and no atomic operation and the threads don't share cache
+//! lines. The blocks are summed up when the statistics are read, the values
+//! of a block being updated meanwhile may be off by the last few records.
+//! The block of a thread which exits is taken over by the next new thread,
+//! the counts already in it are kept.
+//!
+//! Reading the clock costs about as much as a cache hit, so the stages of the
+//! cache hit path are timed only for one call out of sSampleRate, chosen with
+//! Sample(). The counts of these histograms are therefore sampled too and are
+//! scaled back by GetSampleRate() when reported.
+//------------------------------------------------------------------------------
+class LfcStats
+{
+  public:
+
+    //--------------------------------------------------------------------------
+    //! Stages whose latency is recorded
+    //--------------------------------------------------------------------------
+    enum Stage {
+      eLocate,          ///< whole Locate call, sampled
+      eCacheLookup,     ///< lookup of the lfn in the cache, sampled
+      eRewrite,         ///< generation of the rewrites of an lfn
+      eLfcLookup,       ///< resolution of a cache miss through the LFC
+      eLfcQuery,        ///< one lfc_getreplica call
+      eLfcBulkQuery,    ///< one lfc_getreplicasl call
+      eNumStages
+    };
+
+    //--------------------------------------------------------------------------
+    //! Event counters, eRewriteHit + i counts the lfns resolved by the rewrite
+    //! number i, the last one also counting the ones after it
+    //--------------------------------------------------------------------------
+    enum Counter {
+      eRedirectEos,     ///< Locate redirected to EOS
+      eRedirectMgr,     ///< Locate redirected to the meta manager
+      eStorageRoot,     ///< lfn already containing the storage root
+      eNegCacheHit,     ///< lfn found in the negative cache
+      eLfcFound,        ///< LFC lookup giving a pfn
+      eLfcNotFound,     ///< LFC lookup giving no pfn
+      eLfcFailed,       ///< LFC query which failed
+      eRewriteHit,
+      eNumCounters = eRewriteHit + 8
+    };
+
+    //! Number of rewrites counted apart
+    static const int sNumRewrites = eNumCounters - eRewriteHit;
+
+    //! One call out of sSampleRate of the sampled stages is timed
+    static const unsigned int sSampleRate = 8;
+
+    //--------------------------------------------------------------------------
+    //! Counters and histograms of one thread, or the sum of all of them
+    //--------------------------------------------------------------------------
+    struct Block {
+      Block();
+
+      LfcStats* mOwner;                     ///< statistics the block belongs to
+      uint64_t mTicks;                      ///< number of calls to Sample()
+      uint64_t mCounters[eNumCounters];     ///< event counters
+      LfcHistogram mStages[eNumStages];     ///< latency in ns per stage
+      char mPad[64];                        ///< keep the blocks apart
+    };
+
+    //--------------------------------------------------------------------------
+    //! Constructor
+    //--------------------------------------------------------------------------
+    LfcStats();
+
+
+    //--------------------------------------------------------------------------
+    //! Destructor
+    //--------------------------------------------------------------------------
+    ~LfcStats();
+
+
+    //--------------------------------------------------------------------------
+    //! Count an event
+    //--------------------------------------------------------------------------
+    void Add( Counter counter, uint64_t value = 1 ) {
+      GetBlock()->mCounters[counter] += value;
+    }
+
+
+    //--------------------------------------------------------------------------
+    //! Tell if the current call of a sampled stage must be timed
+    //--------------------------------------------------------------------------
+    bool Sample() {
+      return !( ++GetBlock()->mTicks % sSampleRate );
+    }
+
+
+    //--------------------------------------------------------------------------
+    //! Record the latency of a stage
+    //!
+    //! @param stage stage
+    //! @param start time when the stage started as given by Now()
+    //!
+    //--------------------------------------------------------------------------
+    void Record( Stage stage, uint64_t start ) {
+      GetBlock()->mStages[stage].Record( Now() - start );
+    }
+
+
+    //--------------------------------------------------------------------------
+    //! Sum up the blocks of all the threads
+    //!
+    //! @param total filled with the sum
+    //!
+    //--------------------------------------------------------------------------
+    void Collect( Block& total );
+
+
+    //--------------------------------------------------------------------------
+    //! Get the name of a stage or of a counter, as used in the stats file
+    //--------------------------------------------------------------------------
+    static const char* GetName( Stage stage );
+    static const char* GetName( Counter counter );
+
+
+    //--------------------------------------------------------------------------
+    //! Get the number of calls a recorded latency stands for in a stage
+    //--------------------------------------------------------------------------
+    static unsigned int GetSampleRate( Stage stage ) {
+      if ( ( stage == eLocate ) || ( stage == eCacheLookup ) ) {
+        return sSampleRate;
+      }
+
+      return 1;
+    }
+
+
+    //--------------------------------------------------------------------------
+    //! Get the current time in ns from the monotonic clock
+    //--------------------------------------------------------------------------
+    static uint64_t Now() {
+      struct timespec ts;
+      clock_gettime( CLOCK_MONOTONIC, &ts );
+      return static_cast<uint64_t>( ts.tv_sec ) * 1000000000ULL + ts.tv_nsec;
+    }
+
+  private:
+
+    pthread_key_t mKey;             ///< key of the block of each thread
+    std::vector<Block*> mBlocks;    ///< blocks of all the threads
+    std::vector<Block*> mFree;      ///< blocks of the threads which exited
+    XrdSysMutex mMutex;             ///< mutex protecting the lists of blocks
+
+
+    //--------------------------------------------------------------------------
+    //! Get the block of the calling thread, creating it if needed
+    //--------------------------------------------------------------------------
+    Block* GetBlock() {
+      Block* block = static_cast<Block*>( pthread_getspecific( mKey ) );
+      return ( block ? block : NewBlock() );
+    }
+
+
+    //--------------------------------------------------------------------------
+    //! Give a block to the calling thread
+    //--------------------------------------------------------------------------
+    Block* NewBlock();
+
+
+    //--------------------------------------------------------------------------
+    //! Release the block of a thread which exits
+    //!
+    //! @param arg block
+    //!
+    //--------------------------------------------------------------------------
+    static void ReleaseBlock( void* arg );
+};
+
+#endif // __EOS_PLUGIN_LFCSTATS_HH__
@@ -29,7 +29,7 @@
 // Tokenize a string based on a set of delimiters
 //--------------------------------------------------------------------------
 const VectStrings
-LfcString::Split( LfcString delim )
+LfcString::Split( const LfcString& delim ) const
 {
   VectStrings result;
   std::string::size_type tok_start, tok_end = 0;
@@ -45,3 +45,55 @@ LfcString::Split( LfcString delim )
 
   return result;
 }
+
+
+//--------------------------------------------------------------------------
+// Inverse to split
+//--------------------------------------------------------------------------
+LfcString
+LfcString::Join( const VectStrings& v, const LfcString& delim )
+{
+  LfcString result;
+  size_t len = 0;
+
+  for ( VectStrings::const_iterator it = v.begin(); it != v.end(); ++it )
+    len += delim.length() + it->length();
+
+  result.reserve( len );
+
+  for ( VectStrings::const_iterator it = v.begin(); it != v.end(); ++it ) {
+    result += delim;
+    result += *it;
+  }
+
+  return result;
+}
+
+
+//--------------------------------------------------------------------------
+// Inverse to split writing into a buffer
+//--------------------------------------------------------------------------
+size_t
+LfcString::Join( LfcTokenizer& tokens, const char* delim, char* buff, size_t size )
+{
+  size_t len = 0;
+  size_t delim_len = strlen( delim );
+  LfcStringView token;
+
+  while ( tokens.Next( token ) ) {
+    if ( len + delim_len + token.length() < size ) {
+      memcpy( buff + len, delim, delim_len );
+      memcpy( buff + len + delim_len, token.data(), token.length() );
+    }
+
+    len += delim_len + token.length();
+  }
+
+  if ( len < size ) {
+    buff[len] = '\0';
+  } else if ( size ) {
+    buff[0] = '\0';
+  }
+
+  return len;
+}
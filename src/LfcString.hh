@@ -25,11 +25,13 @@
 #define __EOS_PLUGIN_LFCSTRING_HH__
 
 /*----------------------------------------------------------------------------*/
+#include <cstring>
 #include <string>
 #include <vector>
 /*----------------------------------------------------------------------------*/
 
 class LfcString;
+class LfcTokenizer;
 typedef std::vector<LfcString> VectStrings;
 
 
@@ -94,8 +96,8 @@ class LfcString : public std::string
     //!
     //! @return true if string starts with the specified sequence, false otherwise
     //--------------------------------------------------------------------------
-    bool StartsWith( const LfcString s ) {
-      return substr( 0, s.size() ) == s ;
+    bool StartsWith( const char* s ) const {
+      return !compare( 0, strlen( s ), s );
     }
 
 
@@ -107,7 +109,7 @@ class LfcString : public std::string
     //! @return the vector of string obtained by splitting the inital string
     //!
     //--------------------------------------------------------------------------
-    const VectStrings Split( LfcString delim );
+    const VectStrings Split( const LfcString& delim ) const;
 
 
     //------------------------------------------------------------------------------
@@ -119,13 +121,167 @@ class LfcString : public std::string
     //! @return the string obtained by contatenating the delim after each element
     //!         from the vector
     //------------------------------------------------------------------------------
-    static LfcString Join( VectStrings v, LfcString delim ) {
-      LfcString result;
+    static LfcString Join( const VectStrings& v, const LfcString& delim );
 
-      for ( VectStrings::iterator it = v.begin(); it != v.end(); ++it )
-        result += delim + *it;
 
-      return result;
+    //------------------------------------------------------------------------------
+    //! Inverse to split writing into a buffer, without any memory allocation
+    //!
+    //! @param tokens tokenizer giving the elements, all the remaining ones are
+    //!        consumed
+    //! @param delim delimitator
+    //! @param buff buffer receiving the null terminated result
+    //! @param size size of the buffer
+    //!
+    //! @return length of the result, the result was truncated if it is not less
+    //!         than size
+    //------------------------------------------------------------------------------
+    static size_t Join( LfcTokenizer& tokens, const char* delim, char* buff,
+                        size_t size );
+};
+
+
+//------------------------------------------------------------------------------
+//! Non-owning reference to a sequence of characters, used to pass a path down
+//! the resolution pipeline without copying it. The referenced characters must
+//! outlive the view.
+//------------------------------------------------------------------------------
+class LfcStringView
+{
+  public:
+
+    //--------------------------------------------------------------------------
+    //! Constructor
+    //--------------------------------------------------------------------------
+    LfcStringView(): mData( "" ), mLen( 0 ) {}
+
+
+    //--------------------------------------------------------------------------
+    //! Constructor from a C string
+    //--------------------------------------------------------------------------
+    LfcStringView( const char* s ):
+      mData( s ? s : "" ), mLen( s ? strlen( s ) : 0 ) {}
+
+
+    //--------------------------------------------------------------------------
+    //! Constructor from a pointer and a length
+    //--------------------------------------------------------------------------
+    LfcStringView( const char* s, size_t len ): mData( s ), mLen( len ) {}
+
+
+    //--------------------------------------------------------------------------
+    //! Constructor from a string
+    //--------------------------------------------------------------------------
+    LfcStringView( const std::string& s ): mData( s.data() ), mLen( s.length() ) {}
+
+
+    //--------------------------------------------------------------------------
+    //! Get pointer to the characters, not necessarily null terminated
+    //--------------------------------------------------------------------------
+    const char* data() const {
+      return mData;
+    }
+
+
+    //--------------------------------------------------------------------------
+    //! Get the number of characters
+    //--------------------------------------------------------------------------
+    size_t length() const {
+      return mLen;
+    }
+
+
+    //--------------------------------------------------------------------------
+    //! Test if the view is equal to a C string
+    //--------------------------------------------------------------------------
+    bool Equals( const char* s ) const {
+      return ( strlen( s ) == mLen ) && !memcmp( mData, s, mLen );
+    }
+
+
+    //--------------------------------------------------------------------------
+    //! Make an owning copy
+    //--------------------------------------------------------------------------
+    LfcString str() const {
+      return LfcString( std::string( mData, mLen ) );
+    }
+
+  private:
+
+    const char* mData; ///< referenced characters
+    size_t mLen;       ///< number of characters
+};
+
+
+
+//------------------------------------------------------------------------------
+//! Tokenizer giving one by one the tokens of a string as views into it, so
+//! that nothing is allocated. Like LfcString::Split, consecutive delimiters
+//! don't produce empty tokens.
+//------------------------------------------------------------------------------
+class LfcTokenizer
+{
+  public:
+
+    //--------------------------------------------------------------------------
+    //! Constructor
+    //!
+    //! @param str string to tokenize, it must outlive the tokenizer
+    //! @param delim null terminated set of delimiters
+    //!
+    //--------------------------------------------------------------------------
+    LfcTokenizer( const LfcStringView& str, const char* delim ):
+      mPos( str.data() ), mEnd( str.data() + str.length() ), mDelim( delim ) {}
+
+
+    //--------------------------------------------------------------------------
+    //! Get the next token
+    //!
+    //! @param token set to the next token
+    //!
+    //! @return true if a token was found, false if there are no more tokens
+    //!
+    //--------------------------------------------------------------------------
+    bool Next( LfcStringView& token ) {
+      while ( ( mPos < mEnd ) && IsDelim( *mPos ) ) {
+        mPos++;
+      }
+
+      if ( mPos == mEnd ) {
+        return false;
+      }
+
+      const char* start = mPos;
+
+      while ( ( mPos < mEnd ) && !IsDelim( *mPos ) ) {
+        mPos++;
+      }
+
+      token = LfcStringView( start, mPos - start );
+      return true;
+    }
+
+
+    //--------------------------------------------------------------------------
+    //! Test if there are more tokens
+    //--------------------------------------------------------------------------
+    bool HasNext() const {
+      LfcTokenizer copy = *this;
+      LfcStringView token;
+      return copy.Next( token );
+    }
+
+  private:
+
+    const char* mPos;   ///< current position in the string
+    const char* mEnd;   ///< end of the string
+    const char* mDelim; ///< set of delimiters
+
+    //--------------------------------------------------------------------------
+    //! Test if a character is a delimiter
+    //--------------------------------------------------------------------------
+    bool IsDelim( char c ) const {
+      return strchr( mDelim, c ) && c;
     }
 };
 